@@ -0,0 +1,112 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+
+LatencyRecorder::LatencyRecorder()
+    : m_total(0)
+    , m_isSorted(true)
+{
+}
+
+void LatencyRecorder::reserve(int count)
+{
+    m_samples.reserve(count);
+}
+
+void LatencyRecorder::record(qint64 nanoseconds)
+{
+    m_samples.append(nanoseconds);
+    m_total += nanoseconds;
+    m_isSorted = false;
+}
+
+int LatencyRecorder::count() const
+{
+    return m_samples.size();
+}
+
+qint64 LatencyRecorder::total() const
+{
+    return m_total;
+}
+
+qint64 LatencyRecorder::percentile(double fraction)
+{
+    if (m_samples.isEmpty()) {
+        return 0;
+    }
+
+    if (!m_isSorted) {
+        std::sort(m_samples.begin(), m_samples.end());
+        m_isSorted = true;
+    }
+
+    const int index = qBound(0, static_cast<int>(std::ceil(fraction * m_samples.size())) - 1, m_samples.size() - 1);
+    return m_samples.at(index);
+}
+
+QJsonObject LatencyRecorder::toJson()
+{
+    QJsonObject latency;
+    latency.insert(QStringLiteral("mean"), m_samples.isEmpty() ? 0.0 : static_cast<double>(m_total) / m_samples.size());
+    latency.insert(QStringLiteral("p50"), static_cast<double>(percentile(0.50)));
+    latency.insert(QStringLiteral("p90"), static_cast<double>(percentile(0.90)));
+    latency.insert(QStringLiteral("p99"), static_cast<double>(percentile(0.99)));
+    latency.insert(QStringLiteral("p999"), static_cast<double>(percentile(0.999)));
+    latency.insert(QStringLiteral("max"), static_cast<double>(percentile(1.0)));
+    return latency;
+}
+
+BenchmarkReport::BenchmarkReport(const BenchmarkOptions &options)
+    : m_options(options)
+{
+}
+
+const BenchmarkOptions &BenchmarkReport::options() const
+{
+    return m_options;
+}
+
+bool BenchmarkReport::isSelected(const QString &name) const
+{
+    return m_options.filter.isEmpty() || name.contains(m_options.filter);
+}
+
+void BenchmarkReport::add(const QString &name, const QJsonObject &parameters, LatencyRecorder *recorder,
+                          double itemsPerIteration, const QString &unit, const QJsonObject &metrics)
+{
+    const double seconds = recorder->total() / 1e9;
+
+    QJsonObject result;
+    result.insert(QStringLiteral("name"), name);
+    result.insert(QStringLiteral("parameters"), parameters);
+    result.insert(QStringLiteral("iterations"), recorder->count());
+    result.insert(unit + QStringLiteral("_per_second"),
+                  seconds > 0.0 ? itemsPerIteration * recorder->count() / seconds : 0.0);
+    result.insert(QStringLiteral("latency_ns"), recorder->toJson());
+    for (auto it = metrics.constBegin(); it != metrics.constEnd(); ++it) {
+        result.insert(it.key(), it.value());
+    }
+    m_results.append(result);
+}
+
+void BenchmarkReport::addError(const QString &name, const QString &message)
+{
+    m_errors.append(name + QStringLiteral(": ") + message);
+}
+
+QStringList BenchmarkReport::errors() const
+{
+    return m_errors;
+}
+
+QJsonObject BenchmarkReport::toJson() const
+{
+    QJsonObject report;
+    report.insert(QStringLiteral("results"), m_results);
+    if (!m_errors.isEmpty()) {
+        report.insert(QStringLiteral("errors"), QJsonArray::fromStringList(m_errors));
+    }
+    return report;
+}
@@ -0,0 +1,101 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <QtGlobal>
+
+struct BenchmarkOptions
+{
+    // Each case runs for at least this long after warm-up.
+    qint64 minimumTimeNs;
+    // Only cases whose name contains this string run.
+    QString filter;
+    // Fewer parameter combinations, for a smoke run.
+    bool quick;
+};
+
+// Per-iteration timings of one case, reduced to percentiles at the end.
+class LatencyRecorder
+{
+public:
+    LatencyRecorder();
+
+    void reserve(int count);
+    void record(qint64 nanoseconds);
+
+    int count() const;
+    qint64 total() const;
+    qint64 percentile(double fraction);
+
+    QJsonObject toJson();
+
+private:
+    QVector<qint64> m_samples;
+    qint64 m_total;
+    bool m_isSorted;
+};
+
+class BenchmarkReport
+{
+public:
+    explicit BenchmarkReport(const BenchmarkOptions &options);
+
+    const BenchmarkOptions &options() const;
+    bool isSelected(const QString &name) const;
+
+    // Runs iteration() until the minimum time has elapsed and records the
+    // duration of every call. Returns false if the case was filtered out.
+    template <typename Function>
+    bool run(const QString &name, LatencyRecorder *recorder, Function iteration)
+    {
+        if (!isSelected(name)) {
+            return false;
+        }
+
+        for (int i = 0; i < WarmUpIterations; ++i) {
+            iteration();
+        }
+
+        QElapsedTimer timer;
+        while (recorder->total() < m_options.minimumTimeNs || recorder->count() < MinimumIterations) {
+            timer.start();
+            iteration();
+            recorder->record(timer.nsecsElapsed());
+        }
+
+        return true;
+    }
+
+    // itemsPerIteration is reported as "<unit>_per_second"; metrics are
+    // copied into the result as they are.
+    void add(const QString &name, const QJsonObject &parameters, LatencyRecorder *recorder,
+             double itemsPerIteration, const QString &unit, const QJsonObject &metrics = QJsonObject());
+
+    // A selected case that could not run. It is listed under "errors" in
+    // the report, and the benchmark exits with a failure status.
+    void addError(const QString &name, const QString &message);
+    QStringList errors() const;
+
+    QJsonObject toJson() const;
+
+private:
+    static const int WarmUpIterations = 8;
+    static const int MinimumIterations = 16;
+
+    BenchmarkOptions m_options;
+    QJsonArray m_results;
+    QStringList m_errors;
+};
+
+void runEngineBenchmarks(BenchmarkReport *report);
+void runConversionBenchmarks(BenchmarkReport *report);
+void runUiBenchmarks(BenchmarkReport *report);
+void runPresetBenchmarks(BenchmarkReport *report);
+
+#endif // BENCHMARK_H
@@ -0,0 +1,179 @@
+#include "Benchmark.h"
+
+#include "PcmToWavConverter.h"
+
+#include <QByteArray>
+#include <QTemporaryDir>
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <vector>
+
+namespace
+{
+    const int PayloadMebibytes = 64;
+
+    void writeLittleEndian(unsigned char *out, quint32 value, int bytes)
+    {
+        for (int i = 0; i < bytes; ++i) {
+            out[i] = static_cast<unsigned char>(value >> (8 * i));
+        }
+    }
+
+    // Straight port of MainActivity.startPcmToWav(): one pass over the input
+    // to count its bytes, then a second one copying it after the header
+    // through a 100 KB buffer. 16-bit stereo at 8000 Hz, as the Java code
+    // hardcodes.
+    bool convertTwoPass(const QByteArray &source, const QByteArray &target)
+    {
+        std::vector<char> buffer(1024 * 100);
+
+        FILE *input = std::fopen(source.constData(), "rb");
+        if (!input) {
+            return false;
+        }
+
+        quint32 pcmSize = 0;
+        size_t size = 0;
+        while ((size = std::fread(buffer.data(), 1, buffer.size(), input)) > 0) {
+            pcmSize += static_cast<quint32>(size);
+        }
+        std::fclose(input);
+
+        unsigned char header[44];
+        const quint32 channels = 2;
+        const quint32 bitsPerSample = 16;
+        const quint32 sampleRate = 8000;
+        const quint32 blockAlign = channels * bitsPerSample / 8;
+        std::copy_n("RIFF", 4, header);
+        writeLittleEndian(header + 4, pcmSize + (44 - 8), 4);
+        std::copy_n("WAVEfmt ", 8, header + 8);
+        writeLittleEndian(header + 16, 16, 4);
+        writeLittleEndian(header + 20, 1, 2);
+        writeLittleEndian(header + 22, channels, 2);
+        writeLittleEndian(header + 24, sampleRate, 4);
+        writeLittleEndian(header + 28, blockAlign * sampleRate, 4);
+        writeLittleEndian(header + 32, blockAlign, 2);
+        writeLittleEndian(header + 34, bitsPerSample, 2);
+        std::copy_n("data", 4, header + 36);
+        writeLittleEndian(header + 40, pcmSize, 4);
+
+        input = std::fopen(source.constData(), "rb");
+        FILE *output = std::fopen(target.constData(), "wb");
+        if (!input || !output) {
+            if (input) {
+                std::fclose(input);
+            }
+            if (output) {
+                std::fclose(output);
+            }
+            return false;
+        }
+
+        bool ok = std::fwrite(header, 1, sizeof(header), output) == sizeof(header);
+        while (ok && (size = std::fread(buffer.data(), 1, buffer.size(), input)) > 0) {
+            ok = std::fwrite(buffer.data(), 1, size, output) == size;
+        }
+
+        std::fclose(input);
+        return std::fclose(output) == 0 && ok;
+    }
+
+    // Also reports process CPU time per MiB, which is what the kernel side
+    // copy paths save; wall time is mostly the page cache either way.
+    template <typename Function>
+    void runConversion(BenchmarkReport *report, const QString &name, const QJsonObject &parameters,
+                       int mebibytes, Function convert)
+    {
+        std::clock_t cpuTicks = 0;
+        int calls = 0;
+
+        LatencyRecorder recorder;
+        const bool ran = report->run(name, &recorder, [&]() {
+            const std::clock_t start = std::clock();
+            convert();
+            cpuTicks += std::clock() - start;
+            ++calls;
+        });
+        if (!ran) {
+            return;
+        }
+
+        const double cpuMilliseconds = 1000.0 * static_cast<double>(cpuTicks) / CLOCKS_PER_SEC;
+        QJsonObject metrics;
+        metrics.insert(QStringLiteral("cpu_ms_per_mebibyte"), cpuMilliseconds / (static_cast<double>(mebibytes) * calls));
+        report->add(name, parameters, &recorder, mebibytes, QStringLiteral("mebibytes"), metrics);
+    }
+}
+
+void runConversionBenchmarks(BenchmarkReport *report)
+{
+    const QString twoPass = QStringLiteral("pcm_to_wav.two_pass");
+    const struct
+    {
+        const char *name;
+        PcmToWavConverter::CopyMethod method;
+    } methods[] = {
+        {"pcm_to_wav.buffered", PcmToWavConverter::Buffered},
+        {"pcm_to_wav.mmap", PcmToWavConverter::MemoryMap},
+        {"pcm_to_wav.sendfile", PcmToWavConverter::SendFile},
+        {"pcm_to_wav.copy_file_range", PcmToWavConverter::CopyFileRange}
+    };
+
+    bool isAnySelected = report->isSelected(twoPass);
+    for (const auto &method : methods) {
+        isAnySelected = isAnySelected || report->isSelected(QString::fromLatin1(method.name));
+    }
+    if (!isAnySelected) {
+        return;
+    }
+
+    QTemporaryDir directory;
+    if (!directory.isValid()) {
+        return;
+    }
+
+    const int mebibytes = report->options().quick ? 8 : PayloadMebibytes;
+    const QByteArray source = directory.filePath(QStringLiteral("input.pcm")).toLocal8Bit();
+    const QByteArray target = directory.filePath(QStringLiteral("output.wav")).toLocal8Bit();
+
+    {
+        FILE *file = std::fopen(source.constData(), "wb");
+        if (!file) {
+            return;
+        }
+        const std::vector<char> chunk(1024 * 1024, 0x11);
+        for (int i = 0; i < mebibytes; ++i) {
+            std::fwrite(chunk.data(), 1, chunk.size(), file);
+        }
+        std::fclose(file);
+    }
+
+    QJsonObject parameters;
+    parameters.insert(QStringLiteral("payload_bytes"), static_cast<double>(mebibytes) * 1024 * 1024);
+
+    runConversion(report, twoPass, parameters, mebibytes, [&]() { convertTwoPass(source, target); });
+
+    const std::string sourcePath = source.toStdString();
+    const std::string targetPath = target.toStdString();
+    for (const auto &method : methods) {
+        const QString name = QString::fromLatin1(method.name);
+        if (!report->isSelected(name)) {
+            continue;
+        }
+
+        // A forced method falls back to Buffered where the kernel or file
+        // system does not support it; that would only measure Buffered
+        // again under another name.
+        PcmToWavConverter converter;
+        converter.setCopyMethod(method.method);
+        if (!converter.convert(sourcePath, targetPath) || converter.copyMethodUsed() != method.method) {
+            continue;
+        }
+
+        runConversion(report, name, parameters, mebibytes, [&]() {
+            converter.convert(sourcePath, targetPath);
+        });
+    }
+}
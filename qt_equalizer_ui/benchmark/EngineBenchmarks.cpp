@@ -0,0 +1,443 @@
+#include "Benchmark.h"
+
+#include "BiquadKernels.h"
+#include "BlockPipeline.h"
+#include "EqualizerEngine.h"
+#include "FrequencyResponse.h"
+#include "PipelineStages.h"
+#include "Resampler.h"
+#include "SampleConversion.h"
+#include "SpectrumAnalyzer.h"
+#include "StreamEngine.h"
+
+#include <QPair>
+#include <QVector>
+
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // The "Rock" preset on this build's band layout, with any band that
+    // lands on 0 dB nudged off it so every section is active.
+    const int *benchmarkGains()
+    {
+        static const struct Gains
+        {
+            int values[EqualizerEngine::BandCount];
+
+            Gains()
+            {
+                const int rock[] = {-1, 3, 5, 4, 1, -1, -2, -1, 2, 4};
+                EqualizerBands::resample(rock, 10, values);
+                for (int &gain : values) {
+                    if (gain == 0) {
+                        gain = 1;
+                    }
+                }
+            }
+        } gains;
+
+        return gains.values;
+    }
+
+    QVector<float> makeNoise(int sampleCount)
+    {
+        std::mt19937 generator(1234);
+        std::uniform_real_distribution<float> distribution(-0.5f, 0.5f);
+
+        QVector<float> samples(sampleCount);
+        for (float &sample : samples) {
+            sample = distribution(generator);
+        }
+        return samples;
+    }
+
+    // With oversampling above 1 the upper bands run at that multiple of the
+    // rate, and every block goes through the half-band filters.
+    void runProcess(BenchmarkReport *report, BiquadKernels::Isa isa, double sampleRate, int channels, int blockFrames,
+                    int oversampling = 1)
+    {
+        const QString name = QStringLiteral("engine.process");
+
+        EqualizerEngine engine(sampleRate, channels, isa);
+        engine.setOversampling(oversampling);
+        engine.setBandGains(benchmarkGains(), EqualizerEngine::BandCount);
+
+        const QVector<float> source = makeNoise(blockFrames * channels);
+        QVector<float> block = source;
+
+        LatencyRecorder recorder;
+        const bool ran = report->run(name, &recorder, [&]() {
+            // Refill so the filters see a signal rather than a decaying tail.
+            std::copy(source.constBegin(), source.constEnd(), block.begin());
+            engine.process(block.data(), blockFrames);
+        });
+        if (!ran) {
+            return;
+        }
+
+        QJsonObject parameters;
+        parameters.insert(QStringLiteral("isa"), QString::fromLatin1(BiquadKernels::isaName(engine.isa())));
+        parameters.insert(QStringLiteral("sample_rate"), sampleRate);
+        parameters.insert(QStringLiteral("channels"), channels);
+        parameters.insert(QStringLiteral("block_frames"), blockFrames);
+        parameters.insert(QStringLiteral("bands"), EqualizerEngine::BandCount);
+        parameters.insert(QStringLiteral("oversampling"), engine.oversampling());
+        report->add(name, parameters, &recorder, static_cast<double>(blockFrames) * channels, QStringLiteral("samples"));
+    }
+
+    // int16 in, int16 out through the engine alone. "fixed_point" is the
+    // engine's own 16-bit path; "float" converts around the float cascade,
+    // which is what a BlockPipeline with only the equaliser would do.
+    void runProcessInt16(BenchmarkReport *report, BiquadKernels::Isa isa, bool fixedPoint, int channels, int blockFrames)
+    {
+        const QString name = QStringLiteral("engine.process_int16");
+        if (!report->isSelected(name)) {
+            return;
+        }
+
+        const double sampleRate = 48000.0;
+        EqualizerEngine engine(sampleRate, channels, isa);
+        engine.setBandGains(benchmarkGains(), EqualizerEngine::BandCount);
+        BlockPipeline<EqualizerStage> pipeline(SampleInt16, SampleInt16, channels, EqualizerStage(&engine));
+
+        const size_t samples = static_cast<size_t>(blockFrames) * channels;
+        const QVector<float> noise = makeNoise(static_cast<int>(samples));
+        std::vector<std::int16_t> input(samples);
+        SampleConversion::fromFloat(SampleInt16, noise.constData(), input.data(), samples);
+        std::vector<std::int16_t> output(samples);
+
+        LatencyRecorder recorder;
+        report->run(name, &recorder, [&]() {
+            if (fixedPoint) {
+                engine.process(input.data(), output.data(), blockFrames);
+            } else {
+                pipeline.process(input.data(), output.data(), blockFrames);
+            }
+        });
+
+        QJsonObject parameters;
+        parameters.insert(QStringLiteral("path"), fixedPoint ? QStringLiteral("fixed_point") : QStringLiteral("float"));
+        parameters.insert(QStringLiteral("isa"), QString::fromLatin1(BiquadKernels::isaName(
+                                                                          fixedPoint ? engine.fixedPointIsa() : engine.isa())));
+        parameters.insert(QStringLiteral("sample_rate"), sampleRate);
+        parameters.insert(QStringLiteral("channels"), channels);
+        parameters.insert(QStringLiteral("block_frames"), blockFrames);
+        parameters.insert(QStringLiteral("bands"), EqualizerEngine::BandCount);
+        report->add(name, parameters, &recorder, static_cast<double>(samples), QStringLiteral("samples"));
+    }
+
+    // A stream that has gone quiet: noise followed by digital silence, in
+    // blocks. Reports how much of the tail skipped the cascade.
+    void runSilence(BenchmarkReport *report, BiquadKernels::Isa isa, int blockFrames)
+    {
+        const QString name = QStringLiteral("engine.process_silence");
+        if (!report->isSelected(name)) {
+            return;
+        }
+
+        const double sampleRate = 48000.0;
+        const int channels = 2;
+        EqualizerEngine engine(sampleRate, channels, isa);
+        engine.setBandGains(benchmarkGains(), EqualizerEngine::BandCount);
+
+        QVector<float> block = makeNoise(blockFrames * channels);
+        engine.process(block.data(), blockFrames);
+
+        LatencyRecorder recorder;
+        report->run(name, &recorder, [&]() {
+            std::fill(block.begin(), block.end(), 0.0f);
+            engine.process(block.data(), blockFrames);
+        });
+
+        QJsonObject parameters;
+        parameters.insert(QStringLiteral("isa"), QString::fromLatin1(BiquadKernels::isaName(engine.isa())));
+        parameters.insert(QStringLiteral("sample_rate"), sampleRate);
+        parameters.insert(QStringLiteral("channels"), channels);
+        parameters.insert(QStringLiteral("block_frames"), blockFrames);
+        parameters.insert(QStringLiteral("bands"), EqualizerEngine::BandCount);
+
+        QJsonObject metrics;
+        metrics.insert(QStringLiteral("silent_block_share"),
+                       engine.blockCount() > 0 ? static_cast<double>(engine.silentBlockCount()) / engine.blockCount() : 0.0);
+        report->add(name, parameters, &recorder, static_cast<double>(blockFrames) * channels,
+                    QStringLiteral("samples"), metrics);
+    }
+
+    // One drag step on the response curve: one band changes and the total
+    // is patched, as EqualizerCurveWidget does before repainting.
+    void runResponse(BenchmarkReport *report, int pointCount)
+    {
+        const QString name = QStringLiteral("response.set_band_gain");
+        if (!report->isSelected(name)) {
+            return;
+        }
+
+        FrequencyResponse response(48000.0, pointCount,
+                                   EqualizerEngine::bandFrequency(0),
+                                   EqualizerEngine::bandFrequency(EqualizerEngine::BandCount - 1));
+        response.setBandGains(benchmarkGains(), EqualizerEngine::BandCount);
+
+        int step = 0;
+        LatencyRecorder recorder;
+        report->run(name, &recorder, [&]() {
+            response.setBandGain(step % FrequencyResponse::BandCount, (step % 25) - 12);
+            ++step;
+        });
+
+        QJsonObject parameters;
+        parameters.insert(QStringLiteral("points"), pointCount);
+        parameters.insert(QStringLiteral("bands"), FrequencyResponse::BandCount);
+        report->add(name, parameters, &recorder, 1.0, QStringLiteral("updates"));
+    }
+
+    // One display frame of the spectrum overlay: 16 ms of new audio and a
+    // 4096 point analysis, as SpectrumWorker runs it 60 times a second.
+    void runSpectrum(BenchmarkReport *report)
+    {
+        const QString name = QStringLiteral("spectrum.analyze");
+        if (!report->isSelected(name)) {
+            return;
+        }
+
+        const double sampleRate = 48000.0;
+        const int frameSamples = 800;
+        SpectrumAnalyzer analyzer(sampleRate, 4096, 128,
+                                  EqualizerEngine::bandFrequency(0),
+                                  EqualizerEngine::bandFrequency(EqualizerEngine::BandCount - 1));
+        const QVector<float> source = makeNoise(frameSamples);
+
+        LatencyRecorder recorder;
+        report->run(name, &recorder, [&]() {
+            analyzer.push(source.constData(), frameSamples);
+            analyzer.analyze(1.0 / 60.0);
+        });
+
+        QJsonObject parameters;
+        parameters.insert(QStringLiteral("sample_rate"), sampleRate);
+        parameters.insert(QStringLiteral("fft_size"), analyzer.fftSize());
+        parameters.insert(QStringLiteral("points"), analyzer.pointCount());
+        report->add(name, parameters, &recorder, 1.0, QStringLiteral("frames"));
+    }
+
+    // One iteration feeds one block to every stream and waits for all of
+    // them, i.e. one block period of a server carrying streamCount calls, of
+    // which the first bypassedPercent are bypassed.
+    void runStreams(BenchmarkReport *report, BiquadKernels::Isa isa, int streamCount, int bypassedPercent)
+    {
+        const QString name = QStringLiteral("stream_engine.process");
+        if (!report->isSelected(name)) {
+            return;
+        }
+
+        const double sampleRate = 16000.0;
+        StreamEngine engine(streamCount, 320, 0, isa);
+        const int blockFrames = engine.blockFrames();
+        QVector<int> streams;
+        for (int i = 0; i < streamCount; ++i) {
+            const int stream = engine.addStream(sampleRate, 1);
+            engine.setBandGains(stream, benchmarkGains(), EqualizerEngine::BandCount);
+            engine.setBypassed(stream, i * 100 < streamCount * bypassedPercent);
+            streams.append(stream);
+        }
+
+        const QVector<float> source = makeNoise(blockFrames);
+        QVector<float> output(blockFrames);
+
+        LatencyRecorder recorder;
+        report->run(name, &recorder, [&]() {
+            for (int stream : streams) {
+                engine.write(stream, source.constData(), blockFrames);
+            }
+            engine.waitForIdle();
+            for (int stream : streams) {
+                engine.read(stream, output.data(), blockFrames);
+            }
+        });
+
+        const StreamEngineStatistics statistics = engine.statistics();
+        QJsonObject parameters;
+        parameters.insert(QStringLiteral("isa"), QString::fromLatin1(BiquadKernels::isaName(engine.isa())));
+        parameters.insert(QStringLiteral("streams"), streamCount);
+        parameters.insert(QStringLiteral("bypassed_percent"), bypassedPercent);
+        parameters.insert(QStringLiteral("threads"), engine.threadCount());
+        parameters.insert(QStringLiteral("block_frames"), blockFrames);
+        parameters.insert(QStringLiteral("sample_rate"), sampleRate);
+
+        QJsonObject metrics;
+        metrics.insert(QStringLiteral("realtime_streams_per_core"), statistics.realTimeFactor());
+        metrics.insert(QStringLiteral("group_runs"), static_cast<double>(statistics.groupRuns));
+        metrics.insert(QStringLiteral("steals"), static_cast<double>(statistics.steals));
+        metrics.insert(QStringLiteral("silent_blocks"), static_cast<double>(statistics.silentBlocks));
+        report->add(name, parameters, &recorder, static_cast<double>(blockFrames) * streamCount,
+                    QStringLiteral("samples"), metrics);
+    }
+
+    // int16 in, int16 out through EQ, limiter and dither, as the renderer
+    // runs it. "fused" is the BlockPipeline; "separate_passes" makes one pass
+    // over the whole buffer per stage, the way the stages would be chained
+    // without it. The buffer is sized well past L2 so the difference is the
+    // memory traffic between stages.
+    void runPipeline(BenchmarkReport *report, bool fused, int seconds)
+    {
+        const QString name = fused ? QStringLiteral("pipeline.fused") : QStringLiteral("pipeline.separate_passes");
+        if (!report->isSelected(name)) {
+            return;
+        }
+
+        const double sampleRate = 48000.0;
+        const int channels = 2;
+        const int frames = static_cast<int>(sampleRate) * seconds;
+        const size_t samples = static_cast<size_t>(frames) * channels;
+
+        const QVector<float> noise = makeNoise(static_cast<int>(samples));
+        std::vector<std::int16_t> input(samples);
+        SampleConversion::fromFloat(SampleInt16, noise.constData(), input.data(), samples);
+        std::vector<std::int16_t> output(samples);
+        std::vector<float> buffer(fused ? 0 : samples);
+
+        EqualizerEngine engine(sampleRate, channels);
+        engine.setBandGains(benchmarkGains(), EqualizerEngine::BandCount);
+        BlockPipeline<EqualizerStage, PeakLimiter, TpdfDither> pipeline(
+                    SampleInt16, SampleInt16, channels,
+                    EqualizerStage(&engine), PeakLimiter(sampleRate, channels), TpdfDither(SampleInt16, channels));
+        PeakLimiter limiter(sampleRate, channels);
+        TpdfDither dither(SampleInt16, channels);
+
+        LatencyRecorder recorder;
+        report->run(name, &recorder, [&]() {
+            if (fused) {
+                pipeline.process(input.data(), output.data(), frames);
+                return;
+            }
+            SampleConversion::toFloat(SampleInt16, input.data(), buffer.data(), samples);
+            engine.process(buffer.data(), frames);
+            limiter.process(buffer.data(), frames);
+            dither.process(buffer.data(), frames);
+            SampleConversion::fromFloat(SampleInt16, buffer.data(), output.data(), samples);
+        });
+
+        QJsonObject parameters;
+        parameters.insert(QStringLiteral("isa"), QString::fromLatin1(BiquadKernels::isaName(engine.isa())));
+        parameters.insert(QStringLiteral("sample_rate"), sampleRate);
+        parameters.insert(QStringLiteral("channels"), channels);
+        parameters.insert(QStringLiteral("buffer_frames"), frames);
+        report->add(name, parameters, &recorder, static_cast<double>(samples), QStringLiteral("samples"));
+    }
+    // int16 in, int16 out through a rate conversion, alone ("engine.resample")
+    // or fused with the equaliser at the output rate ("pipeline.resample_eq")
+    // as the renderer runs it. Throughput is counted in input samples.
+    void runResample(BenchmarkReport *report, BiquadKernels::Isa isa, int inputRate, int outputRate, bool equalise)
+    {
+        const QString name = equalise ? QStringLiteral("pipeline.resample_eq") : QStringLiteral("engine.resample");
+        if (!report->isSelected(name)) {
+            return;
+        }
+
+        const int channels = 2;
+        const int frames = 4096;
+        const size_t samples = static_cast<size_t>(frames) * channels;
+
+        const QVector<float> noise = makeNoise(static_cast<int>(samples));
+        std::vector<std::int16_t> input(samples);
+        SampleConversion::fromFloat(SampleInt16, noise.constData(), input.data(), samples);
+
+        EqualizerEngine engine(outputRate, channels, isa);
+        engine.setBandGains(benchmarkGains(), EqualizerEngine::BandCount);
+        const Resampler resampler(inputRate, outputRate, channels, isa);
+        BlockPipeline<Resampler> conversion(SampleInt16, SampleInt16, channels, resampler);
+        BlockPipeline<Resampler, EqualizerStage> pipeline(SampleInt16, SampleInt16, channels, resampler,
+                                                          EqualizerStage(&engine));
+        std::vector<std::int16_t> output(static_cast<size_t>(std::max(conversion.maximumOutputFrames(frames),
+                                                                      pipeline.maximumOutputFrames(frames)))
+                                         * channels);
+
+        LatencyRecorder recorder;
+        report->run(name, &recorder, [&]() {
+            if (equalise) {
+                pipeline.process(input.data(), output.data(), frames);
+            } else {
+                conversion.process(input.data(), output.data(), frames);
+            }
+        });
+
+        QJsonObject parameters;
+        parameters.insert(QStringLiteral("isa"), QString::fromLatin1(BiquadKernels::isaName(resampler.isa())));
+        parameters.insert(QStringLiteral("input_rate"), inputRate);
+        parameters.insert(QStringLiteral("output_rate"), outputRate);
+        parameters.insert(QStringLiteral("channels"), channels);
+        parameters.insert(QStringLiteral("block_frames"), frames);
+        if (equalise) {
+            parameters.insert(QStringLiteral("bands"), EqualizerEngine::BandCount);
+        }
+        report->add(name, parameters, &recorder, static_cast<double>(samples), QStringLiteral("samples"));
+    }
+}
+
+void runEngineBenchmarks(BenchmarkReport *report)
+{
+    const bool quick = report->options().quick;
+
+    const QVector<int> blockSizes = quick ? QVector<int>{256} : QVector<int>{32, 64, 128, 256, 512, 1024};
+    const QVector<int> channelCounts = quick ? QVector<int>{2} : QVector<int>{1, 2, 8};
+    const QVector<double> sampleRates = quick ? QVector<double>{48000.0} : QVector<double>{44100.0, 48000.0, 96000.0};
+
+    for (BiquadKernels::Isa isa : {BiquadKernels::Scalar, BiquadKernels::Sse2, BiquadKernels::Avx2, BiquadKernels::Avx512}) {
+        if (!BiquadKernels::isSupported(isa)) {
+            continue;
+        }
+
+        for (double sampleRate : sampleRates) {
+            for (int channels : channelCounts) {
+                for (int blockFrames : blockSizes) {
+                    runProcess(report, isa, sampleRate, channels, blockFrames);
+                }
+            }
+        }
+
+        // Against the oversampling 1 runs above at the same rate, stereo and
+        // 256 frames.
+        for (double sampleRate : quick ? QVector<double>{48000.0} : QVector<double>{44100.0, 48000.0}) {
+            for (int oversampling : {2, 4}) {
+                runProcess(report, isa, sampleRate, 2, 256, oversampling);
+            }
+        }
+
+        runSilence(report, isa, 256);
+
+        for (int channels : channelCounts) {
+            for (bool fixedPoint : {true, false}) {
+                runProcessInt16(report, isa, fixedPoint, channels, 256);
+            }
+        }
+
+        const QVector<QPair<int, int>> ratePairs = quick
+                ? QVector<QPair<int, int>>{qMakePair(44100, 48000)}
+                : QVector<QPair<int, int>>{qMakePair(8000, 48000), qMakePair(22050, 16000), qMakePair(44100, 48000),
+                                           qMakePair(48000, 44100), qMakePair(48000, 8000)};
+        for (const QPair<int, int> &rates : ratePairs) {
+            for (bool equalise : {false, true}) {
+                runResample(report, isa, rates.first, rates.second, equalise);
+            }
+        }
+
+        const QVector<int> streamCounts = quick ? QVector<int>{256} : QVector<int>{64, 1024, 4096};
+        for (int streamCount : streamCounts) {
+            for (int bypassedPercent : {0, 90}) {
+                runStreams(report, isa, streamCount, bypassedPercent);
+            }
+        }
+    }
+
+    runSpectrum(report);
+    for (int pointCount : quick ? QVector<int>{256} : QVector<int>{256, 1024}) {
+        runResponse(report, pointCount);
+    }
+
+    runPipeline(report, true, quick ? 1 : 10);
+    runPipeline(report, false, quick ? 1 : 10);
+}
@@ -0,0 +1,89 @@
+#include "Benchmark.h"
+
+#include "PresetManager.h"
+
+#include <random>
+
+namespace
+{
+    // Adds presetCount random presets to the built-in ones. Gains cluster
+    // around a handful of shapes, as real libraries do.
+    void fillLibrary(PresetManager *presets, int presetCount)
+    {
+        std::mt19937 generator(42);
+        std::uniform_int_distribution<int> shape(1, presets->presetCount() - 1);
+        std::uniform_int_distribution<int> jitter(-3, 3);
+
+        QVector<int> values(PresetManager::BandCount);
+        for (int i = 0; i < presetCount; ++i) {
+            const QVector<int> base = presets->presetValues(presets->presetName(shape(generator)));
+            for (int band = 0; band < PresetManager::BandCount; ++band) {
+                values[band] = base.at(band) + jitter(generator);
+            }
+            presets->addPreset(QStringLiteral("Preset %1").arg(i), values);
+        }
+    }
+
+    // Queries are library presets with one band nudged, like the state
+    // during a drag that started from a preset.
+    QVector<int> makeQueries(const PresetManager &presets, int queryCount)
+    {
+        std::mt19937 generator(7);
+        std::uniform_int_distribution<int> pick(0, presets.presetCount() - 1);
+        std::uniform_int_distribution<int> band(0, PresetManager::BandCount - 1);
+
+        QVector<int> queries;
+        queries.reserve(queryCount * PresetManager::BandCount);
+        for (int i = 0; i < queryCount; ++i) {
+            const QVector<int> values = presets.presetValues(presets.presetName(pick(generator)));
+            const int nudged = band(generator);
+            for (int j = 0; j < PresetManager::BandCount; ++j) {
+                queries.append(values.at(j) + (j == nudged && i % 2 ? 1 : 0));
+            }
+        }
+        return queries;
+    }
+
+    void runLookup(BenchmarkReport *report, bool nearest, int presetCount)
+    {
+        const QString name = nearest ? QStringLiteral("presets.nearest") : QStringLiteral("presets.find_exact");
+        if (!report->isSelected(name)) {
+            return;
+        }
+
+        PresetManager presets;
+        fillLibrary(&presets, presetCount);
+
+        const int queryCount = 1024;
+        const QVector<int> queries = makeQueries(presets, queryCount);
+        // Builds the tree outside the timed loop.
+        presets.nearestPreset(queries.constData(), PresetManager::BandCount);
+
+        int query = 0;
+        int found = 0;
+        LatencyRecorder recorder;
+        report->run(name, &recorder, [&]() {
+            const int *values = queries.constData() + (query++ % queryCount) * PresetManager::BandCount;
+            const int index = nearest ? presets.nearestPreset(values, PresetManager::BandCount)
+                                      : presets.findPreset(values, PresetManager::BandCount);
+            found += index >= 0 ? 1 : 0;
+        });
+
+        QJsonObject parameters;
+        parameters.insert(QStringLiteral("presets"), presets.presetCount());
+
+        QJsonObject metrics;
+        metrics.insert(QStringLiteral("hit_share"), query > 0 ? static_cast<double>(found) / query : 0.0);
+        report->add(name, parameters, &recorder, 1.0, QStringLiteral("lookups"), metrics);
+    }
+}
+
+void runPresetBenchmarks(BenchmarkReport *report)
+{
+    const bool quick = report->options().quick;
+
+    for (int presetCount : quick ? QVector<int>{10000} : QVector<int>{1000, 10000, 50000}) {
+        runLookup(report, false, presetCount);
+        runLookup(report, true, presetCount);
+    }
+}
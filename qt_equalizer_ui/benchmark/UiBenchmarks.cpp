@@ -0,0 +1,129 @@
+#include "Benchmark.h"
+
+#include "EqualizerCurveWidget.h"
+#include "MainWindow.h"
+
+#include <QCoreApplication>
+#include <QImage>
+#include <QMetaObject>
+#include <QSlider>
+
+namespace
+{
+    QJsonObject paintMetrics(const EqualizerCurveWidget *curve)
+    {
+        QJsonObject metrics;
+        metrics.insert(QStringLiteral("paints"), curve->paintCount());
+        metrics.insert(QStringLiteral("mean_paint_us"),
+                       curve->paintCount() > 0 ? curve->paintNanoseconds() / 1000.0 / curve->paintCount() : 0.0);
+        return metrics;
+    }
+
+    // Renders the whole widget every frame: the cost of a full repaint.
+    void runCurvePaint(BenchmarkReport *report, EqualizerCurveWidget *curve)
+    {
+        const QString name = QStringLiteral("ui.curve_paint");
+
+        QImage image(curve->size() * curve->devicePixelRatioF(), QImage::Format_ARGB32_Premultiplied);
+        image.setDevicePixelRatio(curve->devicePixelRatioF());
+
+        int step = 0;
+        curve->resetPaintStatistics();
+        LatencyRecorder recorder;
+        const bool ran = report->run(name, &recorder, [&]() {
+            // Change one band per frame, like a drag does, then repaint.
+            curve->setBandValue(step % EqualizerCurveWidget::BandCount, (step % 25) - 12);
+            ++step;
+            curve->render(&image);
+        });
+        if (!ran) {
+            return;
+        }
+
+        QJsonObject parameters;
+        parameters.insert(QStringLiteral("width"), curve->width());
+        parameters.insert(QStringLiteral("height"), curve->height());
+        report->add(name, parameters, &recorder, 1.0, QStringLiteral("frames"), paintMetrics(curve));
+    }
+
+    // A drag step as the window system sees it: the band changes and the
+    // pending update is flushed, so only the dirty strip is repainted.
+    void runCurveDrag(BenchmarkReport *report, EqualizerCurveWidget *curve)
+    {
+        const QString name = QStringLiteral("ui.curve_drag_repaint");
+
+        int step = 0;
+        curve->resetPaintStatistics();
+        LatencyRecorder recorder;
+        const bool ran = report->run(name, &recorder, [&]() {
+            curve->setBandValue(step % EqualizerCurveWidget::BandCount, (step % 25) - 12);
+            ++step;
+            QCoreApplication::processEvents();
+        });
+        if (!ran) {
+            return;
+        }
+
+        QJsonObject parameters;
+        parameters.insert(QStringLiteral("width"), curve->width());
+        parameters.insert(QStringLiteral("height"), curve->height());
+        report->add(name, parameters, &recorder, 1.0, QStringLiteral("frames"), paintMetrics(curve));
+    }
+
+    void runHandleBandValueChanged(BenchmarkReport *report, MainWindow *window)
+    {
+        const QString name = QStringLiteral("ui.handle_band_value_changed");
+
+        LatencyRecorder recorder;
+        const bool ran = report->run(name, &recorder, [&]() {
+            QMetaObject::invokeMethod(window, "handleBandValuesChanged", Qt::DirectConnection);
+        });
+        if (!ran) {
+            return;
+        }
+
+        report->add(name, QJsonObject(), &recorder, 1.0, QStringLiteral("calls"));
+    }
+
+    // Full signal chain of a drag step: slider -> value label -> curve ->
+    // engine, with MainWindow's preset matching batched to once per frame.
+    void runBandChangeChain(BenchmarkReport *report, MainWindow *window)
+    {
+        const QString name = QStringLiteral("ui.band_change_chain");
+
+        QSlider *slider = window->findChild<QSlider *>(QStringLiteral("sliderBand3"));
+        if (!slider) {
+            if (report->isSelected(name)) {
+                report->addError(name, QStringLiteral("no slider named sliderBand3"));
+            }
+            return;
+        }
+
+        int step = 0;
+        LatencyRecorder recorder;
+        const bool ran = report->run(name, &recorder, [&]() {
+            slider->setValue((step++ % 25) - 12);
+        });
+        if (!ran) {
+            return;
+        }
+
+        report->add(name, QJsonObject(), &recorder, 1.0, QStringLiteral("changes"));
+    }
+}
+
+void runUiBenchmarks(BenchmarkReport *report)
+{
+    MainWindow window;
+    window.resize(960, 540);
+    window.show();
+    QCoreApplication::processEvents();
+
+    if (EqualizerCurveWidget *curve = window.findChild<EqualizerCurveWidget *>()) {
+        runCurvePaint(report, curve);
+        runCurveDrag(report, curve);
+    }
+
+    runHandleBandValueChanged(report, &window);
+    runBandChangeChain(report, &window);
+}
@@ -0,0 +1,23 @@
+QT += widgets
+
+CONFIG += c++14 console
+CONFIG -= app_bundle
+
+TEMPLATE = app
+TARGET = equalizer-benchmark
+
+SOURCES += \
+    main.cpp \
+    Benchmark.cpp \
+    EngineBenchmarks.cpp \
+    ConversionBenchmarks.cpp \
+    UiBenchmarks.cpp \
+    PresetBenchmarks.cpp
+
+HEADERS += \
+    Benchmark.h
+
+include(../engine.pri)
+include(../wav.pri)
+include(../presets.pri)
+include(../widgets.pri)
@@ -0,0 +1,93 @@
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QFile>
+#include <QJsonDocument>
+#include <QSysInfo>
+#include <QTextStream>
+#include <QThread>
+
+#include "Benchmark.h"
+#include "BiquadKernels.h"
+
+namespace
+{
+    QJsonObject hostDescription()
+    {
+        QJsonObject host;
+        host.insert(QStringLiteral("cpu_architecture"), QSysInfo::currentCpuArchitecture());
+        host.insert(QStringLiteral("kernel"), QSysInfo::kernelType() + QLatin1Char(' ') + QSysInfo::kernelVersion());
+        host.insert(QStringLiteral("product"), QSysInfo::prettyProductName());
+        host.insert(QStringLiteral("hostname"), QSysInfo::machineHostName());
+        host.insert(QStringLiteral("ideal_threads"), QThread::idealThreadCount());
+        host.insert(QStringLiteral("isa"), QString::fromLatin1(BiquadKernels::isaName(BiquadKernels::hostIsa())));
+        host.insert(QStringLiteral("qt_version"), QString::fromLatin1(qVersion()));
+        return host;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // The UI cases render into images; they must not need a display server.
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("equalizer-benchmark"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Equalizer performance benchmarks, reported as JSON."));
+    parser.addHelpOption();
+
+    const QCommandLineOption outputOption(QStringList() << QStringLiteral("o") << QStringLiteral("output"),
+                                          QStringLiteral("Write the report to <file> instead of stdout."),
+                                          QStringLiteral("file"));
+    const QCommandLineOption filterOption(QStringList() << QStringLiteral("f") << QStringLiteral("filter"),
+                                          QStringLiteral("Only run cases whose name contains <text>."),
+                                          QStringLiteral("text"));
+    const QCommandLineOption timeOption(QStringLiteral("min-time"),
+                                        QStringLiteral("Minimum measuring time per case in milliseconds (default 200)."),
+                                        QStringLiteral("ms"), QStringLiteral("200"));
+    const QCommandLineOption quickOption(QStringLiteral("quick"),
+                                         QStringLiteral("Run a reduced parameter matrix."));
+    parser.addOption(outputOption);
+    parser.addOption(filterOption);
+    parser.addOption(timeOption);
+    parser.addOption(quickOption);
+    parser.process(app);
+
+    BenchmarkOptions options;
+    options.minimumTimeNs = qMax(1, parser.value(timeOption).toInt()) * Q_INT64_C(1000000);
+    options.filter = parser.value(filterOption);
+    options.quick = parser.isSet(quickOption);
+
+    BenchmarkReport report(options);
+    runEngineBenchmarks(&report);
+    runConversionBenchmarks(&report);
+    runUiBenchmarks(&report);
+    runPresetBenchmarks(&report);
+
+    QJsonObject json = report.toJson();
+    json.insert(QStringLiteral("host"), hostDescription());
+    json.insert(QStringLiteral("timestamp"), QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+    const QByteArray text = QJsonDocument(json).toJson(QJsonDocument::Indented);
+
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(text) != text.size()) {
+            QTextStream(stderr) << "Cannot write " << file.fileName() << ": " << file.errorString() << '\n';
+            return 1;
+        }
+    } else {
+        QTextStream(stdout) << text;
+    }
+
+    // Cases that could not run are reported rather than left out silently.
+    const QStringList errors = report.errors();
+    QTextStream err(stderr);
+    for (const QString &error : errors) {
+        err << error << '\n';
+    }
+    return errors.isEmpty() ? 0 : 1;
+}
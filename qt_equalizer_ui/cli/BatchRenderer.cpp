@@ -0,0 +1,113 @@
+#include "BatchRenderer.h"
+
+#include "WavFileIo.h"
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+
+BatchRenderer::BatchRenderer(const RenderSettings &settings, int threadCount)
+    : m_settings(settings)
+    , m_threadCount(threadCount > 0 ? threadCount : static_cast<int>(std::max(1u, std::thread::hardware_concurrency())))
+    , m_usedThreadCount(0)
+    , m_taskCount(0)
+    , m_stealCount(0)
+{
+}
+
+void BatchRenderer::addJob(const std::string &sourcePath, const std::string &targetPath, std::uint64_t size)
+{
+    m_jobs.push_back({sourcePath, targetPath, size});
+}
+
+int BatchRenderer::jobCount() const
+{
+    return static_cast<int>(m_jobs.size());
+}
+
+bool BatchRenderer::run()
+{
+    m_statistics = RenderStatistics();
+    m_errors.clear();
+
+    // Largest first, so a long recording does not start last and hold up the
+    // end of the run.
+    std::stable_sort(m_jobs.begin(), m_jobs.end(), [](const Job &a, const Job &b) {
+        return a.size > b.size;
+    });
+
+    std::vector<std::vector<const Job *>> batches;
+    std::uint64_t batchSize = BatchBytes;
+    for (const Job &job : m_jobs) {
+        if (batchSize >= BatchBytes || batches.back().size() >= static_cast<size_t>(MaximumBatchFiles)) {
+            batches.emplace_back();
+            batchSize = 0;
+        }
+        batches.back().push_back(&job);
+        batchSize += job.size;
+    }
+    m_taskCount = static_cast<int>(batches.size());
+
+    const int threadCount = std::min(m_threadCount, std::max(1, m_taskCount));
+    m_usedThreadCount = threadCount;
+    std::vector<std::unique_ptr<OfflineRenderer>> renderers;
+    std::vector<std::vector<std::string>> errors(static_cast<size_t>(threadCount));
+    for (int i = 0; i < threadCount; ++i) {
+        renderers.emplace_back(new OfflineRenderer(m_settings));
+    }
+
+    {
+        WorkStealingPool pool(threadCount);
+        for (const std::vector<const Job *> &batch : batches) {
+            pool.submit([&pool, &renderers, &errors, &batch] {
+                const size_t worker = static_cast<size_t>(pool.currentWorker());
+                OfflineRenderer &renderer = *renderers[worker];
+
+                WavFileIo::prefetch(batch.front()->sourcePath);
+                for (size_t i = 0; i < batch.size(); ++i) {
+                    if (i + 1 < batch.size()) {
+                        WavFileIo::prefetch(batch[i + 1]->sourcePath);
+                    }
+                    if (!renderer.render(batch[i]->sourcePath, batch[i]->targetPath)) {
+                        errors[worker].push_back(renderer.errorString());
+                    }
+                }
+            });
+        }
+        pool.wait();
+        m_stealCount = pool.stealCount();
+    }
+
+    for (int i = 0; i < threadCount; ++i) {
+        m_statistics.add(renderers[static_cast<size_t>(i)]->statistics());
+        m_errors.insert(m_errors.end(), errors[static_cast<size_t>(i)].begin(), errors[static_cast<size_t>(i)].end());
+    }
+
+    return m_errors.empty();
+}
+
+int BatchRenderer::threadCount() const
+{
+    return m_usedThreadCount;
+}
+
+int BatchRenderer::taskCount() const
+{
+    return m_taskCount;
+}
+
+std::uint64_t BatchRenderer::stealCount() const
+{
+    return m_stealCount;
+}
+
+const RenderStatistics &BatchRenderer::statistics() const
+{
+    return m_statistics;
+}
+
+const std::vector<std::string> &BatchRenderer::errors() const
+{
+    return m_errors;
+}
@@ -0,0 +1,60 @@
+#ifndef BATCHRENDERER_H
+#define BATCHRENDERER_H
+
+#include "OfflineRenderer.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Renders a list of files on a WorkStealingPool with one OfflineRenderer per
+// worker. Files are scheduled largest first; files below BatchBytes are
+// grouped into one task until the group reaches BatchBytes, so per-task
+// overhead does not dominate runs over thousands of short TTS clips.
+//
+// I/O overlaps with processing without extra threads: while a worker renders
+// one file, the kernel is already reading the next file of its batch
+// (WavFileIo::prefetch), and writes complete into the page cache and are
+// flushed by write-back in the background.
+class BatchRenderer
+{
+public:
+    // threadCount 0 uses one worker per hardware thread.
+    BatchRenderer(const RenderSettings &settings, int threadCount);
+
+    void addJob(const std::string &sourcePath, const std::string &targetPath, std::uint64_t size);
+    int jobCount() const;
+
+    // True when every job succeeded.
+    bool run();
+
+    // Workers the last run() used: at most one per task.
+    int threadCount() const;
+    int taskCount() const;
+    std::uint64_t stealCount() const;
+    const RenderStatistics &statistics() const;
+    const std::vector<std::string> &errors() const;
+
+private:
+    static const std::uint64_t BatchBytes = 4 * 1024 * 1024;
+    static const int MaximumBatchFiles = 64;
+
+    struct Job
+    {
+        std::string sourcePath;
+        std::string targetPath;
+        std::uint64_t size;
+    };
+
+    RenderSettings m_settings;
+    int m_threadCount;
+    std::vector<Job> m_jobs;
+
+    int m_usedThreadCount;
+    int m_taskCount;
+    std::uint64_t m_stealCount;
+    RenderStatistics m_statistics;
+    std::vector<std::string> m_errors;
+};
+
+#endif // BATCHRENDERER_H
@@ -0,0 +1,332 @@
+#include "OfflineRenderer.h"
+
+#include "PcmToWavConverter.h"
+#include "WavFileIo.h"
+#include "WavReader.h"
+#include "WavWriter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+    bool hasSuffix(const std::string &text, const char *suffix)
+    {
+        const size_t length = std::strlen(suffix);
+        if (text.size() < length) {
+            return false;
+        }
+
+        for (size_t i = 0; i < length; ++i) {
+            const char c = text[text.size() - length + i];
+            if ((c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c) != suffix[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+RenderStatistics::RenderStatistics()
+    : files(0)
+    , frames(0)
+    , bytesRead(0)
+    , bytesWritten(0)
+{
+}
+
+void RenderStatistics::add(const RenderStatistics &other)
+{
+    files += other.files;
+    frames += other.frames;
+    bytesRead += other.bytesRead;
+    bytesWritten += other.bytesWritten;
+}
+
+RenderSettings::RenderSettings()
+    : rawStreams(false)
+    , hasOutputSampleFormat(false)
+    , outputSampleFormat(SampleInt16)
+    , limit(false)
+    , dither(false)
+    , outputSampleRate(0)
+    , oversampling(1)
+{
+    std::fill(gains, gains + EqualizerEngine::BandCount, 0);
+}
+
+OfflineRenderer::OfflineRenderer(const RenderSettings &settings)
+    : m_settings(settings)
+{
+}
+
+void OfflineRenderer::setSettings(const RenderSettings &settings)
+{
+    m_settings = settings;
+    // Rebuilt with the new gains on the next render().
+    m_engine.reset();
+}
+
+const RenderSettings &OfflineRenderer::settings() const
+{
+    return m_settings;
+}
+
+bool OfflineRenderer::render(const std::string &sourcePath, const std::string &targetPath)
+{
+    m_errorString.clear();
+
+    // Opening the writer would truncate the file still being read.
+    if (WavFileIo::isSameFile(sourcePath, targetPath)) {
+        return fail(targetPath + ": output would overwrite its input");
+    }
+
+    const bool rawInput = isRaw(sourcePath);
+    const bool rawOutput = isRaw(targetPath);
+    if (isPassThrough(m_settings, rawInput, rawOutput)) {
+        return convert(sourcePath, targetPath);
+    }
+
+    WavReader reader;
+    std::FILE *rawSource = nullptr;
+    WavFormat inputFormat = m_settings.rawFormat;
+    if (rawInput) {
+        rawSource = WavFileIo::open(sourcePath, "rb");
+        if (!rawSource) {
+            return fail("Cannot open " + sourcePath + ": " + std::strerror(errno));
+        }
+    } else {
+        if (!reader.open(sourcePath)) {
+            return fail(sourcePath + ": " + reader.errorString());
+        }
+        inputFormat = reader.format();
+    }
+
+    WavFormat outputFormat = inputFormat;
+    if (m_settings.hasOutputSampleFormat) {
+        outputFormat.sampleFormat = m_settings.outputSampleFormat;
+    }
+    if (m_settings.outputSampleRate > 0) {
+        outputFormat.sampleRate = static_cast<std::uint32_t>(m_settings.outputSampleRate);
+        if (outputFormat.sampleRate != inputFormat.sampleRate
+                && !Resampler::isSupported(static_cast<int>(inputFormat.sampleRate), m_settings.outputSampleRate)) {
+            WavFileIo::close(rawSource);
+            return fail(sourcePath + ": cannot convert " + std::to_string(inputFormat.sampleRate) + " Hz to "
+                        + std::to_string(outputFormat.sampleRate) + " Hz");
+        }
+    }
+
+    EqualizerEngine *engine = engineFor(outputFormat);
+    if (!engine) {
+        WavFileIo::close(rawSource);
+        return false;
+    }
+
+    WavWriter writer;
+    std::FILE *rawTarget = nullptr;
+    if (rawOutput) {
+        rawTarget = WavFileIo::open(targetPath, "wb");
+    }
+    if (rawOutput ? !rawTarget : !writer.open(targetPath, outputFormat)) {
+        WavFileIo::close(rawSource);
+        return fail("Cannot open " + targetPath + ": "
+                    + (rawOutput ? std::string(std::strerror(errno)) : writer.errorString()));
+    }
+
+    RenderPipeline pipeline = pipelineFor(m_settings, engine, inputFormat, outputFormat.sampleFormat);
+    m_inputBuffer.resize(static_cast<size_t>(BlockFrames) * inputFormat.blockAlign());
+    const int outputFrames = std::max(pipeline.maximumOutputFrames(BlockFrames),
+                                      RenderPipeline::BlockSamples / inputFormat.channels);
+    m_outputBuffer.resize(static_cast<size_t>(outputFrames) * outputFormat.blockAlign());
+
+    RenderStatistics statistics;
+    statistics.files = 1;
+    std::int64_t writtenFrames = 0;
+    bool ok = true;
+    bool isFlushing = false;
+
+    for (;;) {
+        std::int64_t frames = 0;
+        if (!isFlushing) {
+            if (rawInput) {
+                // A trailing partial frame is dropped.
+                frames = static_cast<std::int64_t>(std::fread(m_inputBuffer.data(), inputFormat.blockAlign(), BlockFrames, rawSource));
+                if (frames < BlockFrames && std::ferror(rawSource)) {
+                    ok = fail(sourcePath + ": read failed: " + std::strerror(errno));
+                    break;
+                }
+            } else {
+                frames = reader.readRaw(m_inputBuffer.data(), BlockFrames);
+                if (frames < 0) {
+                    ok = fail(sourcePath + ": " + reader.errorString());
+                    break;
+                }
+            }
+            // At the end of the input the resampler still holds back the
+            // last few milliseconds.
+            isFlushing = frames == 0;
+        }
+
+        const int produced = isFlushing
+                ? pipeline.flush(m_outputBuffer.data())
+                : pipeline.process(m_inputBuffer.data(), m_outputBuffer.data(), static_cast<int>(frames));
+        if (isFlushing && produced == 0) {
+            break;
+        }
+
+        if (rawOutput) {
+            const size_t size = static_cast<size_t>(produced) * outputFormat.blockAlign();
+            if (std::fwrite(m_outputBuffer.data(), 1, size, rawTarget) != size) {
+                ok = fail(targetPath + ": write failed: " + std::strerror(errno));
+                break;
+            }
+        } else if (!writer.writeRaw(m_outputBuffer.data(), produced)) {
+            ok = fail(targetPath + ": " + writer.errorString());
+            break;
+        }
+
+        statistics.frames += frames;
+        writtenFrames += produced;
+    }
+
+    WavFileIo::close(rawSource);
+    if (rawOutput) {
+        if (std::ferror(rawTarget) && ok) {
+            ok = fail(targetPath + ": write failed");
+        }
+        WavFileIo::close(rawTarget);
+    } else if (!writer.close() && ok) {
+        ok = fail(targetPath + ": " + writer.errorString());
+    }
+
+    if (!ok) {
+        return false;
+    }
+
+    statistics.bytesRead = static_cast<std::uint64_t>(statistics.frames) * inputFormat.blockAlign();
+    statistics.bytesWritten = static_cast<std::uint64_t>(writtenFrames) * outputFormat.blockAlign();
+    m_statistics.add(statistics);
+    return true;
+}
+
+const RenderStatistics &OfflineRenderer::statistics() const
+{
+    return m_statistics;
+}
+
+const std::string &OfflineRenderer::errorString() const
+{
+    return m_errorString;
+}
+
+bool OfflineRenderer::isRawPath(const std::string &path)
+{
+    return hasSuffix(path, ".pcm") || hasSuffix(path, ".raw");
+}
+
+bool OfflineRenderer::isPassThrough(const RenderSettings &settings, bool rawInput, bool rawOutput)
+{
+    const WavFormat &format = settings.rawFormat;
+    if (!rawInput || rawOutput || settings.limit || settings.dither || settings.oversampling != 1) {
+        return false;
+    }
+    if ((format.sampleFormat != SampleUInt8 && format.sampleFormat != SampleInt16) || format.channels > 2) {
+        return false;
+    }
+    if ((settings.hasOutputSampleFormat && settings.outputSampleFormat != format.sampleFormat)
+            || (settings.outputSampleRate > 0 && static_cast<std::uint32_t>(settings.outputSampleRate) != format.sampleRate)) {
+        return false;
+    }
+    return std::all_of(settings.gains, settings.gains + EqualizerEngine::BandCount, [](int gain) {
+        return gain == 0;
+    });
+}
+
+RenderPipeline::RenderPipeline(SampleFormat inputFormat, SampleFormat outputFormat, int channels, int inputRate,
+                               EqualizerEngine *engine, std::uint32_t ditherSeed)
+    : BlockPipeline(inputFormat, outputFormat, channels,
+                    Resampler(inputRate, static_cast<int>(engine->sampleRate()), channels),
+                    EqualizerStage(engine),
+                    PeakLimiter(engine->sampleRate(), channels),
+                    TpdfDither(outputFormat, channels, ditherSeed))
+    , m_engine(engine)
+{
+}
+
+bool RenderPipeline::isFixedPoint() const
+{
+    return inputFormat() == SampleInt16 && outputFormat() == SampleInt16
+            && !stage<0>().isActive() && !stage<2>().isEnabled() && !stage<3>().isEnabled();
+}
+
+int RenderPipeline::process(const void *input, void *output, int frameCount)
+{
+    if (isFixedPoint()) {
+        m_engine->process(static_cast<const std::int16_t *>(input), static_cast<std::int16_t *>(output), frameCount);
+        return frameCount;
+    }
+
+    return BlockPipeline::process(input, output, frameCount);
+}
+
+RenderPipeline OfflineRenderer::pipelineFor(const RenderSettings &settings, EqualizerEngine *engine,
+                                            const WavFormat &inputFormat, SampleFormat outputFormat,
+                                            std::uint32_t ditherSeed)
+{
+    RenderPipeline pipeline(inputFormat.sampleFormat, outputFormat, inputFormat.channels,
+                            static_cast<int>(inputFormat.sampleRate), engine, ditherSeed);
+    pipeline.stage<2>().setEnabled(settings.limit);
+    pipeline.stage<3>().setEnabled(settings.dither);
+    return pipeline;
+}
+
+bool OfflineRenderer::isRaw(const std::string &path) const
+{
+    return path == "-" ? m_settings.rawStreams : isRawPath(path);
+}
+
+EqualizerEngine *OfflineRenderer::engineFor(const WavFormat &format)
+{
+    if (format.channels > EqualizerEngine::MaximumChannels) {
+        fail("At most " + std::to_string(EqualizerEngine::MaximumChannels) + " channels are supported, got "
+             + std::to_string(format.channels));
+        return nullptr;
+    }
+
+    if (!m_engine || m_engine->sampleRate() != format.sampleRate || m_engine->channelCount() != format.channels) {
+        m_engine.reset(new EqualizerEngine(format.sampleRate, format.channels));
+        m_engine->setOversampling(m_settings.oversampling);
+        m_engine->setBandGains(m_settings.gains, EqualizerEngine::BandCount);
+    } else {
+        m_engine->reset();
+    }
+
+    return m_engine.get();
+}
+
+bool OfflineRenderer::convert(const std::string &sourcePath, const std::string &targetPath)
+{
+    // The payload is copied as is, kernel side where the platform allows.
+    const WavFormat &format = m_settings.rawFormat;
+    PcmToWavConverter converter;
+    converter.setFormat(format.sampleRate, format.channels, static_cast<std::uint16_t>(8 * format.bytesPerSample()));
+    if (!converter.convert(sourcePath, targetPath)) {
+        return fail(converter.errorString());
+    }
+
+    RenderStatistics statistics;
+    statistics.files = 1;
+    statistics.frames = static_cast<std::int64_t>(converter.dataSize() / format.blockAlign());
+    statistics.bytesRead = converter.dataSize();
+    statistics.bytesWritten = converter.dataSize() + WaveHeader::Size;
+    m_statistics.add(statistics);
+    return true;
+}
+
+bool OfflineRenderer::fail(const std::string &message)
+{
+    m_errorString = message;
+    return false;
+}
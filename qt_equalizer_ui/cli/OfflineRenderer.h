@@ -0,0 +1,125 @@
+#ifndef OFFLINERENDERER_H
+#define OFFLINERENDERER_H
+
+#include "BlockPipeline.h"
+#include "EqualizerEngine.h"
+#include "PipelineStages.h"
+#include "Resampler.h"
+#include "WavFormat.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct RenderStatistics
+{
+    std::int64_t files;
+    std::int64_t frames;
+    std::uint64_t bytesRead;
+    std::uint64_t bytesWritten;
+
+    RenderStatistics();
+
+    void add(const RenderStatistics &other);
+};
+
+struct RenderSettings
+{
+    int gains[EqualizerEngine::BandCount];
+    // Layout of headerless *.pcm / *.raw files.
+    WavFormat rawFormat;
+    // Treat "-" as raw PCM rather than WAV.
+    bool rawStreams;
+    // Otherwise the output keeps the input's sample format.
+    bool hasOutputSampleFormat;
+    SampleFormat outputSampleFormat;
+    // PeakLimiter at its default ceiling after the equaliser.
+    bool limit;
+    // TpdfDither before an integer encoder.
+    bool dither;
+    // Converted to in the same pass as the EQ; 0 keeps the input's rate.
+    int outputSampleRate;
+    // EqualizerEngine::setOversampling(): 1, 2 or 4. Above 1 the output
+    // is delayed by EqualizerEngine::latency().
+    int oversampling;
+
+    RenderSettings();
+};
+
+// decode -> resample -> EQ -> limit -> dither -> encode, fused per block.
+// The engine runs at the output rate; the resampler converts to it from
+// inputRate and passes blocks through when the two are equal. 16-bit in and
+// out at one rate with the limiter and dither off skips the float
+// conversion and lets the engine filter the PCM in fixed point.
+class RenderPipeline : public BlockPipeline<Resampler, EqualizerStage, PeakLimiter, TpdfDither>
+{
+public:
+    RenderPipeline(SampleFormat inputFormat, SampleFormat outputFormat, int channels, int inputRate,
+                   EqualizerEngine *engine, std::uint32_t ditherSeed);
+
+    bool isFixedPoint() const;
+
+    int process(const void *input, void *output, int frameCount);
+
+private:
+    EqualizerEngine *m_engine;
+};
+
+// Runs files through a RenderPipeline without a GUI. Files named *.pcm or
+// *.raw (and stdin/stdout with rawStreams) are headerless PCM in the
+// settings' rawFormat; everything else is read and written as WAV.
+//
+// The engine is kept between files and only rebuilt when the sample rate or
+// channel count changes, so a run over many small files does not reallocate.
+// Raw files that would come out unchanged apart from the header skip it and
+// go through PcmToWavConverter instead (see isPassThrough()).
+// One renderer must not be used from several threads at once.
+class OfflineRenderer
+{
+public:
+    explicit OfflineRenderer(const RenderSettings &settings = RenderSettings());
+
+    void setSettings(const RenderSettings &settings);
+    const RenderSettings &settings() const;
+
+    bool render(const std::string &sourcePath, const std::string &targetPath);
+
+    // Accumulated over all successful render() calls.
+    const RenderStatistics &statistics() const;
+    const std::string &errorString() const;
+
+    static bool isRawPath(const std::string &path);
+
+    // True when the settings leave raw input untouched on its way into a
+    // WAV file: flat gains, no limiter, dither, oversampling or rate or
+    // format change, and 8 or 16-bit PCM in one or two channels, which the
+    // converter's canonical header describes exactly.
+    static bool isPassThrough(const RenderSettings &settings, bool rawInput, bool rawOutput);
+
+    // Pipeline for one stream with the settings' limiter and dither,
+    // converting from the input's rate to the engine's; the engine must
+    // outlive it.
+    static RenderPipeline pipelineFor(const RenderSettings &settings, EqualizerEngine *engine,
+                                      const WavFormat &inputFormat, SampleFormat outputFormat,
+                                      std::uint32_t ditherSeed = 1);
+
+private:
+    static const int BlockFrames = 4096;
+
+    RenderSettings m_settings;
+
+    std::unique_ptr<EqualizerEngine> m_engine;
+    std::vector<unsigned char> m_inputBuffer;
+    std::vector<unsigned char> m_outputBuffer;
+
+    RenderStatistics m_statistics;
+    std::string m_errorString;
+
+    bool isRaw(const std::string &path) const;
+    bool convert(const std::string &sourcePath, const std::string &targetPath);
+    EqualizerEngine *engineFor(const WavFormat &format);
+    bool fail(const std::string &message);
+};
+
+#endif // OFFLINERENDERER_H
@@ -0,0 +1,444 @@
+#include "ParallelRenderer.h"
+
+#include "SampleConversion.h"
+#include "WavFileIo.h"
+#include "WavReader.h"
+#include "WavWriter.h"
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+    // exp(-12) is -104 dB: a start-up transient at full scale has decayed
+    // below the float rounding noise of the cascade.
+    constexpr double PrerollTimeConstants = 12.0;
+
+    // Random access reader over WAV or headerless PCM; one per thread.
+    class PcmSource
+    {
+    public:
+        PcmSource()
+            : m_raw(nullptr)
+            , m_frameCount(0)
+        {
+        }
+
+        ~PcmSource()
+        {
+            WavFileIo::close(m_raw);
+        }
+
+        bool open(const std::string &path, const WavFormat &rawFormat, std::string *error)
+        {
+            if (path == "-") {
+                *error = "Chunked rendering needs a seekable input";
+                return false;
+            }
+
+            if (!OfflineRenderer::isRawPath(path)) {
+                if (!m_reader.open(path)) {
+                    *error = path + ": " + m_reader.errorString();
+                    return false;
+                }
+                m_format = m_reader.format();
+                m_frameCount = m_reader.frameCount();
+            } else {
+                m_raw = WavFileIo::open(path, "rb");
+                if (!m_raw || !WavFileIo::seek(m_raw, 0, SEEK_END)) {
+                    *error = "Cannot open " + path + ": " + std::strerror(errno);
+                    return false;
+                }
+                m_format = rawFormat;
+                m_frameCount = WavFileIo::tell(m_raw) / m_format.blockAlign();
+            }
+
+            if (m_frameCount < 0) {
+                *error = path + ": chunked rendering needs an input of known length";
+                return false;
+            }
+            return true;
+        }
+
+        const WavFormat &format() const
+        {
+            return m_format;
+        }
+
+        std::int64_t frameCount() const
+        {
+            return m_frameCount;
+        }
+
+        bool seek(std::int64_t frame)
+        {
+            if (!m_raw) {
+                return m_reader.seek(frame);
+            }
+            return WavFileIo::seek(m_raw, frame * m_format.blockAlign(), SEEK_SET);
+        }
+
+        std::int64_t readRaw(void *target, std::int64_t frames)
+        {
+            if (!m_raw) {
+                return m_reader.readRaw(target, frames);
+            }
+
+            const size_t read = std::fread(target, m_format.blockAlign(), static_cast<size_t>(frames), m_raw);
+            if (read < static_cast<size_t>(frames) && std::ferror(m_raw)) {
+                return -1;
+            }
+            return static_cast<std::int64_t>(read);
+        }
+
+        std::int64_t read(float *samples, std::int64_t frames)
+        {
+            if (!m_raw) {
+                return m_reader.readFrames(samples, frames);
+            }
+
+            m_buffer.resize(static_cast<size_t>(frames * m_format.blockAlign()));
+            const size_t read = std::fread(m_buffer.data(), m_format.blockAlign(), static_cast<size_t>(frames), m_raw);
+            if (read < static_cast<size_t>(frames) && std::ferror(m_raw)) {
+                return -1;
+            }
+            SampleConversion::toFloat(m_format.sampleFormat, m_buffer.data(), samples, read * m_format.channels);
+            return static_cast<std::int64_t>(read);
+        }
+
+    private:
+        WavReader m_reader;
+        std::FILE *m_raw;
+        WavFormat m_format;
+        std::int64_t m_frameCount;
+        std::vector<unsigned char> m_buffer;
+    };
+
+    struct Chunk
+    {
+        std::vector<unsigned char> data;
+        std::int64_t frames;
+        bool isDone;
+        bool isOk;
+        std::string error;
+    };
+}
+
+RenderError::RenderError()
+    : maximum(0.0)
+    , rms(0.0)
+    , samples(0)
+    , differingSamples(0)
+{
+}
+
+double RenderError::maximumDb() const
+{
+    return maximum > 0.0 ? 20.0 * std::log10(maximum) : -std::numeric_limits<double>::infinity();
+}
+
+ParallelRenderer::ParallelRenderer(const RenderSettings &settings, int threadCount)
+    : m_settings(settings)
+    , m_threadCount(threadCount > 0 ? threadCount : static_cast<int>(std::max(1u, std::thread::hardware_concurrency())))
+    , m_chunkDuration(30.0)
+    , m_prerollDuration(defaultPrerollDuration())
+    , m_chunkCount(0)
+{
+}
+
+void ParallelRenderer::setChunkDuration(double seconds)
+{
+    m_chunkDuration = std::max(0.01, seconds);
+}
+
+double ParallelRenderer::chunkDuration() const
+{
+    return m_chunkDuration;
+}
+
+void ParallelRenderer::setPrerollDuration(double seconds)
+{
+    m_prerollDuration = std::max(0.0, seconds);
+}
+
+double ParallelRenderer::prerollDuration() const
+{
+    return m_prerollDuration;
+}
+
+double ParallelRenderer::defaultPrerollDuration()
+{
+    return PrerollTimeConstants * EqualizerBands::slowestTimeConstant();
+}
+
+bool ParallelRenderer::render(const std::string &sourcePath, const std::string &targetPath)
+{
+    m_errorString.clear();
+    m_chunkCount = 0;
+
+    // Opening the writer would truncate the file the chunks read from.
+    if (WavFileIo::isSameFile(sourcePath, targetPath)) {
+        return fail(targetPath + ": output would overwrite its input");
+    }
+
+    // Nothing to filter, so nothing to split: the payload is copied whole.
+    const bool rawOutput = targetPath != "-" ? OfflineRenderer::isRawPath(targetPath) : m_settings.rawStreams;
+    if (OfflineRenderer::isPassThrough(m_settings, OfflineRenderer::isRawPath(sourcePath), rawOutput)) {
+        OfflineRenderer renderer(m_settings);
+        if (!renderer.render(sourcePath, targetPath)) {
+            return fail(renderer.errorString());
+        }
+        m_chunkCount = 1;
+        m_statistics.add(renderer.statistics());
+        return true;
+    }
+
+    PcmSource source;
+    std::string error;
+    if (!source.open(sourcePath, m_settings.rawFormat, &error)) {
+        return fail(error);
+    }
+
+    const WavFormat inputFormat = source.format();
+    if (inputFormat.channels > EqualizerEngine::MaximumChannels) {
+        return fail("At most " + std::to_string(EqualizerEngine::MaximumChannels) + " channels are supported");
+    }
+
+    WavFormat outputFormat = inputFormat;
+    if (m_settings.hasOutputSampleFormat) {
+        outputFormat.sampleFormat = m_settings.outputSampleFormat;
+    }
+    // Chunk boundaries would have to fall on whole periods of the rate
+    // ratio; chunked renders keep the input's rate.
+    if (m_settings.outputSampleRate > 0 && static_cast<std::uint32_t>(m_settings.outputSampleRate) != inputFormat.sampleRate) {
+        return fail("Chunked rendering cannot change the sample rate");
+    }
+
+    WavWriter writer;
+    std::FILE *rawTarget = nullptr;
+    if (rawOutput) {
+        rawTarget = WavFileIo::open(targetPath, "wb");
+    }
+    if (rawOutput ? !rawTarget : !writer.open(targetPath, outputFormat)) {
+        return fail("Cannot open " + targetPath + ": "
+                    + (rawOutput ? std::string(std::strerror(errno)) : writer.errorString()));
+    }
+
+    const std::int64_t totalFrames = source.frameCount();
+    const std::int64_t chunkFrames = std::max<std::int64_t>(BlockFrames, std::llround(m_chunkDuration * inputFormat.sampleRate));
+    const std::int64_t prerollFrames = std::llround(m_prerollDuration * inputFormat.sampleRate);
+    const int chunkCount = static_cast<int>((totalFrames + chunkFrames - 1) / chunkFrames);
+    m_chunkCount = chunkCount;
+
+    std::vector<Chunk> chunks(static_cast<size_t>(chunkCount));
+    std::mutex mutex;
+    std::condition_variable chunkDone;
+
+    auto renderChunk = [&](int index) {
+        Chunk &chunk = chunks[static_cast<size_t>(index)];
+        const std::int64_t first = index * chunkFrames;
+        const std::int64_t frames = std::min(chunkFrames, totalFrames - first);
+        const std::int64_t start = std::max<std::int64_t>(0, first - prerollFrames);
+
+        PcmSource reader;
+        std::string chunkError;
+        bool ok = reader.open(sourcePath, m_settings.rawFormat, &chunkError) && reader.seek(start);
+
+        std::vector<unsigned char> data;
+        if (ok) {
+            EqualizerEngine engine(inputFormat.sampleRate, inputFormat.channels);
+            engine.setOversampling(m_settings.oversampling);
+            engine.setBandGains(m_settings.gains, EqualizerEngine::BandCount);
+            // Seeded per chunk so the chunks do not repeat each other's dither.
+            RenderPipeline pipeline = OfflineRenderer::pipelineFor(m_settings, &engine, inputFormat,
+                                                                   outputFormat.sampleFormat,
+                                                                   static_cast<std::uint32_t>(index) + 1);
+            std::vector<unsigned char> input(static_cast<size_t>(BlockFrames) * inputFormat.blockAlign());
+            std::vector<unsigned char> discarded(static_cast<size_t>(BlockFrames) * outputFormat.blockAlign());
+            data.resize(static_cast<size_t>(frames) * outputFormat.blockAlign());
+
+            std::int64_t position = start;
+            while (position < first + frames) {
+                const std::int64_t count = std::min<std::int64_t>(BlockFrames, first + frames - position);
+                if (reader.readRaw(input.data(), count) != count) {
+                    chunkError = sourcePath + ": short read";
+                    ok = false;
+                    break;
+                }
+
+                // Output of the pre-roll is thrown away; the rest goes
+                // straight into the chunk.
+                const std::int64_t preroll = std::min(count, std::max<std::int64_t>(0, first - position));
+                if (preroll > 0) {
+                    pipeline.process(input.data(), discarded.data(), static_cast<int>(preroll));
+                }
+                if (count > preroll) {
+                    pipeline.process(input.data() + preroll * inputFormat.blockAlign(),
+                                     data.data() + (position + preroll - first) * outputFormat.blockAlign(),
+                                     static_cast<int>(count - preroll));
+                }
+                position += count;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        chunk.data.swap(data);
+        chunk.frames = frames;
+        chunk.isOk = ok;
+        chunk.error = chunkError;
+        chunk.isDone = true;
+        chunkDone.notify_all();
+    };
+
+    for (Chunk &chunk : chunks) {
+        chunk.frames = 0;
+        chunk.isDone = false;
+        chunk.isOk = false;
+    }
+
+    RenderStatistics statistics;
+    statistics.files = 1;
+    bool ok = true;
+    {
+        WorkStealingPool pool(std::min(m_threadCount, std::max(1, chunkCount)));
+        // Bounds memory to a few chunks per worker however long the file is.
+        const int window = pool.threadCount() * 2;
+        int submitted = 0;
+
+        for (int written = 0; written < chunkCount; ++written) {
+            while (submitted < chunkCount && submitted < written + window) {
+                const int index = submitted++;
+                pool.submit([&renderChunk, index] { renderChunk(index); });
+            }
+
+            Chunk &chunk = chunks[static_cast<size_t>(written)];
+            std::vector<unsigned char> data;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                chunkDone.wait(lock, [&chunk] { return chunk.isDone; });
+                data.swap(chunk.data);
+            }
+
+            if (!chunk.isOk) {
+                ok = fail(chunk.error);
+                break;
+            }
+
+            const bool isWritten = rawOutput
+                    ? std::fwrite(data.data(), 1, data.size(), rawTarget) == data.size()
+                    : writer.writeRaw(data.data(), chunk.frames);
+            if (!isWritten) {
+                ok = fail(targetPath + ": write failed");
+                break;
+            }
+            statistics.frames += chunk.frames;
+        }
+
+        pool.wait();
+    }
+
+    if (rawOutput) {
+        WavFileIo::close(rawTarget);
+    } else if (!writer.close() && ok) {
+        ok = fail(targetPath + ": " + writer.errorString());
+    }
+
+    if (!ok) {
+        return false;
+    }
+
+    statistics.bytesRead = static_cast<std::uint64_t>(statistics.frames) * inputFormat.blockAlign();
+    statistics.bytesWritten = static_cast<std::uint64_t>(statistics.frames) * outputFormat.blockAlign();
+    m_statistics.add(statistics);
+    return true;
+}
+
+bool ParallelRenderer::measureError(const std::string &sourcePath, const std::string &targetPath, RenderError *error)
+{
+    WavFormat rawTargetFormat = m_settings.rawFormat;
+    if (m_settings.hasOutputSampleFormat) {
+        rawTargetFormat.sampleFormat = m_settings.outputSampleFormat;
+    }
+
+    PcmSource source;
+    PcmSource target;
+    std::string message;
+    if (!source.open(sourcePath, m_settings.rawFormat, &message) || !target.open(targetPath, rawTargetFormat, &message)) {
+        return fail(message);
+    }
+
+    const WavFormat &format = source.format();
+    const WavFormat &targetFormat = target.format();
+    if (targetFormat.channels != format.channels || target.frameCount() != source.frameCount()) {
+        return fail(targetPath + " does not match " + sourcePath);
+    }
+
+    EqualizerEngine engine(format.sampleRate, format.channels);
+    engine.setOversampling(m_settings.oversampling);
+    engine.setBandGains(m_settings.gains, EqualizerEngine::BandCount);
+    RenderPipeline pipeline = OfflineRenderer::pipelineFor(m_settings, &engine, format, targetFormat.sampleFormat);
+
+    const size_t blockSamples = static_cast<size_t>(BlockFrames) * format.channels;
+    std::vector<unsigned char> input(static_cast<size_t>(BlockFrames) * format.blockAlign());
+    std::vector<unsigned char> quantised(static_cast<size_t>(BlockFrames) * targetFormat.blockAlign());
+    std::vector<float> serial(blockSamples);
+    std::vector<float> parallel(blockSamples);
+
+    RenderError result;
+    double sumOfSquares = 0.0;
+    for (;;) {
+        const std::int64_t frames = source.readRaw(input.data(), BlockFrames);
+        if (frames <= 0) {
+            break;
+        }
+        if (target.read(parallel.data(), frames) != frames) {
+            return fail(targetPath + ": short read");
+        }
+
+        const size_t samples = static_cast<size_t>(frames) * format.channels;
+        pipeline.process(input.data(), quantised.data(), static_cast<int>(frames));
+        SampleConversion::toFloat(targetFormat.sampleFormat, quantised.data(), serial.data(), samples);
+
+        for (size_t i = 0; i < samples; ++i) {
+            const double difference = std::fabs(static_cast<double>(serial[i]) - parallel[i]);
+            result.maximum = std::max(result.maximum, difference);
+            sumOfSquares += difference * difference;
+            if (difference != 0.0) {
+                ++result.differingSamples;
+            }
+        }
+        result.samples += static_cast<std::int64_t>(samples);
+    }
+
+    result.rms = result.samples > 0 ? std::sqrt(sumOfSquares / result.samples) : 0.0;
+    *error = result;
+    return true;
+}
+
+int ParallelRenderer::chunkCount() const
+{
+    return m_chunkCount;
+}
+
+const RenderStatistics &ParallelRenderer::statistics() const
+{
+    return m_statistics;
+}
+
+const std::string &ParallelRenderer::errorString() const
+{
+    return m_errorString;
+}
+
+bool ParallelRenderer::fail(const std::string &message)
+{
+    m_errorString = message;
+    return false;
+}
@@ -0,0 +1,22 @@
+QT = core
+
+CONFIG += c++14 console
+CONFIG -= app_bundle
+
+TEMPLATE = app
+TARGET = equalizer-render
+
+SOURCES += \
+    main.cpp \
+    OfflineRenderer.cpp \
+    BatchRenderer.cpp \
+    ParallelRenderer.cpp
+
+HEADERS += \
+    OfflineRenderer.h \
+    BatchRenderer.h \
+    ParallelRenderer.h
+
+include(../engine.pri)
+include(../wav.pri)
+include(../presets.pri)
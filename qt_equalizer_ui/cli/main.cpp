@@ -0,0 +1,387 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QHash>
+#include <QTextStream>
+#include <QThread>
+
+#include "BatchRenderer.h"
+#include "OfflineRenderer.h"
+#include "ParallelRenderer.h"
+#include "PresetManager.h"
+
+#include <algorithm>
+
+namespace
+{
+    bool parseGains(const QString &text, QVector<int> *gains)
+    {
+        // Gains for any band layout are accepted and resampled onto this
+        // build's.
+        const QStringList parts = text.split(QLatin1Char(','));
+        if (!EqualizerBands::frequenciesFor(parts.size())) {
+            return false;
+        }
+
+        QVector<int> parsed;
+        for (const QString &part : parts) {
+            bool ok = false;
+            const int gain = part.trimmed().toInt(&ok);
+            if (!ok || gain < EqualizerBands::MinimumGain || gain > EqualizerBands::MaximumGain) {
+                return false;
+            }
+            parsed.append(gain);
+        }
+
+        gains->resize(EqualizerEngine::BandCount);
+        return EqualizerBands::resample(parsed.constData(), parsed.size(), gains->data());
+    }
+
+    bool findPreset(const PresetManager &presets, const QString &name, QVector<int> *gains)
+    {
+        const int index = presets.presetIndex(name);
+        if (index < 0) {
+            return false;
+        }
+
+        *gains = presets.presetValues(presets.presetName(index));
+        return true;
+    }
+
+    // relativeName keeps the input's sub directory below --input-dir.
+    QString outputPathFor(const QString &relativeName, const QString &outputDirectory)
+    {
+        const QFileInfo info(relativeName);
+        const QString suffix = OfflineRenderer::isRawPath(relativeName.toStdString()) ? QStringLiteral("wav") : info.suffix();
+        QString name = info.completeBaseName() + QLatin1Char('.') + suffix;
+        if (info.path() != QLatin1String(".") && QDir::isRelativePath(relativeName)) {
+            name = info.path() + QLatin1Char('/') + name;
+        }
+        return QDir(outputDirectory).filePath(name);
+    }
+
+    // Resolves links in the directory, so two spellings of one file compare
+    // equal whether or not the file exists yet.
+    QString comparablePath(const QString &path)
+    {
+        const QFileInfo info(path);
+        const QString directory = QFileInfo(info.path()).canonicalFilePath();
+        if (directory.isEmpty()) {
+            return QDir::cleanPath(info.absoluteFilePath());
+        }
+        return directory + QLatin1Char('/') + info.fileName();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("equalizer-render"));
+
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Applies an equaliser preset or gain vector to WAV or raw PCM files.\n"
+                                                    "*.pcm and *.raw files are headerless PCM in the --rate/--channels/--format layout."));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("inputs"), QStringLiteral("Input files; \"-\" reads stdin."),
+                                 QStringLiteral("[<input>...]"));
+
+    const QCommandLineOption presetOption(QStringList() << QStringLiteral("p") << QStringLiteral("preset"),
+                                          QStringLiteral("Apply the preset <name>."),
+                                          QStringLiteral("name"));
+    const QCommandLineOption presetsOption(QStringLiteral("presets"),
+                                           QStringLiteral("Add the presets in the JSON library <file> to the built-in ones."),
+                                           QStringLiteral("file"));
+    const QCommandLineOption gainsOption(QStringList() << QStringLiteral("g") << QStringLiteral("gains"),
+                                         QStringLiteral("Apply 5, 10, 15 or 31 comma separated band gains in dB (-12..12)."),
+                                         QStringLiteral("list"));
+    const QCommandLineOption listOption(QStringLiteral("list-presets"), QStringLiteral("List the available presets."));
+    const QCommandLineOption outputOption(QStringList() << QStringLiteral("o") << QStringLiteral("output"),
+                                          QStringLiteral("Output file for a single input; \"-\" writes stdout."),
+                                          QStringLiteral("file"));
+    const QCommandLineOption directoryOption(QStringList() << QStringLiteral("d") << QStringLiteral("output-dir"),
+                                             QStringLiteral("Write each output to <dir> under the input's name; raw inputs become .wav."),
+                                             QStringLiteral("dir"));
+    const QCommandLineOption inputDirectoryOption(QStringList() << QStringLiteral("i") << QStringLiteral("input-dir"),
+                                                  QStringLiteral("Render every *.pcm, *.raw and *.wav file in <dir>."),
+                                                  QStringLiteral("dir"));
+    const QCommandLineOption recursiveOption(QStringList() << QStringLiteral("r") << QStringLiteral("recursive"),
+                                             QStringLiteral("Also walk the sub directories of --input-dir."));
+    const QCommandLineOption jobsOption(QStringList() << QStringLiteral("j") << QStringLiteral("jobs"),
+                                        QStringLiteral("Worker threads for several inputs (default: one per hardware thread)."),
+                                        QStringLiteral("count"), QString::number(QThread::idealThreadCount()));
+    const QCommandLineOption chunkOption(QStringLiteral("chunk-seconds"),
+                                         QStringLiteral("Split a single input into chunks of <seconds> rendered on --jobs threads."),
+                                         QStringLiteral("seconds"));
+    const QString defaultPreroll = QString::number(qRound(ParallelRenderer::defaultPrerollDuration() * 1000.0));
+    const QCommandLineOption prerollOption(QStringLiteral("preroll-ms"),
+                                           QStringLiteral("Filter warm-up before each chunk in milliseconds (default %1).")
+                                                   .arg(defaultPreroll),
+                                           QStringLiteral("ms"), defaultPreroll);
+    const QCommandLineOption verifyOption(QStringLiteral("verify"),
+                                          QStringLiteral("After a chunked render, report its error against a serial render."));
+    const QCommandLineOption rateOption(QStringLiteral("rate"), QStringLiteral("Raw PCM sample rate (default 8000)."),
+                                        QStringLiteral("hz"), QStringLiteral("8000"));
+    const QCommandLineOption channelsOption(QStringLiteral("channels"), QStringLiteral("Raw PCM channel count (default 2)."),
+                                            QStringLiteral("count"), QStringLiteral("2"));
+    const QCommandLineOption formatOption(QStringLiteral("format"),
+                                          QStringLiteral("Raw PCM sample format: u8, s16, s24, s32, f32 or f64 (default s16)."),
+                                          QStringLiteral("format"), QStringLiteral("s16"));
+    const QCommandLineOption outputFormatOption(QStringLiteral("output-format"),
+                                                QStringLiteral("Output sample format (default: the input's)."),
+                                                QStringLiteral("format"));
+    const QCommandLineOption outputRateOption(QStringLiteral("output-rate"),
+                                              QStringLiteral("Resample to 8000, 16000, 22050, 44100 or 48000 Hz while equalising (default: the input's rate)."),
+                                              QStringLiteral("hz"));
+    const QCommandLineOption oversampleOption(QStringLiteral("oversample"),
+                                              QStringLiteral("Run the bands near the Nyquist frequency at 2 or 4 times the sample rate (adds about 25 frames of delay)."),
+                                              QStringLiteral("factor"));
+    const QCommandLineOption rawOption(QStringLiteral("raw"), QStringLiteral("Treat stdin and stdout as raw PCM."));
+    const QCommandLineOption limitOption(QStringLiteral("limit"),
+                                         QStringLiteral("Peak limit the equalised signal to -0.3 dBFS instead of clipping."));
+    const QCommandLineOption ditherOption(QStringLiteral("dither"),
+                                          QStringLiteral("Add TPDF dither before encoding to 8, 16 or 24 bit."));
+    parser.addOption(presetOption);
+    parser.addOption(gainsOption);
+    parser.addOption(presetsOption);
+    parser.addOption(listOption);
+    parser.addOption(outputOption);
+    parser.addOption(directoryOption);
+    parser.addOption(inputDirectoryOption);
+    parser.addOption(recursiveOption);
+    parser.addOption(jobsOption);
+    parser.addOption(chunkOption);
+    parser.addOption(prerollOption);
+    parser.addOption(verifyOption);
+    parser.addOption(rateOption);
+    parser.addOption(channelsOption);
+    parser.addOption(formatOption);
+    parser.addOption(outputFormatOption);
+    parser.addOption(outputRateOption);
+    parser.addOption(oversampleOption);
+    parser.addOption(rawOption);
+    parser.addOption(limitOption);
+    parser.addOption(ditherOption);
+    parser.process(app);
+
+    PresetManager presets;
+    if (parser.isSet(presetsOption) && !presets.loadPresets(parser.value(presetsOption))) {
+        err << "Cannot load " << parser.value(presetsOption) << ": " << presets.errorString() << '\n';
+        return 1;
+    }
+    if (parser.isSet(listOption)) {
+        QTextStream out(stdout);
+        for (const QString &name : presets.presetNames()) {
+            out << name << '\n';
+        }
+        return 0;
+    }
+
+    QVector<int> gains(EqualizerEngine::BandCount, 0);
+    if (parser.isSet(presetOption) && parser.isSet(gainsOption)) {
+        err << "--preset and --gains are mutually exclusive" << '\n';
+        return 1;
+    }
+    if (parser.isSet(presetOption) && !findPreset(presets, parser.value(presetOption), &gains)) {
+        err << "Unknown preset " << parser.value(presetOption) << "; see --list-presets" << '\n';
+        return 1;
+    }
+    if (parser.isSet(gainsOption) && !parseGains(parser.value(gainsOption), &gains)) {
+        err << "--gains needs 5, 10, 15 or 31 integers between "
+            << EqualizerBands::MinimumGain << " and " << EqualizerBands::MaximumGain << '\n';
+        return 1;
+    }
+
+    RenderSettings settings;
+    std::copy(gains.constBegin(), gains.constEnd(), settings.gains);
+
+    WavFormat &rawFormat = settings.rawFormat;
+    bool rateOk = false;
+    bool channelsOk = false;
+    rawFormat.sampleRate = parser.value(rateOption).toUInt(&rateOk);
+    const int channels = parser.value(channelsOption).toInt(&channelsOk);
+    if (!rateOk || rawFormat.sampleRate == 0 || !channelsOk || channels < 1 || channels > EqualizerEngine::MaximumChannels
+            || !SampleFormats::fromName(parser.value(formatOption).toLatin1().constData(), &rawFormat.sampleFormat)) {
+        err << "Invalid raw PCM format" << '\n';
+        return 1;
+    }
+    rawFormat.channels = static_cast<std::uint16_t>(channels);
+
+    settings.rawStreams = parser.isSet(rawOption);
+    settings.limit = parser.isSet(limitOption);
+    settings.dither = parser.isSet(ditherOption);
+    if (parser.isSet(outputFormatOption)) {
+        if (!SampleFormats::fromName(parser.value(outputFormatOption).toLatin1().constData(), &settings.outputSampleFormat)) {
+            err << "Invalid output format " << parser.value(outputFormatOption) << '\n';
+            return 1;
+        }
+        settings.hasOutputSampleFormat = true;
+    }
+    if (parser.isSet(outputRateOption)) {
+        bool outputRateOk = false;
+        settings.outputSampleRate = parser.value(outputRateOption).toInt(&outputRateOk);
+        if (!outputRateOk || !Resampler::isSupported(settings.outputSampleRate, settings.outputSampleRate)) {
+            err << "Invalid output rate " << parser.value(outputRateOption) << '\n';
+            return 1;
+        }
+    }
+    if (parser.isSet(oversampleOption)) {
+        bool oversampleOk = false;
+        settings.oversampling = parser.value(oversampleOption).toInt(&oversampleOk);
+        if (!oversampleOk || (settings.oversampling != 1 && settings.oversampling != 2 && settings.oversampling != 4)) {
+            err << "Invalid oversampling factor " << parser.value(oversampleOption) << '\n';
+            return 1;
+        }
+    }
+
+    // Inputs paired with their names relative to the output directory.
+    QVector<QPair<QString, QString>> inputs;
+    for (const QString &input : parser.positionalArguments()) {
+        inputs.append(qMakePair(input, QFileInfo(input).fileName()));
+    }
+    if (parser.isSet(inputDirectoryOption)) {
+        const QDir directory(parser.value(inputDirectoryOption));
+        if (!directory.exists()) {
+            err << "No such directory " << directory.path() << '\n';
+            return 1;
+        }
+        QDirIterator it(directory.path(),
+                        QStringList() << QStringLiteral("*.pcm") << QStringLiteral("*.raw") << QStringLiteral("*.wav"),
+                        QDir::Files | QDir::Readable,
+                        parser.isSet(recursiveOption) ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+        while (it.hasNext()) {
+            const QString path = it.next();
+            inputs.append(qMakePair(path, directory.relativeFilePath(path)));
+        }
+    }
+
+    if (inputs.isEmpty()) {
+        if (parser.positionalArguments().isEmpty() && !parser.isSet(inputDirectoryOption)) {
+            parser.showHelp(1);
+        }
+        err << "No input files found" << '\n';
+        return 1;
+    }
+    if (parser.isSet(outputOption) == parser.isSet(directoryOption)) {
+        err << "Give exactly one of --output and --output-dir" << '\n';
+        return 1;
+    }
+    if (parser.isSet(outputOption) && inputs.size() != 1) {
+        err << "--output takes a single input; use --output-dir for several" << '\n';
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    RenderStatistics statistics;
+    QStringList errors;
+    QString schedule;
+
+    if (parser.isSet(outputOption) && parser.isSet(chunkOption)) {
+        const std::string input = inputs.first().first.toStdString();
+        const std::string output = parser.value(outputOption).toStdString();
+        ParallelRenderer renderer(settings, qMax(1, parser.value(jobsOption).toInt()));
+        renderer.setChunkDuration(parser.value(chunkOption).toDouble());
+        renderer.setPrerollDuration(parser.value(prerollOption).toDouble() / 1000.0);
+
+        if (!renderer.render(input, output)) {
+            errors.append(QString::fromStdString(renderer.errorString()));
+        }
+        statistics = renderer.statistics();
+        schedule = QStringLiteral(" (%1 chunks)").arg(renderer.chunkCount());
+
+        RenderError error;
+        if (errors.isEmpty() && parser.isSet(verifyOption)) {
+            if (renderer.measureError(input, output, &error)) {
+                err << QStringLiteral("Error against a serial render: peak %1 (%2 dBFS), rms %3, %4 of %5 samples differ")
+                       .arg(error.maximum, 0, 'g', 3)
+                       .arg(error.maximumDb(), 0, 'f', 1)
+                       .arg(error.rms, 0, 'g', 3)
+                       .arg(error.differingSamples)
+                       .arg(error.samples)
+                    << '\n';
+            } else {
+                errors.append(QString::fromStdString(renderer.errorString()));
+            }
+        }
+    } else if (parser.isSet(outputOption)) {
+        OfflineRenderer renderer(settings);
+        if (!renderer.render(inputs.first().first.toStdString(), parser.value(outputOption).toStdString())) {
+            errors.append(QString::fromStdString(renderer.errorString()));
+        }
+        statistics = renderer.statistics();
+    } else {
+        const QString outputDirectory = parser.value(directoryOption);
+        BatchRenderer batch(settings, qMax(1, parser.value(jobsOption).toInt()));
+        // Jobs run at once, so no output may be another job's output or
+        // any job's input.
+        QHash<QString, QString> sources;
+        for (const QPair<QString, QString> &input : inputs) {
+            if (input.first != QLatin1String("-")) {
+                sources.insert(comparablePath(input.first), input.first);
+            }
+        }
+        QHash<QString, QString> targets;
+        for (const QPair<QString, QString> &input : inputs) {
+            if (input.first == QLatin1String("-")) {
+                err << "stdin needs --output" << '\n';
+                return 1;
+            }
+
+            // Created up front so the workers never race on mkpath.
+            const QString output = outputPathFor(input.second, outputDirectory);
+            if (!QDir().mkpath(QFileInfo(output).path())) {
+                err << "Cannot create " << QFileInfo(output).path() << '\n';
+                return 1;
+            }
+            const QString target = comparablePath(output);
+            if (sources.contains(target)) {
+                err << input.first << ": output " << output << " would overwrite the input " << sources.value(target)
+                    << '\n';
+                return 1;
+            }
+            if (targets.contains(target)) {
+                err << input.first << " and " << targets.value(target) << " would both be written to " << output << '\n';
+                return 1;
+            }
+            targets.insert(target, input.first);
+            batch.addJob(input.first.toStdString(), output.toStdString(),
+                         static_cast<std::uint64_t>(QFileInfo(input.first).size()));
+        }
+
+        batch.run();
+        statistics = batch.statistics();
+        for (const std::string &error : batch.errors()) {
+            errors.append(QString::fromStdString(error));
+        }
+        schedule = QStringLiteral(" (%1 threads, %2 tasks, %3 steals)")
+                .arg(batch.threadCount())
+                .arg(batch.taskCount())
+                .arg(batch.stealCount());
+    }
+
+    for (const QString &error : errors) {
+        err << error << '\n';
+    }
+
+    const double seconds = qMax<qint64>(1, timer.nsecsElapsed()) / 1e9;
+    const double megabytes = statistics.bytesRead / 1e6;
+    err << QStringLiteral("Rendered %1 file(s), %2 MB in %3 s: %4 files/s, %5 MB/s")
+           .arg(statistics.files)
+           .arg(megabytes, 0, 'f', 1)
+           .arg(seconds, 0, 'f', 3)
+           .arg(statistics.files / seconds, 0, 'f', 1)
+           .arg(megabytes / seconds, 0, 'f', 1)
+        << schedule;
+    if (!errors.isEmpty()) {
+        err << QStringLiteral(", %1 failed").arg(errors.size());
+    }
+    err << '\n';
+
+    return errors.isEmpty() ? 0 : 1;
+}
@@ -0,0 +1,41 @@
+# Qt-free DSP engine shared by the application and the tools built on it.
+
+INCLUDEPATH += $$PWD/src
+
+# Band layout, 5, 10, 15 or 31 bands: qmake EQUALIZER_BANDS=31. Every target
+# built from these sources must agree on it, so it is set here only.
+isEmpty(EQUALIZER_BANDS): EQUALIZER_BANDS = 10
+DEFINES += EQUALIZER_BANDS=$$EQUALIZER_BANDS
+
+SOURCES += \
+    $$PWD/src/BiquadFilter.cpp \
+    $$PWD/src/EqualizerBands.cpp \
+    $$PWD/src/EqualizerEngine.cpp \
+    $$PWD/src/BiquadCoefficientTable.cpp \
+    $$PWD/src/BiquadKernels.cpp \
+    $$PWD/src/FixedPointKernels.cpp \
+    $$PWD/src/Resampler.cpp \
+    $$PWD/src/Oversampler.cpp \
+    $$PWD/src/ProcessingCounters.cpp \
+    $$PWD/src/WorkStealingPool.cpp \
+    $$PWD/src/StreamEngine.cpp \
+    $$PWD/src/SpectrumAnalyzer.cpp \
+    $$PWD/src/FrequencyResponse.cpp
+
+HEADERS += \
+    $$PWD/src/BiquadFilter.h \
+    $$PWD/src/EqualizerEngine.h \
+    $$PWD/src/ParameterChannel.h \
+    $$PWD/src/EqualizerBands.h \
+    $$PWD/src/BiquadCoefficientTable.h \
+    $$PWD/src/BiquadKernels.h \
+    $$PWD/src/FixedPointKernels.h \
+    $$PWD/src/Resampler.h \
+    $$PWD/src/Oversampler.h \
+    $$PWD/src/ProcessingCounters.h \
+    $$PWD/src/DenormalGuard.h \
+    $$PWD/src/WorkStealingPool.h \
+    $$PWD/src/StreamEngine.h \
+    $$PWD/src/SampleRing.h \
+    $$PWD/src/SpectrumAnalyzer.h \
+    $$PWD/src/FrequencyResponse.h
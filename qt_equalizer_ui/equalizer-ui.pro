@@ -1,25 +1,15 @@
 QT += widgets
 
-CONFIG += c++11
+CONFIG += c++14
 
 TEMPLATE = app
 TARGET = equalizer-ui
 
 SOURCES += \
-    src/main.cpp \
-    src/MainWindow.cpp \
-    src/EqualizerWidget.cpp \
-    src/PresetManager.cpp \
-    src/EqualizerCurveWidget.cpp
+    src/main.cpp
 
-HEADERS += \
-    src/MainWindow.h \
-    src/EqualizerWidget.h \
-    src/PresetManager.h \
-    src/EqualizerCurveWidget.h
-
-FORMS += \
-    ui/MainWindow.ui \
-    ui/EqualizerWidget.ui
+include(engine.pri)
+include(presets.pri)
+include(widgets.pri)
 
 RESOURCES += resources.qrc
@@ -0,0 +1,10 @@
+# Equaliser preset store: the built-in presets plus any loaded libraries.
+# Needs QtCore and engine.pri, which sets the band layout.
+
+INCLUDEPATH += $$PWD/src
+
+SOURCES += \
+    $$PWD/src/PresetManager.cpp
+
+HEADERS += \
+    $$PWD/src/PresetManager.h
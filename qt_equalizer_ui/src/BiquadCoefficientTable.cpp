@@ -0,0 +1,138 @@
+#include "BiquadCoefficientTable.h"
+#include "EqualizerBands.h"
+
+#include <cmath>
+
+namespace
+{
+    constexpr double Pi = 3.14159265358979323846;
+    constexpr double Ln10 = 2.30258509299404568402;
+
+    constexpr double SampleRates[] = {
+        8000.0, 11025.0, 16000.0, 22050.0, 32000.0, 44100.0, 48000.0, 88200.0, 96000.0
+    };
+    constexpr int SampleRateCount = sizeof(SampleRates) / sizeof(SampleRates[0]);
+
+    // Just enough maths to evaluate the RBJ peaking design in a constant
+    // expression. Arguments stay small (|x| <= pi for the trig functions,
+    // |x| < 1 for exp) so plain Taylor series converge to double precision.
+    constexpr double taylorExp(double x)
+    {
+        double sum = 1.0;
+        double term = 1.0;
+        for (int n = 1; n < 30; ++n) {
+            term *= x / n;
+            sum += term;
+        }
+        return sum;
+    }
+
+    constexpr double taylorSin(double x)
+    {
+        double sum = x;
+        double term = x;
+        for (int n = 1; n < 20; ++n) {
+            term *= -x * x / ((2 * n) * (2 * n + 1));
+            sum += term;
+        }
+        return sum;
+    }
+
+    constexpr double taylorCos(double x)
+    {
+        double sum = 1.0;
+        double term = 1.0;
+        for (int n = 1; n < 20; ++n) {
+            term *= -x * x / ((2 * n - 1) * (2 * n));
+            sum += term;
+        }
+        return sum;
+    }
+
+    struct Table
+    {
+        BiquadCoefficients entries[SampleRateCount][EqualizerBands::Count][EqualizerBands::GainSteps];
+    };
+
+    // Mirrors Biquad::peaking().
+    constexpr Table makeTable()
+    {
+        Table table{};
+
+        // The same per gain for every band and rate; working it out once
+        // keeps the 31 band table within the compilers' constexpr budgets.
+        double gainFactors[EqualizerBands::GainSteps] = {};
+        for (int step = 0; step < EqualizerBands::GainSteps; ++step) {
+            gainFactors[step] = taylorExp((EqualizerBands::MinimumGain + step) * Ln10 / 40.0);
+        }
+
+        for (int rate = 0; rate < SampleRateCount; ++rate) {
+            const double sampleRate = SampleRates[rate];
+
+            for (int band = 0; band < EqualizerBands::Count; ++band) {
+                const double centre = EqualizerBands::Frequencies[band];
+                const double omega = 2.0 * Pi * centre / sampleRate;
+                const double alpha = taylorSin(omega) / (2.0 * EqualizerBands::Q);
+                const double cosOmega = taylorCos(omega);
+                const bool belowNyquist = centre < sampleRate * 0.5;
+
+                for (int step = 0; step < EqualizerBands::GainSteps; ++step) {
+                    const int gainDb = EqualizerBands::MinimumGain + step;
+                    BiquadCoefficients &c = table.entries[rate][band][step];
+
+                    if (gainDb == 0 || !belowNyquist) {
+                        c.b0 = 1.0f;
+                        c.b1 = 0.0f;
+                        c.b2 = 0.0f;
+                        c.a1 = 0.0f;
+                        c.a2 = 0.0f;
+                        continue;
+                    }
+
+                    const double a = gainFactors[step];
+                    const double a0 = 1.0 + alpha / a;
+                    c.b0 = static_cast<float>((1.0 + alpha * a) / a0);
+                    c.b1 = static_cast<float>((-2.0 * cosOmega) / a0);
+                    c.b2 = static_cast<float>((1.0 - alpha * a) / a0);
+                    c.a1 = static_cast<float>((-2.0 * cosOmega) / a0);
+                    c.a2 = static_cast<float>((1.0 - alpha / a) / a0);
+                }
+            }
+        }
+
+        return table;
+    }
+
+    constexpr Table CoefficientTable = makeTable();
+
+    static_assert(CoefficientTable.entries[6][0][-EqualizerBands::MinimumGain].b0 == 1.0f,
+                  "0 dB entries must be identity sections");
+}
+
+int BiquadCoefficientTable::sampleRateIndex(double sampleRate)
+{
+    for (int i = 0; i < SampleRateCount; ++i) {
+        if (SampleRates[i] == sampleRate) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+bool BiquadCoefficientTable::lookup(int sampleRateIndex, int band, double gainDb, BiquadCoefficients *coefficients)
+{
+    if (sampleRateIndex < 0 || sampleRateIndex >= SampleRateCount
+            || band < 0 || band >= EqualizerBands::Count || !coefficients) {
+        return false;
+    }
+
+    const double rounded = std::floor(gainDb);
+    if (rounded != gainDb || rounded < EqualizerBands::MinimumGain || rounded > EqualizerBands::MaximumGain) {
+        return false;
+    }
+
+    const int step = static_cast<int>(rounded) - EqualizerBands::MinimumGain;
+    *coefficients = CoefficientTable.entries[sampleRateIndex][band][step];
+    return true;
+}
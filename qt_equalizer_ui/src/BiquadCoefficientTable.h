@@ -0,0 +1,20 @@
+#ifndef BIQUADCOEFFICIENTTABLE_H
+#define BIQUADCOEFFICIENTTABLE_H
+
+#include "BiquadFilter.h"
+
+// Peaking coefficients for every integer gain of every band at the common
+// sample rates, generated at compile time. Slider moves and presets land on
+// this grid, so they cost a table lookup instead of pow/sin/cos; only
+// off-grid gains (smoothing ramps) and unusual sample rates fall back to
+// Biquad::peaking().
+namespace BiquadCoefficientTable
+{
+    // Index into the table for sampleRate, or -1 if it is not tabulated.
+    int sampleRateIndex(double sampleRate);
+
+    // Returns false when the gain is not on the integer grid.
+    bool lookup(int sampleRateIndex, int band, double gainDb, BiquadCoefficients *coefficients);
+}
+
+#endif // BIQUADCOEFFICIENTTABLE_H
@@ -0,0 +1,48 @@
+#include "BiquadFilter.h"
+
+#include <cmath>
+
+namespace
+{
+    constexpr double Pi = 3.14159265358979323846;
+}
+
+BiquadCoefficients Biquad::identity()
+{
+    BiquadCoefficients coefficients;
+    coefficients.b0 = 1.0f;
+    coefficients.b1 = 0.0f;
+    coefficients.b2 = 0.0f;
+    coefficients.a1 = 0.0f;
+    coefficients.a2 = 0.0f;
+    return coefficients;
+}
+
+BiquadCoefficients Biquad::peaking(double centreFrequency, double gainDb, double q, double sampleRate)
+{
+    if (gainDb == 0.0 || sampleRate <= 0.0 || q <= 0.0
+            || centreFrequency <= 0.0 || centreFrequency >= sampleRate * 0.5) {
+        return identity();
+    }
+
+    const double a = std::pow(10.0, gainDb / 40.0);
+    const double omega = 2.0 * Pi * centreFrequency / sampleRate;
+    const double alpha = std::sin(omega) / (2.0 * q);
+    const double cosOmega = std::cos(omega);
+
+    const double a0 = 1.0 + alpha / a;
+
+    BiquadCoefficients coefficients;
+    coefficients.b0 = static_cast<float>((1.0 + alpha * a) / a0);
+    coefficients.b1 = static_cast<float>((-2.0 * cosOmega) / a0);
+    coefficients.b2 = static_cast<float>((1.0 - alpha * a) / a0);
+    coefficients.a1 = static_cast<float>((-2.0 * cosOmega) / a0);
+    coefficients.a2 = static_cast<float>((1.0 - alpha / a) / a0);
+    return coefficients;
+}
+
+bool Biquad::isIdentity(const BiquadCoefficients &coefficients)
+{
+    return coefficients.b0 == 1.0f && coefficients.b1 == 0.0f && coefficients.b2 == 0.0f
+            && coefficients.a1 == 0.0f && coefficients.a2 == 0.0f;
+}
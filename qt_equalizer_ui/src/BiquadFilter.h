@@ -0,0 +1,30 @@
+#ifndef BIQUADFILTER_H
+#define BIQUADFILTER_H
+
+// Normalised biquad coefficients (a0 == 1) for a transposed direct form II
+// section:
+//
+//   y[n]  = b0 * x[n] + s1
+//   s1    = b1 * x[n] - a1 * y[n] + s2
+//   s2    = b2 * x[n] - a2 * y[n]
+struct BiquadCoefficients
+{
+    float b0;
+    float b1;
+    float b2;
+    float a1;
+    float a2;
+};
+
+namespace Biquad
+{
+    // Pass-through section, also what a peaking filter degenerates to at 0 dB.
+    BiquadCoefficients identity();
+
+    // RBJ audio cookbook peaking equaliser.
+    BiquadCoefficients peaking(double centreFrequency, double gainDb, double q, double sampleRate);
+
+    bool isIdentity(const BiquadCoefficients &coefficients);
+}
+
+#endif // BIQUADFILTER_H
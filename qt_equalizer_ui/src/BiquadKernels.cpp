@@ -0,0 +1,474 @@
+#include "BiquadKernels.h"
+#include "EqualizerBands.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define EQUALIZER_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(EQUALIZER_X86) && (defined(__GNUC__) || defined(__clang__))
+#define EQUALIZER_TARGET(isa) __attribute__((target(isa)))
+#else
+#define EQUALIZER_TARGET(isa)
+#endif
+
+namespace
+{
+    template <int Lanes>
+    void cascadeScalar(const float *coefficients, float *state, int sectionCount, float *samples, int frameCount)
+    {
+        for (int frame = 0; frame < frameCount; ++frame) {
+            float *x = samples + frame * Lanes;
+            const float *c = coefficients;
+            float *s = state;
+
+            for (int section = 0; section < sectionCount; ++section, c += 5 * Lanes, s += 2 * Lanes) {
+                for (int lane = 0; lane < Lanes; ++lane) {
+                    const float in = x[lane];
+                    const float y = c[lane] * in + s[lane];
+                    s[lane] = c[Lanes + lane] * in - c[3 * Lanes + lane] * y + s[Lanes + lane];
+                    s[Lanes + lane] = c[2 * Lanes + lane] * in - c[4 * Lanes + lane] * y;
+                    x[lane] = y;
+                }
+            }
+        }
+    }
+
+#ifdef EQUALIZER_X86
+    // The SIMD kernels walk the cascade sample by sample: section i of frame
+    // n+1 only waits on section i-1 of the same frame and on its own state, so
+    // the out-of-order core overlaps the whole cascade instead of stalling on
+    // one section's feedback loop.
+
+    EQUALIZER_TARGET("sse2")
+    void cascadeSse2(const float *coefficients, float *state, int sectionCount, float *samples, int frameCount)
+    {
+        for (int frame = 0; frame < frameCount; ++frame) {
+            float *out = samples + frame * 4;
+            __m128 x = _mm_loadu_ps(out);
+            const float *c = coefficients;
+            float *s = state;
+
+            for (int section = 0; section < sectionCount; ++section, c += 20, s += 8) {
+                const __m128 y = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(c), x), _mm_loadu_ps(s));
+                const __m128 s1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(c + 4), x),
+                                                        _mm_mul_ps(_mm_loadu_ps(c + 12), y)),
+                                             _mm_loadu_ps(s + 4));
+                const __m128 s2 = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(c + 8), x),
+                                             _mm_mul_ps(_mm_loadu_ps(c + 16), y));
+                _mm_storeu_ps(s, s1);
+                _mm_storeu_ps(s + 4, s2);
+                x = y;
+            }
+
+            _mm_storeu_ps(out, x);
+        }
+    }
+
+    EQUALIZER_TARGET("avx2,fma")
+    void cascadeAvx2(const float *coefficients, float *state, int sectionCount, float *samples, int frameCount)
+    {
+        for (int frame = 0; frame < frameCount; ++frame) {
+            float *out = samples + frame * 8;
+            __m256 x = _mm256_loadu_ps(out);
+            const float *c = coefficients;
+            float *s = state;
+
+            for (int section = 0; section < sectionCount; ++section, c += 40, s += 16) {
+                const __m256 y = _mm256_fmadd_ps(_mm256_loadu_ps(c), x, _mm256_loadu_ps(s));
+                const __m256 s1 = _mm256_fmadd_ps(_mm256_loadu_ps(c + 8), x,
+                                                  _mm256_fnmadd_ps(_mm256_loadu_ps(c + 24), y, _mm256_loadu_ps(s + 8)));
+                const __m256 s2 = _mm256_fnmadd_ps(_mm256_loadu_ps(c + 32), y,
+                                                   _mm256_mul_ps(_mm256_loadu_ps(c + 16), x));
+                _mm256_storeu_ps(s, s1);
+                _mm256_storeu_ps(s + 8, s2);
+                x = y;
+            }
+
+            _mm256_storeu_ps(out, x);
+        }
+    }
+
+    EQUALIZER_TARGET("avx512f")
+    void cascadeAvx512(const float *coefficients, float *state, int sectionCount, float *samples, int frameCount)
+    {
+        for (int frame = 0; frame < frameCount; ++frame) {
+            float *out = samples + frame * 16;
+            __m512 x = _mm512_loadu_ps(out);
+            const float *c = coefficients;
+            float *s = state;
+
+            for (int section = 0; section < sectionCount; ++section, c += 80, s += 32) {
+                const __m512 y = _mm512_fmadd_ps(_mm512_loadu_ps(c), x, _mm512_loadu_ps(s));
+                const __m512 s1 = _mm512_fmadd_ps(_mm512_loadu_ps(c + 16), x,
+                                                  _mm512_fnmadd_ps(_mm512_loadu_ps(c + 48), y, _mm512_loadu_ps(s + 16)));
+                const __m512 s2 = _mm512_fnmadd_ps(_mm512_loadu_ps(c + 64), y,
+                                                   _mm512_mul_ps(_mm512_loadu_ps(c + 32), x));
+                _mm512_storeu_ps(s, s1);
+                _mm512_storeu_ps(s + 16, s2);
+                x = y;
+            }
+
+            _mm512_storeu_ps(out, x);
+        }
+    }
+
+    // Unrolled variants for a section count known at compile time. Sections
+    // is 0..n-1; expanding it spells the cascade out section by section, and
+    // since every index is then a constant the state stays in registers (or
+    // in fixed stack slots once there are more sections than registers) for
+    // the whole block instead of going through memory every frame. The
+    // arithmetic is the same as in the loops above, so the results are
+    // bit-exact with them.
+
+    EQUALIZER_TARGET("sse2")
+    inline __m128 sectionSse2(const float *c, __m128 &s1, __m128 &s2, __m128 x)
+    {
+        const __m128 y = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(c), x), s1);
+        s1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(c + 4), x), _mm_mul_ps(_mm_loadu_ps(c + 12), y)), s2);
+        s2 = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(c + 8), x), _mm_mul_ps(_mm_loadu_ps(c + 16), y));
+        return y;
+    }
+
+    template <int... Sections>
+    EQUALIZER_TARGET("sse2")
+    void cascadeSse2Unrolled(const float *coefficients, float *state, int, float *samples, int frameCount)
+    {
+        __m128 s1[] = {_mm_loadu_ps(state + Sections * 8)...};
+        __m128 s2[] = {_mm_loadu_ps(state + Sections * 8 + 4)...};
+
+        for (int frame = 0; frame < frameCount; ++frame) {
+            float *out = samples + frame * 4;
+            __m128 x = _mm_loadu_ps(out);
+            const int cascade[] = {(x = sectionSse2(coefficients + Sections * 20, s1[Sections], s2[Sections], x), 0)...};
+            (void)cascade;
+            _mm_storeu_ps(out, x);
+        }
+
+        const int save[] = {(_mm_storeu_ps(state + Sections * 8, s1[Sections]),
+                             _mm_storeu_ps(state + Sections * 8 + 4, s2[Sections]), 0)...};
+        (void)save;
+    }
+
+    EQUALIZER_TARGET("avx2,fma")
+    inline __m256 sectionAvx2(const float *c, __m256 &s1, __m256 &s2, __m256 x)
+    {
+        const __m256 y = _mm256_fmadd_ps(_mm256_loadu_ps(c), x, s1);
+        s1 = _mm256_fmadd_ps(_mm256_loadu_ps(c + 8), x, _mm256_fnmadd_ps(_mm256_loadu_ps(c + 24), y, s2));
+        s2 = _mm256_fnmadd_ps(_mm256_loadu_ps(c + 32), y, _mm256_mul_ps(_mm256_loadu_ps(c + 16), x));
+        return y;
+    }
+
+    template <int... Sections>
+    EQUALIZER_TARGET("avx2,fma")
+    void cascadeAvx2Unrolled(const float *coefficients, float *state, int, float *samples, int frameCount)
+    {
+        __m256 s1[] = {_mm256_loadu_ps(state + Sections * 16)...};
+        __m256 s2[] = {_mm256_loadu_ps(state + Sections * 16 + 8)...};
+
+        for (int frame = 0; frame < frameCount; ++frame) {
+            float *out = samples + frame * 8;
+            __m256 x = _mm256_loadu_ps(out);
+            const int cascade[] = {(x = sectionAvx2(coefficients + Sections * 40, s1[Sections], s2[Sections], x), 0)...};
+            (void)cascade;
+            _mm256_storeu_ps(out, x);
+        }
+
+        const int save[] = {(_mm256_storeu_ps(state + Sections * 16, s1[Sections]),
+                             _mm256_storeu_ps(state + Sections * 16 + 8, s2[Sections]), 0)...};
+        (void)save;
+    }
+
+    EQUALIZER_TARGET("avx512f")
+    inline __m512 sectionAvx512(const float *c, __m512 &s1, __m512 &s2, __m512 x)
+    {
+        const __m512 y = _mm512_fmadd_ps(_mm512_loadu_ps(c), x, s1);
+        s1 = _mm512_fmadd_ps(_mm512_loadu_ps(c + 16), x, _mm512_fnmadd_ps(_mm512_loadu_ps(c + 48), y, s2));
+        s2 = _mm512_fnmadd_ps(_mm512_loadu_ps(c + 64), y, _mm512_mul_ps(_mm512_loadu_ps(c + 32), x));
+        return y;
+    }
+
+    template <int... Sections>
+    EQUALIZER_TARGET("avx512f")
+    void cascadeAvx512Unrolled(const float *coefficients, float *state, int, float *samples, int frameCount)
+    {
+        __m512 s1[] = {_mm512_loadu_ps(state + Sections * 32)...};
+        __m512 s2[] = {_mm512_loadu_ps(state + Sections * 32 + 16)...};
+
+        for (int frame = 0; frame < frameCount; ++frame) {
+            float *out = samples + frame * 16;
+            __m512 x = _mm512_loadu_ps(out);
+            const int cascade[] = {(x = sectionAvx512(coefficients + Sections * 80, s1[Sections], s2[Sections], x), 0)...};
+            (void)cascade;
+            _mm512_storeu_ps(out, x);
+        }
+
+        const int save[] = {(_mm512_storeu_ps(state + Sections * 32, s1[Sections]),
+                             _mm512_storeu_ps(state + Sections * 32 + 16, s2[Sections]), 0)...};
+        (void)save;
+    }
+
+    // Each ISA runs the cascade in chunks of at most ChunkSections sections,
+    // the whole block through one chunk before the next, so a chunk's state
+    // fits in the vector registers and the out-of-order window spans several
+    // frames of it. Chunking does not change the arithmetic either.
+    struct Sse2Chunk
+    {
+        static const int Lanes = 4;
+        static const int ChunkSections = 6;
+
+        template <int... Sections>
+        static void run(std::integer_sequence<int, Sections...>, const float *coefficients, float *state,
+                        float *samples, int frameCount)
+        {
+            cascadeSse2Unrolled<Sections...>(coefficients, state, sizeof...(Sections), samples, frameCount);
+        }
+    };
+
+    struct Avx2Chunk
+    {
+        static const int Lanes = 8;
+        static const int ChunkSections = 6;
+
+        template <int... Sections>
+        static void run(std::integer_sequence<int, Sections...>, const float *coefficients, float *state,
+                        float *samples, int frameCount)
+        {
+            cascadeAvx2Unrolled<Sections...>(coefficients, state, sizeof...(Sections), samples, frameCount);
+        }
+    };
+
+    struct Avx512Chunk
+    {
+        static const int Lanes = 16;
+        static const int ChunkSections = 12;
+
+        template <int... Sections>
+        static void run(std::integer_sequence<int, Sections...>, const float *coefficients, float *state,
+                        float *samples, int frameCount)
+        {
+            cascadeAvx512Unrolled<Sections...>(coefficients, state, sizeof...(Sections), samples, frameCount);
+        }
+    };
+
+    // Splits Remaining sections into chunks of as equal a size as
+    // ChunkSections allows.
+    template <typename Chunk, int Remaining>
+    struct Chunks
+    {
+        static void run(const float *coefficients, float *state, float *samples, int frameCount)
+        {
+            const int chunkCount = (Remaining + Chunk::ChunkSections - 1) / Chunk::ChunkSections;
+            const int count = (Remaining + chunkCount - 1) / chunkCount;
+            Chunk::run(std::make_integer_sequence<int, count>(), coefficients, state, samples, frameCount);
+            Chunks<Chunk, Remaining - count>::run(coefficients + count * 5 * Chunk::Lanes,
+                                                  state + count * 2 * Chunk::Lanes, samples, frameCount);
+        }
+    };
+
+    template <typename Chunk>
+    struct Chunks<Chunk, 0>
+    {
+        static void run(const float *, float *, float *, int)
+        {
+        }
+    };
+
+    template <typename Chunk, int SectionCount>
+    void cascadeUnrolled(const float *coefficients, float *state, int, float *samples, int frameCount)
+    {
+        Chunks<Chunk, SectionCount>::run(coefficients, state, samples, frameCount);
+    }
+
+    // One kernel per section count from 1 to the layout's band count; entry
+    // i runs i + 1 sections.
+    template <int... Counts>
+    BiquadKernels::CascadeFunction unrolledCascade(BiquadKernels::Isa isa, int sectionCount,
+                                                   std::integer_sequence<int, Counts...>)
+    {
+        static constexpr BiquadKernels::CascadeFunction Sse2[] = {
+            cascadeUnrolled<Sse2Chunk, Counts + 1>...
+        };
+        static constexpr BiquadKernels::CascadeFunction Avx2[] = {
+            cascadeUnrolled<Avx2Chunk, Counts + 1>...
+        };
+        static constexpr BiquadKernels::CascadeFunction Avx512[] = {
+            cascadeUnrolled<Avx512Chunk, Counts + 1>...
+        };
+
+        switch (isa) {
+        case BiquadKernels::Sse2:
+            return Sse2[sectionCount - 1];
+        case BiquadKernels::Avx2:
+            return Avx2[sectionCount - 1];
+        case BiquadKernels::Avx512:
+            return Avx512[sectionCount - 1];
+        default:
+            return nullptr;
+        }
+    }
+#endif
+
+    BiquadKernels::Isa detectIsa()
+    {
+#if defined(EQUALIZER_X86) && (defined(__GNUC__) || defined(__clang__))
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return BiquadKernels::Avx512;
+        }
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+            return BiquadKernels::Avx2;
+        }
+        if (__builtin_cpu_supports("sse2")) {
+            return BiquadKernels::Sse2;
+        }
+        return BiquadKernels::Scalar;
+#elif defined(EQUALIZER_X86) && (defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+        // SSE2 is the baseline of every target built this way.
+        return BiquadKernels::Sse2;
+#else
+        return BiquadKernels::Scalar;
+#endif
+    }
+
+    BiquadKernels::Isa hardwareIsa()
+    {
+        static const BiquadKernels::Isa isa = detectIsa();
+        return isa;
+    }
+
+    BiquadKernels::Kernel makeKernel(BiquadKernels::Isa isa, int laneCount, BiquadKernels::CascadeFunction process)
+    {
+        BiquadKernels::Kernel kernel;
+        kernel.isa = isa;
+        kernel.laneCount = laneCount;
+        kernel.process = process;
+        return kernel;
+    }
+}
+
+const char *BiquadKernels::isaName(Isa isa)
+{
+    switch (isa) {
+    case Scalar:
+        return "scalar";
+    case Sse2:
+        return "sse2";
+    case Avx2:
+        return "avx2";
+    case Avx512:
+        return "avx512";
+    }
+
+    return "unknown";
+}
+
+bool BiquadKernels::isaFromName(const char *name, Isa *isa)
+{
+    if (!name || !isa) {
+        return false;
+    }
+
+    for (Isa candidate : {Scalar, Sse2, Avx2, Avx512}) {
+        if (std::strcmp(name, isaName(candidate)) == 0) {
+            *isa = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+BiquadKernels::Isa BiquadKernels::hostIsa()
+{
+    static const Isa isa = [] {
+        Isa detected = hardwareIsa();
+        Isa requested;
+        if (isaFromName(std::getenv("EQUALIZER_MAX_ISA"), &requested) && requested < detected) {
+            detected = requested;
+        }
+        return detected;
+    }();
+
+    return isa;
+}
+
+bool BiquadKernels::isSupported(Isa isa)
+{
+    return isa <= hardwareIsa();
+}
+
+BiquadKernels::Kernel BiquadKernels::select(int laneCount, Isa maximumIsa)
+{
+    if (maximumIsa > hardwareIsa()) {
+        maximumIsa = hardwareIsa();
+    }
+
+#ifdef EQUALIZER_X86
+    const Kernel candidates[] = {
+        makeKernel(Sse2, 4, cascadeSse2),
+        makeKernel(Avx2, 8, cascadeAvx2),
+        makeKernel(Avx512, 16, cascadeAvx512)
+    };
+
+    Kernel widest = scalarReference(16);
+    bool hasSimd = false;
+    for (const Kernel &candidate : candidates) {
+        if (candidate.isa > maximumIsa) {
+            break;
+        }
+        if (candidate.laneCount >= laneCount) {
+            return candidate;
+        }
+        widest = candidate;
+        hasSimd = true;
+    }
+
+    if (hasSimd) {
+        return widest;
+    }
+#endif
+
+    int lanes = 1;
+    while (lanes < laneCount && lanes < 16) {
+        lanes *= 2;
+    }
+    return scalarReference(lanes);
+}
+
+BiquadKernels::Kernel BiquadKernels::select(int laneCount)
+{
+    return select(laneCount, hostIsa());
+}
+
+BiquadKernels::Kernel BiquadKernels::scalarReference(int laneCount)
+{
+    switch (laneCount) {
+    case 1:
+        return makeKernel(Scalar, 1, cascadeScalar<1>);
+    case 2:
+        return makeKernel(Scalar, 2, cascadeScalar<2>);
+    case 4:
+        return makeKernel(Scalar, 4, cascadeScalar<4>);
+    case 8:
+        return makeKernel(Scalar, 8, cascadeScalar<8>);
+    default:
+        return makeKernel(Scalar, 16, cascadeScalar<16>);
+    }
+}
+
+BiquadKernels::CascadeFunction BiquadKernels::unrolled(const Kernel &kernel, int sectionCount)
+{
+#ifdef EQUALIZER_X86
+    if (kernel.isa != Scalar && sectionCount >= 1 && sectionCount <= EqualizerBands::Count) {
+        return unrolledCascade(kernel.isa, sectionCount, std::make_integer_sequence<int, EqualizerBands::Count>());
+    }
+#endif
+
+    return kernel.process;
+}
@@ -0,0 +1,62 @@
+#ifndef BIQUADKERNELS_H
+#define BIQUADKERNELS_H
+
+// Cascaded biquad kernels that run several independent signals ("lanes") in
+// parallel, one SIMD lane each. Everything is laid out structure-of-arrays
+// with the lane index innermost:
+//
+//   samples      [frame][lane]
+//   coefficients [section][b0 b1 b2 a1 a2][lane]
+//   state        [section][s1 s2][lane]
+//
+// so a lane can be a channel of one stream or a whole mono stream of many,
+// each with its own coefficients. Sections run in transposed direct form II.
+//
+// All ISA variants are compiled into the same binary with per-function
+// target attributes and picked at run time, so one build runs on SSE2-only
+// machines and uses AVX2/AVX-512 where the host has them.
+namespace BiquadKernels
+{
+    enum Isa
+    {
+        Scalar,
+        Sse2,
+        Avx2,
+        Avx512
+    };
+
+    typedef void (*CascadeFunction)(const float *coefficients, float *state, int sectionCount,
+                                    float *samples, int frameCount);
+
+    struct Kernel
+    {
+        Isa isa;
+        int laneCount;
+        CascadeFunction process;
+    };
+
+    const char *isaName(Isa isa);
+    bool isaFromName(const char *name, Isa *isa);
+
+    // Widest ISA the host supports, capped by the EQUALIZER_MAX_ISA
+    // environment variable ("scalar", "sse2", "avx2", "avx512") if set.
+    Isa hostIsa();
+    bool isSupported(Isa isa);
+
+    // Narrowest kernel, up to maximumIsa, that covers laneCount lanes in one
+    // pass; if none does, the widest one available.
+    Kernel select(int laneCount, Isa maximumIsa);
+    Kernel select(int laneCount);
+
+    // Variant of kernel for exactly sectionCount sections, with the cascade
+    // unrolled and the state kept in registers across the block; generated
+    // for every count up to EqualizerBands::Count. Other counts, and the
+    // scalar kernels, get kernel.process back. Both give the same results.
+    CascadeFunction unrolled(const Kernel &kernel, int sectionCount);
+
+    // Plain C++ kernel with the same layout, kept as the reference the SIMD
+    // variants are verified against. laneCount must be 1, 2, 4, 8 or 16.
+    Kernel scalarReference(int laneCount);
+}
+
+#endif // BIQUADKERNELS_H
@@ -0,0 +1,275 @@
+#ifndef BLOCKPIPELINE_H
+#define BLOCKPIPELINE_H
+
+#include "SampleConversion.h"
+#include "WavFormat.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Converts PCM from one sample format to another through a chain of float
+// stages. Rather than making a full pass over the buffer per step (decode
+// everything, filter everything, ...), the input is cut into blocks of
+// BlockSamples that are decoded, run through every stage and encoded while
+// they are still in L1, so each sample leaves the cache once.
+//
+// The stages are template parameters and are called directly, in order; a
+// stage is any type with
+//
+//   void process(float *samples, int frameCount);
+//
+// working in place on interleaved samples. Stages are called once per block,
+// so a stage may branch per call (on an enable flag, say) at no real cost,
+// but nothing in the chain is dispatched per sample.
+//
+// A stage that changes the sample rate (see Resampler.h) instead has
+//
+//   int process(float *samples, int frameCount);
+//   int maximumOutputFrames(int frameCount) const;
+//   int flush(float *samples, int maximumFrames);
+//
+// and returns the number of frames it left in samples, which is what the
+// stages after it see. Blocks are made short enough that no stage's output
+// overflows the block buffer, and flush() drains what such stages hold back
+// at the end of the stream.
+//
+// output may alias input when the output sample format is no wider than the
+// input one and no stage raises the frame count.
+template <typename... Stages>
+class BlockPipeline
+{
+public:
+    // 8 KiB of floats; leaves room in L1 for the cascade's own lane buffer.
+    static const int BlockSamples = 2048;
+
+    BlockPipeline(SampleFormat inputFormat, SampleFormat outputFormat, int channels, Stages... stages)
+        : m_inputFormat(inputFormat)
+        , m_outputFormat(outputFormat)
+        , m_channels(std::max(1, channels))
+        , m_blockFrames(0)
+        , m_stages(std::move(stages)...)
+    {
+        // The longest block whose frame count never exceeds the buffer at
+        // any point of the chain, including the tails flush() starts from.
+        const int capacity = std::max(1, BlockSamples / m_channels);
+        int low = 1;
+        int high = capacity;
+        while (low < high) {
+            const int frames = (low + high + 1) / 2;
+            if (peakFrames(frames, std::index_sequence_for<Stages...>()) <= capacity) {
+                low = frames;
+            } else {
+                high = frames - 1;
+            }
+        }
+        m_blockFrames = low;
+    }
+
+    SampleFormat inputFormat() const
+    {
+        return m_inputFormat;
+    }
+
+    SampleFormat outputFormat() const
+    {
+        return m_outputFormat;
+    }
+
+    int channels() const
+    {
+        return m_channels;
+    }
+
+    // Input frames per block.
+    int blockFrames() const
+    {
+        return m_blockFrames;
+    }
+
+    template <size_t Index>
+    typename std::tuple_element<Index, std::tuple<Stages...>>::type &stage()
+    {
+        return std::get<Index>(m_stages);
+    }
+
+    template <size_t Index>
+    const typename std::tuple_element<Index, std::tuple<Stages...>>::type &stage() const
+    {
+        return std::get<Index>(m_stages);
+    }
+
+    // Returns the number of frames written to output, frameCount unless a
+    // stage changes the rate.
+    int process(const void *input, void *output, int frameCount)
+    {
+        const size_t inputFrameSize = static_cast<size_t>(SampleFormats::bytesPerSample(m_inputFormat)) * m_channels;
+        const unsigned char *in = static_cast<const unsigned char *>(input);
+        unsigned char *out = static_cast<unsigned char *>(output);
+        int written = 0;
+
+        for (int offset = 0; offset < frameCount; offset += m_blockFrames) {
+            const int frames = std::min(m_blockFrames, frameCount - offset);
+
+            SampleConversion::toFloat(m_inputFormat, in + offset * inputFrameSize, m_block,
+                                      static_cast<size_t>(frames) * m_channels);
+            const int produced = processStages(0, frames, std::index_sequence_for<Stages...>());
+            written += encode(out, written, produced);
+        }
+
+        return written;
+    }
+
+    // Most frames process(frameCount) writes.
+    int maximumOutputFrames(int frameCount) const
+    {
+        const int blocks = frameCount / m_blockFrames;
+        const int remainder = frameCount - blocks * m_blockFrames;
+        int frames = blocks * outputFrames(0, m_blockFrames, std::index_sequence_for<Stages...>());
+        if (remainder > 0) {
+            frames += outputFrames(0, remainder, std::index_sequence_for<Stages...>());
+        }
+        return frames;
+    }
+
+    // Ends the stream: writes the next piece of what rate-changing stages
+    // still hold back, at most BlockSamples / channels() frames, and
+    // returns its length. Call it until it returns 0. A chain without
+    // such stages has nothing to flush.
+    int flush(void *output)
+    {
+        return flushStages(static_cast<unsigned char *>(output), std::index_sequence_for<Stages...>());
+    }
+
+private:
+    SampleFormat m_inputFormat;
+    SampleFormat m_outputFormat;
+    int m_channels;
+    int m_blockFrames;
+    std::tuple<Stages...> m_stages;
+    alignas(64) float m_block[BlockSamples];
+
+    // A stage changes the rate if its process() says how many frames it
+    // returned.
+    template <typename Stage>
+    using ChangesRate = std::is_same<decltype(std::declval<Stage &>().process(std::declval<float *>(), 0)), int>;
+
+    template <typename Stage>
+    static int run(Stage &stage, float *samples, int frameCount, std::true_type)
+    {
+        return stage.process(samples, frameCount);
+    }
+
+    template <typename Stage>
+    static int run(Stage &stage, float *samples, int frameCount, std::false_type)
+    {
+        stage.process(samples, frameCount);
+        return frameCount;
+    }
+
+    template <typename Stage>
+    static int bound(const Stage &stage, int frameCount, std::true_type)
+    {
+        return stage.maximumOutputFrames(frameCount);
+    }
+
+    template <typename Stage>
+    static int bound(const Stage &, int frameCount, std::false_type)
+    {
+        return frameCount;
+    }
+
+    template <typename Stage>
+    static int drain(Stage &stage, float *samples, int maximumFrames, std::true_type)
+    {
+        return stage.flush(samples, maximumFrames);
+    }
+
+    template <typename Stage>
+    static int drain(Stage &, float *, int, std::false_type)
+    {
+        return 0;
+    }
+
+    int encode(unsigned char *output, int offset, int frames)
+    {
+        const size_t outputFrameSize = static_cast<size_t>(SampleFormats::bytesPerSample(m_outputFormat)) * m_channels;
+        SampleConversion::fromFloat(m_outputFormat, m_block, output + offset * outputFrameSize,
+                                    static_cast<size_t>(frames) * m_channels);
+        return frames;
+    }
+
+    // Runs the block through the stages from first on and returns the
+    // frames left in it. Once a stage returns nothing the rest are skipped.
+    template <size_t... Indices>
+    int processStages(size_t first, int frames, std::index_sequence<Indices...>)
+    {
+        // Expands to one direct call per stage, in declaration order.
+        const int calls[] = {0, (Indices >= first && frames > 0
+                                 ? (frames = run(std::get<Indices>(m_stages), m_block, frames,
+                                                 ChangesRate<Stages>()), 0)
+                                 : 0)...};
+        (void)calls;
+        return frames;
+    }
+
+    template <size_t... Indices>
+    int outputFrames(size_t first, int frames, std::index_sequence<Indices...>) const
+    {
+        const int calls[] = {0, (Indices >= first
+                                 ? (frames = bound(std::get<Indices>(m_stages), frames, ChangesRate<Stages>()), 0)
+                                 : 0)...};
+        (void)calls;
+        return frames;
+    }
+
+    // Largest frame count a block of frames reaches anywhere in the chain,
+    // or a flushed piece of frames anywhere after the stage it came from.
+    template <size_t... Indices>
+    int peakFrames(int frames, std::index_sequence<Indices...>) const
+    {
+        int peak = frames;
+        for (size_t first = 0; first <= sizeof...(Stages); ++first) {
+            int stageFrames = frames;
+            const int calls[] = {0, (Indices >= first
+                                     ? (stageFrames = bound(std::get<Indices>(m_stages), stageFrames,
+                                                            ChangesRate<Stages>()),
+                                        peak = std::max(peak, stageFrames), 0)
+                                     : 0)...};
+            (void)calls;
+        }
+        return peak;
+    }
+
+    // Drains the first stage that still holds frames back and runs them
+    // through the stages after it, until some reach the output.
+    template <size_t... Indices>
+    int flushStages(unsigned char *output, std::index_sequence<Indices...>)
+    {
+        for (;;) {
+            bool drained = false;
+            int frames = 0;
+            const int calls[] = {0, (!drained
+                                     ? (frames = drain(std::get<Indices>(m_stages), m_block, m_blockFrames,
+                                                       ChangesRate<Stages>()),
+                                        drained = frames > 0,
+                                        frames = drained ? processStages(Indices + 1, frames,
+                                                                         std::index_sequence_for<Stages...>())
+                                                         : 0,
+                                        0)
+                                     : 0)...};
+            (void)calls;
+
+            if (!drained) {
+                return 0;
+            }
+            if (frames > 0) {
+                return encode(output, 0, frames);
+            }
+        }
+    }
+};
+
+#endif // BLOCKPIPELINE_H
@@ -0,0 +1,87 @@
+#include "EqualizerBands.h"
+
+#include <cmath>
+
+namespace
+{
+    constexpr double Pi = 3.14159265358979323846;
+}
+
+constexpr double EqualizerBands::Layout<5>::Frequencies[];
+constexpr double EqualizerBands::Layout<5>::Q;
+constexpr double EqualizerBands::Layout<10>::Frequencies[];
+constexpr double EqualizerBands::Layout<10>::Q;
+constexpr double EqualizerBands::Layout<15>::Frequencies[];
+constexpr double EqualizerBands::Layout<15>::Q;
+constexpr double EqualizerBands::Layout<31>::Frequencies[];
+constexpr double EqualizerBands::Layout<31>::Q;
+
+const double *EqualizerBands::frequenciesFor(int count)
+{
+    switch (count) {
+    case 5:
+        return Layout<5>::Frequencies;
+    case 10:
+        return Layout<10>::Frequencies;
+    case 15:
+        return Layout<15>::Frequencies;
+    case 31:
+        return Layout<31>::Frequencies;
+    default:
+        return nullptr;
+    }
+}
+
+bool EqualizerBands::isAvailable(int band, double sampleRate)
+{
+    return band >= 0 && band < Count && Frequencies[band] < 0.5 * sampleRate;
+}
+
+bool EqualizerBands::isUpperBand(int band, double sampleRate)
+{
+    return isAvailable(band, sampleRate) && Frequencies[band] > 0.125 * sampleRate;
+}
+
+double EqualizerBands::slowestTimeConstant()
+{
+    const double amplitude = std::pow(10.0, MaximumGain / 40.0);
+    return amplitude * Q / (Pi * Frequencies[0]);
+}
+
+bool EqualizerBands::resample(const int *sourceGains, int sourceCount, int *gains)
+{
+    const double *sourceFrequencies = frequenciesFor(sourceCount);
+    if (!sourceGains || !sourceFrequencies || !gains) {
+        return false;
+    }
+
+    if (sourceFrequencies == Frequencies) {
+        for (int band = 0; band < Count; ++band) {
+            gains[band] = sourceGains[band];
+        }
+        return true;
+    }
+
+    int upper = 0;
+    for (int band = 0; band < Count; ++band) {
+        const double frequency = Frequencies[band];
+        while (upper < sourceCount && sourceFrequencies[upper] < frequency) {
+            ++upper;
+        }
+
+        double gain;
+        if (upper == 0) {
+            gain = sourceGains[0];
+        } else if (upper == sourceCount) {
+            gain = sourceGains[sourceCount - 1];
+        } else {
+            const double low = std::log(sourceFrequencies[upper - 1]);
+            const double position = (std::log(frequency) - low) / (std::log(sourceFrequencies[upper]) - low);
+            gain = sourceGains[upper - 1] + position * (sourceGains[upper] - sourceGains[upper - 1]);
+        }
+
+        gains[band] = static_cast<int>(std::lround(gain));
+    }
+
+    return true;
+}
@@ -0,0 +1,109 @@
+#ifndef EQUALIZERBANDS_H
+#define EQUALIZERBANDS_H
+
+// Band layout shared by the DSP engine, its coefficient tables and kernels,
+// the preset store and the widgets. The layout is fixed at compile time;
+// build with EQUALIZER_BANDS=5, 10, 15 or 31 (qmake EQUALIZER_BANDS=31) to
+// pick another one.
+#ifndef EQUALIZER_BANDS
+#define EQUALIZER_BANDS 10
+#endif
+
+namespace EqualizerBands
+{
+    template <int Bands>
+    struct Layout;
+
+    // Two octaves apart.
+    template <>
+    struct Layout<5>
+    {
+        static constexpr int Count = 5;
+        static constexpr double Frequencies[Count] = {
+            63.0, 250.0, 1000.0, 4000.0, 16000.0
+        };
+        static constexpr double Q = 0.66666666666666666667;
+    };
+
+    // One octave apart, as laid out before the layout became selectable.
+    template <>
+    struct Layout<10>
+    {
+        static constexpr int Count = 10;
+        static constexpr double Frequencies[Count] = {
+            31.0, 62.0, 125.0, 250.0, 500.0, 1000.0, 2000.0, 4000.0, 8000.0, 16000.0
+        };
+        static constexpr double Q = 1.41421356237309504880;
+    };
+
+    // ISO 266 two-thirds octave centres.
+    template <>
+    struct Layout<15>
+    {
+        static constexpr int Count = 15;
+        static constexpr double Frequencies[Count] = {
+            25.0, 40.0, 63.0, 100.0, 160.0, 250.0, 400.0, 630.0, 1000.0, 1600.0, 2500.0, 4000.0, 6300.0, 10000.0,
+            16000.0
+        };
+        static constexpr double Q = 2.14490771794375737142;
+    };
+
+    // ISO 266 third octave centres, the usual mastering graphic EQ.
+    template <>
+    struct Layout<31>
+    {
+        static constexpr int Count = 31;
+        static constexpr double Frequencies[Count] = {
+            20.0, 25.0, 31.5, 40.0, 50.0, 63.0, 80.0, 100.0, 125.0, 160.0, 200.0, 250.0, 315.0, 400.0, 500.0, 630.0,
+            800.0, 1000.0, 1250.0, 1600.0, 2000.0, 2500.0, 3150.0, 4000.0, 5000.0, 6300.0, 8000.0, 10000.0, 12500.0,
+            16000.0, 20000.0
+        };
+        static constexpr double Q = 4.31847304696314663972;
+    };
+
+    typedef Layout<EQUALIZER_BANDS> Current;
+
+    constexpr int Count = Current::Count;
+
+    // Centre frequencies of the sliders EqualizerWidget::initializeBands()
+    // creates.
+    constexpr const double *Frequencies = Current::Frequencies;
+
+    // Matches the spacing of the bands, so neighbours meet at -3 dB.
+    constexpr double Q = Current::Q;
+
+    // Range and step of the sliders in EqualizerWidget::initializeBands().
+    constexpr int MinimumGain = -12;
+    constexpr int MaximumGain = 12;
+    constexpr int GainSteps = MaximumGain - MinimumGain + 1;
+
+    // Whether a band can be realised at sampleRate: its centre must lie
+    // below the Nyquist frequency. The engine leaves the other bands out and
+    // the widgets show them as unavailable; the 4 and 8 kHz bands of the
+    // octave layout at 8000 Hz, say.
+    bool isAvailable(int band, double sampleRate);
+
+    // Available bands above a quarter of the Nyquist frequency, where the
+    // bilinear transform noticeably narrows and skews a peaking section.
+    // These are the bands EqualizerEngine::setOversampling() moves to the
+    // higher rate.
+    bool isUpperBand(int band, double sampleRate);
+
+    // Time constant in seconds of the slowest decaying band at full boost.
+    // A peaking section of gain A^2 rings down as exp(-t pi f0 / (A Q)),
+    // so this is the lowest band of the layout with the highest Q.
+    double slowestTimeConstant();
+
+    // Centre frequencies of the layout with count bands, or null if there is
+    // no such layout.
+    const double *frequenciesFor(int count);
+
+    // Maps gains written for the layout with sourceCount bands onto this
+    // build's layout, interpolating linearly in log frequency and holding
+    // the end values beyond the source's first and last band. Returns false,
+    // leaving gains untouched, if sourceCount names no layout. The two arrays
+    // must not overlap.
+    bool resample(const int *sourceGains, int sourceCount, int *gains);
+}
+
+#endif // EQUALIZERBANDS_H
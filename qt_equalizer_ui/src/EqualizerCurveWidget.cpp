@@ -1,5 +1,6 @@
 #include "EqualizerCurveWidget.h"
 
+#include <QElapsedTimer>
 #include <QMouseEvent>
 #include <QEvent>
 #include <QPainter>
@@ -11,6 +12,7 @@
 
 #include <QtGlobal>
 
+#include <cmath>
 #include <limits>
 
 namespace
@@ -18,6 +20,26 @@ namespace
     constexpr qreal CurveMargin = 16.0;
     constexpr qreal PointRadius = 6.0;
     constexpr qreal HoverDistance = 12.0;
+
+    constexpr qreal CurvePenWidth = 2.0;
+    constexpr qreal PointPenWidth = 1.2;
+    // Curve points that moved less than this are left alone when working
+    // out what a band change repaints.
+    constexpr qreal CurveTolerance = 0.05;
+
+    // Points of the response curve, log-spaced from the first to the last
+    // band; a few per pixel at typical widths.
+    constexpr int ResponsePointCount = 256;
+
+    FrequencyResponse makeResponse(double sampleRate)
+    {
+        return FrequencyResponse(sampleRate, ResponsePointCount,
+                                 EqualizerBands::Frequencies[0], EqualizerBands::Frequencies[EqualizerBands::Count - 1]);
+    }
+
+    // The spectrum is scaled so 0 dBFS is the top of the curve area and
+    // SpectrumRangeDb below it the bottom.
+    constexpr qreal SpectrumRangeDb = 90.0;
 }
 
 EqualizerCurveWidget::EqualizerCurveWidget(QWidget *parent)
@@ -27,6 +49,11 @@ EqualizerCurveWidget::EqualizerCurveWidget(QWidget *parent)
     , m_maxGain(12)
     , m_activeBand(-1)
     , m_isDragging(false)
+    , m_response(makeResponse(48000.0))
+    , m_isStaticLayerValid(false)
+    , m_isCurveValid(false)
+    , m_paintCount(0)
+    , m_paintNanoseconds(0)
 {
     setMouseTracking(true);
 }
@@ -47,11 +74,12 @@ void EqualizerCurveWidget::setMinimumGain(int minimumGain)
         m_maxGain = m_minGain + 1;
     }
 
-    for (int &value : m_bandValues) {
-        value = qBound(m_minGain, value, m_maxGain);
+    for (int i = 0; i < m_bandValues.size(); ++i) {
+        m_bandValues[i] = qBound(m_minGain, m_bandValues.at(i), m_maxGain);
+        updateResponse(i);
     }
 
-    update();
+    invalidateLayers();
 }
 
 int EqualizerCurveWidget::maximumGain() const
@@ -70,11 +98,12 @@ void EqualizerCurveWidget::setMaximumGain(int maximumGain)
         m_minGain = m_maxGain - 1;
     }
 
-    for (int &value : m_bandValues) {
-        value = qBound(m_minGain, value, m_maxGain);
+    for (int i = 0; i < m_bandValues.size(); ++i) {
+        m_bandValues[i] = qBound(m_minGain, m_bandValues.at(i), m_maxGain);
+        updateResponse(i);
     }
 
-    update();
+    invalidateLayers();
 }
 
 void EqualizerCurveWidget::setBandValues(const QVector<int> &values)
@@ -86,8 +115,10 @@ void EqualizerCurveWidget::setBandValues(const QVector<int> &values)
     for (int i = 0; i < BandCount; ++i) {
         const int requested = i < values.size() ? values.at(i) : 0;
         m_bandValues[i] = qBound(m_minGain, requested, m_maxGain);
+        updateResponse(i);
     }
 
+    m_isCurveValid = false;
     update();
 }
 
@@ -107,18 +138,160 @@ void EqualizerCurveWidget::setBandValue(int index, int value)
         return;
     }
 
+    const int previous = m_bandValues.at(index);
     m_bandValues[index] = clamped;
+    updateResponse(index);
+    updateCurve(index, previous);
+}
+
+double EqualizerCurveWidget::sampleRate() const
+{
+    return m_response.sampleRate();
+}
+
+void EqualizerCurveWidget::setSampleRate(double sampleRate)
+{
+    if (sampleRate <= 0.0 || sampleRate == m_response.sampleRate()) {
+        return;
+    }
+
+    const int oversampling = m_response.oversampling();
+    m_response = makeResponse(sampleRate);
+    m_response.setOversampling(oversampling);
+    m_response.setBandGains(m_bandValues.constData(), m_bandValues.size());
+    // The shading above the Nyquist frequency is part of the static layer.
+    invalidateLayers();
+}
+
+int EqualizerCurveWidget::oversampling() const
+{
+    return m_response.oversampling();
+}
+
+void EqualizerCurveWidget::setOversampling(int factor)
+{
+    if (factor == m_response.oversampling()) {
+        return;
+    }
+
+    m_response.setOversampling(factor);
+    m_isCurveValid = false;
     update();
 }
 
+void EqualizerCurveWidget::setSpectrum(const QVector<float> &levelsDb)
+{
+    if (m_spectrum.isEmpty() && levelsDb.isEmpty()) {
+        return;
+    }
+
+    m_spectrum = levelsDb;
+    update(curveRect().toAlignedRect());
+}
+
+int EqualizerCurveWidget::paintCount() const
+{
+    return m_paintCount;
+}
+
+qint64 EqualizerCurveWidget::paintNanoseconds() const
+{
+    return m_paintNanoseconds;
+}
+
+void EqualizerCurveWidget::resetPaintStatistics()
+{
+    m_paintCount = 0;
+    m_paintNanoseconds = 0;
+}
+
 void EqualizerCurveWidget::paintEvent(QPaintEvent *event)
 {
     Q_UNUSED(event);
 
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!m_isStaticLayerValid || !qFuzzyCompare(m_staticLayer.devicePixelRatioF(), devicePixelRatioF())) {
+        rebuildStaticLayer();
+    }
+    if (!m_isCurveValid) {
+        rebuildCurvePoints();
+    }
+
+    // Everything outside the update region is clipped away, so only the
+    // dirty strip is blitted and rasterised.
+    QPainter painter(this);
+    painter.drawPixmap(QPointF(0.0, 0.0), m_staticLayer);
+
+    const QRectF rect = curveRect();
+    if (rect.isValid() && rect.width() > 0.0 && rect.height() > 0.0 && !m_bandValues.isEmpty()) {
+        painter.setRenderHint(QPainter::Antialiasing, true);
+
+        drawSpectrum(&painter, rect);
+
+        QColor curveColor = palette().highlight().color();
+        if (!isEnabled()) {
+            curveColor = palette().mid().color();
+        }
+        curveColor.setAlpha(isEnabled() ? 220 : 150);
+
+        painter.setPen(QPen(curveColor, CurvePenWidth));
+        painter.drawPolyline(m_curvePoints.constData(), m_curvePoints.size());
+
+        QColor pointFill = curveColor;
+        pointFill.setAlpha(255);
+        QColor pointOutline = palette().dark().color();
+        pointOutline.setAlpha(isEnabled() ? 220 : 120);
+
+        QColor unavailableOutline = palette().mid().color();
+        unavailableOutline.setAlpha(isEnabled() ? 200 : 120);
+
+        for (int i = 0; i < m_bandValues.size(); ++i) {
+            const bool available = isBandAvailable(i);
+            painter.setPen(QPen(available ? pointOutline : unavailableOutline, PointPenWidth));
+            painter.setBrush(available ? QBrush(pointFill) : QBrush(Qt::NoBrush));
+            painter.drawEllipse(bandPosition(i), PointRadius, PointRadius);
+        }
+    }
+
+    ++m_paintCount;
+    m_paintNanoseconds += timer.nsecsElapsed();
+}
+
+void EqualizerCurveWidget::resizeEvent(QResizeEvent *event)
+{
+    invalidateLayers();
+    QWidget::resizeEvent(event);
+}
+
+void EqualizerCurveWidget::changeEvent(QEvent *event)
+{
+    switch (event->type()) {
+    case QEvent::PaletteChange:
+    case QEvent::EnabledChange:
+    case QEvent::StyleChange:
+        invalidateLayers();
+        break;
+    default:
+        break;
+    }
+
+    QWidget::changeEvent(event);
+}
+
+void EqualizerCurveWidget::rebuildStaticLayer()
+{
+    const qreal pixelRatio = devicePixelRatioF();
+    m_staticLayer = QPixmap(size() * pixelRatio);
+    m_staticLayer.setDevicePixelRatio(pixelRatio);
+    m_staticLayer.fill(Qt::transparent);
+    m_isStaticLayerValid = true;
+
     QStyleOption opt;
     opt.init(this);
 
-    QPainter painter(this);
+    QPainter painter(&m_staticLayer);
     style()->drawPrimitive(QStyle::PE_Widget, &opt, &painter, this);
 
     const QRectF rect = curveRect();
@@ -131,6 +304,18 @@ void EqualizerCurveWidget::paintEvent(QPaintEvent *event)
     QColor gridColor = palette().mid().color();
     gridColor.setAlpha(90);
 
+    // Nothing above the Nyquist frequency reaches the output. The x axis
+    // is log frequency from the first band to the last.
+    const double nyquist = 0.5 * m_response.sampleRate();
+    const double lowest = EqualizerBands::Frequencies[0];
+    const double highest = EqualizerBands::Frequencies[BandCount - 1];
+    if (nyquist < highest && highest > lowest) {
+        const qreal ratio = qMax(0.0, std::log(nyquist / lowest) / std::log(highest / lowest));
+        QColor shade = palette().mid().color();
+        shade.setAlpha(isEnabled() ? 60 : 30);
+        painter.fillRect(QRectF(QPointF(rect.left() + ratio * rect.width(), rect.top()), rect.bottomRight()), shade);
+    }
+
     painter.setPen(QPen(gridColor, 1.0, Qt::DashLine));
 
     for (int value : {m_minGain, 0, m_maxGain}) {
@@ -143,42 +328,81 @@ void EqualizerCurveWidget::paintEvent(QPaintEvent *event)
 
     painter.setPen(QPen(gridColor, 1.0));
     painter.drawRect(rect);
+}
 
-    if (m_bandValues.isEmpty()) {
+void EqualizerCurveWidget::rebuildCurvePoints()
+{
+    // The summed response of the cascade, spanning the same range as the
+    // band points, so x is linear in the point index.
+    const QRectF rect = curveRect();
+    const int pointCount = m_response.pointCount();
+    const float *responseDb = m_response.totalDb();
+
+    m_curvePoints.resize(pointCount);
+    for (int i = 0; i < pointCount; ++i) {
+        m_curvePoints[i] = QPointF(rect.left() + rect.width() * i / (pointCount - 1), yForGain(responseDb[i]));
+    }
+    m_isCurveValid = true;
+}
+
+void EqualizerCurveWidget::invalidateLayers()
+{
+    m_isStaticLayerValid = false;
+    m_isCurveValid = false;
+    update();
+}
+
+void EqualizerCurveWidget::updateCurve(int index, int previousValue)
+{
+    if (!m_isCurveValid) {
+        update();
         return;
     }
 
-    QPainterPath path;
-    for (int i = 0; i < m_bandValues.size(); ++i) {
-        const QPointF pos = bandPosition(i);
-        if (i == 0) {
-            path.moveTo(pos);
-        } else {
-            path.lineTo(pos);
+    // Move the cached points and collect the bounds of every segment with
+    // an end that moved, old and new positions both.
+    const float *responseDb = m_response.totalDb();
+    const int pointCount = m_curvePoints.size();
+    int first = -1;
+    int last = -1;
+    qreal top = 0.0;
+    qreal bottom = 0.0;
+    for (int i = 0; i < pointCount; ++i) {
+        QPointF &point = m_curvePoints[i];
+        const qreal y = yForGain(responseDb[i]);
+        if (qAbs(y - point.y()) <= CurveTolerance) {
+            continue;
         }
-    }
 
-    QColor curveColor = palette().highlight().color();
-    if (!isEnabled()) {
-        curveColor = palette().mid().color();
+        if (first < 0) {
+            first = i;
+            top = qMin(y, point.y());
+            bottom = qMax(y, point.y());
+        }
+        last = i;
+        top = qMin(top, qMin(y, point.y()));
+        bottom = qMax(bottom, qMax(y, point.y()));
+        point.setY(y);
     }
-    curveColor.setAlpha(isEnabled() ? 220 : 150);
 
-    painter.setPen(QPen(curveColor, 2.0));
-    painter.drawPath(path);
-
-    QColor pointFill = curveColor;
-    pointFill.setAlpha(255);
-    QColor pointOutline = palette().dark().color();
-    pointOutline.setAlpha(isEnabled() ? 220 : 120);
+    QRectF dirty = handleRect(index, previousValue).united(handleRect(index, m_bandValues.at(index)));
+    if (first >= 0) {
+        const QPointF &before = m_curvePoints.at(qMax(0, first - 1));
+        const QPointF &after = m_curvePoints.at(qMin(pointCount - 1, last + 1));
+        const qreal margin = CurvePenWidth;
+        dirty |= QRectF(QPointF(before.x(), qMin(top, qMin(before.y(), after.y()))),
+                        QPointF(after.x(), qMax(bottom, qMax(before.y(), after.y()))))
+                .adjusted(-margin, -margin, margin, margin);
+    }
 
-    painter.setPen(QPen(pointOutline, 1.2));
-    painter.setBrush(pointFill);
+    update(dirty.toAlignedRect());
+}
 
-    for (int i = 0; i < m_bandValues.size(); ++i) {
-        const QPointF pos = bandPosition(i);
-        painter.drawEllipse(pos, PointRadius, PointRadius);
-    }
+QRectF EqualizerCurveWidget::handleRect(int index, int value) const
+{
+    const qreal x = bandPosition(index).x();
+    const qreal radius = PointRadius + PointPenWidth + 1.0;
+    return QRectF(x - radius, yForValue(value) - radius, 2.0 * radius, 2.0 * radius);
 }
 
 void EqualizerCurveWidget::mousePressEvent(QMouseEvent *event)
@@ -189,17 +413,7 @@ void EqualizerCurveWidget::mousePressEvent(QMouseEvent *event)
     }
 
     const QPointF pos = event->pos();
-    int closestBand = -1;
-    qreal closestDistance = std::numeric_limits<qreal>::max();
-
-    for (int i = 0; i < m_bandValues.size(); ++i) {
-        const qreal distance = QLineF(pos, bandPosition(i)).length();
-        if (distance <= HoverDistance && distance < closestDistance) {
-            closestDistance = distance;
-            closestBand = i;
-        }
-    }
-
+    const int closestBand = bandAt(pos, HoverDistance);
     if (closestBand >= 0) {
         m_activeBand = closestBand;
         m_isDragging = true;
@@ -270,6 +484,55 @@ QPointF EqualizerCurveWidget::bandPosition(int index) const
     return QPointF(x, y);
 }
 
+bool EqualizerCurveWidget::isBandAvailable(int index) const
+{
+    return EqualizerBands::isAvailable(index, m_response.sampleRate());
+}
+
+int EqualizerCurveWidget::bandAt(const QPointF &pos, qreal maximumDistance) const
+{
+    // Bands above the Nyquist frequency are not offered for dragging.
+    int closestBand = -1;
+    qreal closestDistance = std::numeric_limits<qreal>::max();
+
+    for (int i = 0; i < m_bandValues.size(); ++i) {
+        if (!isBandAvailable(i)) {
+            continue;
+        }
+        const qreal distance = QLineF(pos, bandPosition(i)).length();
+        if (distance <= maximumDistance && distance < closestDistance) {
+            closestDistance = distance;
+            closestBand = i;
+        }
+    }
+    return closestBand;
+}
+
+void EqualizerCurveWidget::drawSpectrum(QPainter *painter, const QRectF &rect) const
+{
+    const int count = m_spectrum.size();
+    if (count < 2) {
+        return;
+    }
+
+    // The points span the same frequencies as the bands, which every
+    // layout spaces evenly in log frequency, so x is linear in the point
+    // index.
+    QPainterPath path;
+    path.moveTo(rect.left(), rect.bottom());
+    for (int i = 0; i < count; ++i) {
+        const qreal x = rect.left() + rect.width() * i / (count - 1);
+        const qreal ratio = qBound<qreal>(0.0, 1.0 + m_spectrum.at(i) / SpectrumRangeDb, 1.0);
+        path.lineTo(x, rect.bottom() - ratio * rect.height());
+    }
+    path.lineTo(rect.right(), rect.bottom());
+    path.closeSubpath();
+
+    QColor fill = palette().highlight().color();
+    fill.setAlpha(isEnabled() ? 60 : 30);
+    painter->fillPath(path, fill);
+}
+
 void EqualizerCurveWidget::setBandValueFromUser(int index, int value)
 {
     if (index < 0 || index >= m_bandValues.size()) {
@@ -281,8 +544,10 @@ void EqualizerCurveWidget::setBandValueFromUser(int index, int value)
         return;
     }
 
+    const int previous = m_bandValues.at(index);
     m_bandValues[index] = clamped;
-    update();
+    updateResponse(index);
+    updateCurve(index, previous);
     emit bandValueChanged(index, clamped);
 }
 
@@ -306,22 +571,32 @@ int EqualizerCurveWidget::valueForY(qreal y) const
 }
 
 qreal EqualizerCurveWidget::yForValue(int value) const
+{
+    return yForGain(qBound(m_minGain, value, m_maxGain));
+}
+
+qreal EqualizerCurveWidget::yForGain(qreal gainDb) const
 {
     const QRectF rect = curveRect();
     if (!rect.isValid()) {
         return 0.0;
     }
 
-    const int clamped = qBound(m_minGain, value, m_maxGain);
     const qreal range = m_maxGain - m_minGain;
     if (qFuzzyIsNull(range)) {
         return rect.center().y();
     }
 
-    const qreal ratio = (static_cast<qreal>(clamped) - m_minGain) / range;
+    // Overlapping bands can sum past the slider range; pin to the frame.
+    const qreal ratio = qBound<qreal>(0.0, (gainDb - m_minGain) / range, 1.0);
     return rect.bottom() - ratio * rect.height();
 }
 
+void EqualizerCurveWidget::updateResponse(int index)
+{
+    m_response.setBandGain(index, m_bandValues.at(index));
+}
+
 void EqualizerCurveWidget::updateHoverCursor(const QPoint &pos)
 {
     if (m_isDragging) {
@@ -334,18 +609,7 @@ void EqualizerCurveWidget::updateHoverCursor(const QPoint &pos)
         return;
     }
 
-    int closestBand = -1;
-    qreal closestDistance = HoverDistance + 1.0;
-
-    for (int i = 0; i < m_bandValues.size(); ++i) {
-        const qreal distance = QLineF(pos, bandPosition(i)).length();
-        if (distance < closestDistance) {
-            closestDistance = distance;
-            closestBand = i;
-        }
-    }
-
-    if (closestBand >= 0 && closestDistance <= HoverDistance) {
+    if (bandAt(pos, HoverDistance) >= 0) {
         setCursor(Qt::OpenHandCursor);
     } else {
         unsetCursor();
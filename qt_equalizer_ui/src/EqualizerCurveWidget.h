@@ -1,17 +1,28 @@
 #ifndef EQUALIZERCURVEWIDGET_H
 #define EQUALIZERCURVEWIDGET_H
 
+#include <QPixmap>
 #include <QVector>
 #include <QWidget>
 #include <QRectF>
 #include <QPointF>
 
+#include "EqualizerBands.h"
+#include "FrequencyResponse.h"
+
+class QPainter;
+
+// Painted in two layers. The background, grid and frame only change with
+// the size, palette, enabled state or gain range, so they are rendered once
+// into a pixmap at the device pixel ratio and blitted. The spectrum, the
+// response curve and the handles are drawn on top, and a band change only
+// repaints the strip where the old and new curve differ.
 class EqualizerCurveWidget : public QWidget
 {
     Q_OBJECT
 
 public:
-    static const int BandCount = 10;
+    static const int BandCount = EqualizerBands::Count;
 
     explicit EqualizerCurveWidget(QWidget *parent = nullptr);
 
@@ -25,11 +36,34 @@ public:
     QVector<int> bandValues() const;
     void setBandValue(int index, int value);
 
+    // The curve is the response of the engine's filters at this rate. Bands
+    // at or above its Nyquist frequency are drawn hollow over a shaded
+    // strip and cannot be dragged.
+    double sampleRate() const;
+    void setSampleRate(double sampleRate);
+
+    // As set on the engine with EqualizerEngine::setOversampling().
+    int oversampling() const;
+    void setOversampling(int factor);
+
+    // Spectrum drawn behind the curve, in dBFS at log-spaced frequencies
+    // from the first to the last band, as produced by SpectrumWorker. An
+    // empty vector hides it.
+    void setSpectrum(const QVector<float> &levelsDb);
+
+    // Number of paintEvent() calls and the time spent in them since the last
+    // reset, for measuring the repaint cost.
+    int paintCount() const;
+    qint64 paintNanoseconds() const;
+    void resetPaintStatistics();
+
 signals:
     void bandValueChanged(int bandIndex, int value);
 
 protected:
     void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void changeEvent(QEvent *event) override;
     void mousePressEvent(QMouseEvent *event) override;
     void mouseMoveEvent(QMouseEvent *event) override;
     void mouseReleaseEvent(QMouseEvent *event) override;
@@ -37,16 +71,38 @@ protected:
 
 private:
     QVector<int> m_bandValues;
+    QVector<float> m_spectrum;
     int m_minGain;
     int m_maxGain;
     int m_activeBand;
     bool m_isDragging;
+    FrequencyResponse m_response;
+
+    QPixmap m_staticLayer;
+    bool m_isStaticLayerValid;
+    // The response curve in widget coordinates, kept between paints so a
+    // band change can find the span that moved.
+    QVector<QPointF> m_curvePoints;
+    bool m_isCurveValid;
+
+    int m_paintCount;
+    qint64 m_paintNanoseconds;
 
     QRectF curveRect() const;
     QPointF bandPosition(int index) const;
+    bool isBandAvailable(int index) const;
+    int bandAt(const QPointF &pos, qreal maximumDistance) const;
+    void drawSpectrum(QPainter *painter, const QRectF &rect) const;
+    void rebuildStaticLayer();
+    void rebuildCurvePoints();
+    void invalidateLayers();
+    void updateCurve(int index, int previousValue);
+    QRectF handleRect(int index, int value) const;
     void setBandValueFromUser(int index, int value);
     int valueForY(qreal y) const;
     qreal yForValue(int value) const;
+    qreal yForGain(qreal gainDb) const;
+    void updateResponse(int index);
     void updateHoverCursor(const QPoint &pos);
 };
 
@@ -0,0 +1,946 @@
+#include "EqualizerEngine.h"
+#include "BiquadCoefficientTable.h"
+#include "DenormalGuard.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+    // Gain changes are ramped in sub-blocks of RampFrames with a one pole
+    // smoother; coefficients are recomputed once per sub-block.
+    constexpr int RampFrames = 32;
+    constexpr double RampTimeConstant = 0.010;
+    constexpr double RampSnapThreshold = 0.01;
+
+    // Frames packed into the lane buffer per kernel call; 256 frames of 16
+    // lanes is 16 KiB and stays in L1.
+    constexpr int BlockFrames = 256;
+
+    constexpr int MaximumLanes = 16;
+    // Largest per-group state of either path: five values per section and
+    // lane in fixed point, two in float.
+    constexpr int MaximumGroupState = EqualizerBands::Count * 5 * MaximumLanes;
+
+    // Once state is below this the tail that skipping drops is around
+    // -115 dBFS at most.
+    constexpr float SilenceThreshold = 1.0f / 1048576.0f;
+    // The same level in the fixed point path's scale, where full scale is
+    // 2^23.
+    constexpr std::int32_t FixedPointSilenceThreshold = 8;
+
+    constexpr float Int16Scale = 32768.0f;
+    constexpr double FixedPointScale = 32768.0 * (1 << FixedPointKernels::SampleShift);
+    // Largest state the float to fixed point conversion produces; leaves the
+    // cascade its usual headroom.
+    constexpr double FixedPointStateLimit = 268435456.0;
+
+    constexpr double CrossfadeTime = 0.010;
+    constexpr double HalfPi = 1.57079632679489661923;
+
+    double clampGain(double gainDb)
+    {
+        return std::max<double>(EqualizerBands::MinimumGain, std::min<double>(gainDb, EqualizerBands::MaximumGain));
+    }
+
+    std::int16_t toInt16(float sample)
+    {
+        const float scaled = std::nearbyint(sample * Int16Scale);
+        return static_cast<std::int16_t>(std::max(-32768.0f, std::min(scaled, 32767.0f)));
+    }
+
+    // Carries the state of sections that stay in the cascade over to their
+    // new slot; sections joining it start from rest.
+    template <typename T>
+    void moveSectionStates(T *states, int groupCount, size_t sectionStateSize,
+                           const int *previousBands, int previousCount, const int *bands, int count)
+    {
+        const size_t groupStateSize = EqualizerBands::Count * sectionStateSize;
+
+        for (int group = 0; group < groupCount; ++group, states += groupStateSize) {
+            T previous[MaximumGroupState];
+            std::copy(states, states + previousCount * sectionStateSize, previous);
+
+            for (int slot = 0; slot < count; ++slot) {
+                const int *found = std::find(previousBands, previousBands + previousCount, bands[slot]);
+                T *target = states + slot * sectionStateSize;
+                if (found != previousBands + previousCount) {
+                    const T *source = previous + (found - previousBands) * sectionStateSize;
+                    std::copy(source, source + sectionStateSize, target);
+                } else {
+                    std::fill(target, target + sectionStateSize, T());
+                }
+            }
+        }
+    }
+}
+
+EqualizerEngine::EqualizerEngine(double sampleRate, int channelCount)
+    : EqualizerEngine(sampleRate, channelCount, BiquadKernels::hostIsa())
+{
+}
+
+EqualizerEngine::EqualizerEngine(double sampleRate, int channelCount, BiquadKernels::Isa maximumIsa)
+    : m_sampleRate(sampleRate > 0.0 ? sampleRate : 48000.0)
+    , m_channelCount(std::max(1, std::min(channelCount, static_cast<int>(MaximumChannels))))
+    , m_tableIndex(BiquadCoefficientTable::sampleRateIndex(m_sampleRate))
+    , m_oversampling(1)
+    , m_oversampledTableIndex(m_tableIndex)
+    , m_rampCoefficient(1.0 - std::exp(-RampFrames / (RampTimeConstant * m_sampleRate)))
+    , m_isRamping(false)
+    , m_requestedBypass(false)
+    , m_isBypassed(false)
+    , m_bypassMode(FreezeAndReset)
+    , m_fadeFrames(std::max(1, static_cast<int>(std::lround(CrossfadeTime * m_sampleRate))))
+    , m_fadePosition(m_fadeFrames)
+    , m_fadeCurve(static_cast<size_t>(m_fadeFrames))
+    , m_scratch(static_cast<size_t>(BlockFrames) * m_channelCount)
+    , m_activeBandCount(0)
+    , m_kernel(BiquadKernels::select(m_channelCount, maximumIsa))
+    , m_oversampledBandCount(0)
+    , m_cascade(m_kernel.process)
+    , m_oversampledCascade(m_kernel.process)
+    , m_groupCount((m_channelCount + m_kernel.laneCount - 1) / m_kernel.laneCount)
+    , m_laneCoefficients(static_cast<size_t>(BandCount) * 5 * m_kernel.laneCount)
+    , m_laneStates(static_cast<size_t>(m_groupCount) * BandCount * 2 * m_kernel.laneCount)
+    , m_laneBuffer(static_cast<size_t>(BlockFrames) * m_kernel.laneCount)
+    , m_fixedKernel(FixedPointKernels::select(m_channelCount, maximumIsa))
+    , m_fixedGroupCount((m_channelCount + m_fixedKernel.laneCount - 1) / m_fixedKernel.laneCount)
+    , m_fixedCoefficients(static_cast<size_t>(BandCount) * 5 * m_fixedKernel.laneCount)
+    , m_fixedStates(static_cast<size_t>(m_fixedGroupCount) * BandCount * 5 * m_fixedKernel.laneCount)
+    , m_fixedBuffer(static_cast<size_t>(BlockFrames) * m_fixedKernel.laneCount)
+    , m_isFixedPointState(false)
+    , m_conversionBuffer(static_cast<size_t>(BlockFrames) * m_channelCount)
+    , m_counters(m_sampleRate)
+    , m_analysisRing(nullptr)
+{
+    for (int i = 0; i < BandCount; ++i) {
+        m_gains[i] = 0.0;
+        m_targetGains[i] = 0.0;
+        m_coefficients[i] = Biquad::identity();
+    }
+
+    // Sampled at frame centres, so curve[i]^2 + curve[n - 1 - i]^2 == 1.
+    for (int i = 0; i < m_fadeFrames; ++i) {
+        m_fadeCurve[static_cast<size_t>(i)] = static_cast<float>(std::sin(HalfPi * (i + 0.5) / m_fadeFrames));
+    }
+
+    reset();
+}
+
+double EqualizerEngine::sampleRate() const
+{
+    return m_sampleRate;
+}
+
+int EqualizerEngine::channelCount() const
+{
+    return m_channelCount;
+}
+
+BiquadKernels::Isa EqualizerEngine::isa() const
+{
+    return m_kernel.isa;
+}
+
+BiquadKernels::Isa EqualizerEngine::fixedPointIsa() const
+{
+    return m_fixedKernel.isa;
+}
+
+double EqualizerEngine::bandFrequency(int band)
+{
+    if (band < 0 || band >= BandCount) {
+        return 0.0;
+    }
+
+    return EqualizerBands::Frequencies[band];
+}
+
+double EqualizerEngine::bandQ()
+{
+    return EqualizerBands::Q;
+}
+
+bool EqualizerEngine::isBandEnabled(int band) const
+{
+    return EqualizerBands::isAvailable(band, m_sampleRate);
+}
+
+void EqualizerEngine::setOversampling(int factor)
+{
+    const int oversampling = factor >= 4 ? 4 : factor >= 2 ? 2 : 1;
+    if (oversampling == m_oversampling) {
+        return;
+    }
+
+    m_oversampling = oversampling;
+    m_oversampledTableIndex = BiquadCoefficientTable::sampleRateIndex(m_sampleRate * m_oversampling);
+    m_oversamplers.clear();
+    m_oversampledBuffer.clear();
+    if (m_oversampling > 1) {
+        m_oversamplers.assign(static_cast<size_t>(m_groupCount),
+                              Oversampler(m_oversampling, m_kernel.laneCount, BlockFrames));
+        m_oversampledBuffer.assign(static_cast<size_t>(BlockFrames) * m_oversampling * m_kernel.laneCount, 0.0f);
+    }
+
+    // The upper sections change rate, so their state means nothing at the
+    // new one.
+    for (int i = 0; i < BandCount; ++i) {
+        m_coefficients[i] = coefficientsFor(i, m_gains[i]);
+    }
+    reset();
+    updateActiveBands();
+}
+
+int EqualizerEngine::oversampling() const
+{
+    return m_oversampling;
+}
+
+bool EqualizerEngine::isBandOversampled(int band) const
+{
+    return m_oversampling > 1 && EqualizerBands::isUpperBand(band, m_sampleRate);
+}
+
+double EqualizerEngine::latency() const
+{
+    return m_oversamplers.empty() ? 0.0 : m_oversamplers.front().latency();
+}
+
+void EqualizerEngine::publishBandGains(const int *gains, int count)
+{
+    Parameters &parameters = m_parameterChannel.writeBuffer();
+    for (int i = 0; i < BandCount; ++i) {
+        parameters.gains[i] = clampGain(gains && i < count ? static_cast<double>(gains[i]) : 0.0);
+    }
+
+    m_parameterChannel.publish();
+}
+
+void EqualizerEngine::setBandGains(const int *gains, int count)
+{
+    for (int i = 0; i < BandCount; ++i) {
+        const double gain = gains && i < count ? static_cast<double>(gains[i]) : 0.0;
+        m_gains[i] = clampGain(gain);
+        m_targetGains[i] = m_gains[i];
+        m_coefficients[i] = coefficientsFor(i, m_gains[i]);
+    }
+
+    m_isRamping = false;
+    updateActiveBands();
+}
+
+void EqualizerEngine::setBandGain(int band, double gainDb)
+{
+    if (band < 0 || band >= BandCount) {
+        return;
+    }
+
+    const double clamped = clampGain(gainDb);
+    m_targetGains[band] = clamped;
+    if (m_gains[band] == clamped) {
+        return;
+    }
+
+    m_gains[band] = clamped;
+    m_coefficients[band] = coefficientsFor(band, clamped);
+    updateActiveBands();
+}
+
+double EqualizerEngine::bandGain(int band) const
+{
+    if (band < 0 || band >= BandCount) {
+        return 0.0;
+    }
+
+    return m_gains[band];
+}
+
+void EqualizerEngine::setBypassed(bool bypassed)
+{
+    m_requestedBypass.store(bypassed, std::memory_order_release);
+}
+
+bool EqualizerEngine::isBypassed() const
+{
+    return m_requestedBypass.load(std::memory_order_acquire);
+}
+
+void EqualizerEngine::setBypassMode(BypassMode mode)
+{
+    m_bypassMode = mode;
+}
+
+EqualizerEngine::BypassMode EqualizerEngine::bypassMode() const
+{
+    return m_bypassMode;
+}
+
+void EqualizerEngine::reset()
+{
+    std::fill(m_laneStates.begin(), m_laneStates.end(), 0.0f);
+    std::fill(m_fixedStates.begin(), m_fixedStates.end(), 0);
+    for (Oversampler &oversampler : m_oversamplers) {
+        oversampler.reset();
+    }
+}
+
+void EqualizerEngine::setAnalysisRing(SampleRing *ring)
+{
+    m_analysisRing.store(ring, std::memory_order_release);
+}
+
+std::int64_t EqualizerEngine::blockCount() const
+{
+    return m_counters.blockCount();
+}
+
+std::int64_t EqualizerEngine::silentBlockCount() const
+{
+    return m_counters.silentBlockCount();
+}
+
+ProcessingStatistics EqualizerEngine::statistics() const
+{
+    return m_counters.statistics();
+}
+
+void EqualizerEngine::addXrun()
+{
+    m_counters.addXrun();
+}
+
+void EqualizerEngine::process(float *samples, int frameCount)
+{
+    const ProcessingCounters::Timer timer(&m_counters, samples ? frameCount : 0);
+    const DenormalGuard denormalGuard;
+
+    beginProcess();
+
+    if (!samples || frameCount <= 0) {
+        return;
+    }
+
+    processSamples(samples, frameCount);
+}
+
+void EqualizerEngine::process(const float *input, float *output, int frameCount)
+{
+    if (input && output && input != output && frameCount > 0) {
+        std::memmove(output, input, static_cast<size_t>(frameCount) * m_channelCount * sizeof(float));
+    }
+
+    process(output, frameCount);
+}
+
+void EqualizerEngine::process(const std::int16_t *input, std::int16_t *output, int frameCount)
+{
+    const ProcessingCounters::Timer timer(&m_counters, input && output ? frameCount : 0);
+    beginProcess();
+
+    if (!input || !output || frameCount <= 0) {
+        return;
+    }
+
+    const int channels = m_channelCount;
+    SampleRing *ring = m_analysisRing.load(std::memory_order_acquire);
+
+    if (m_fadePosition >= m_fadeFrames && (m_isBypassed ? m_bypassMode == FreezeAndReset : m_oversampling == 1)) {
+        if (!m_isBypassed) {
+            processFixedPoint(input, output, frameCount);
+        } else if (input != output) {
+            std::memmove(output, input, static_cast<size_t>(frameCount) * channels * sizeof(std::int16_t));
+        }
+
+        if (ring) {
+            writeAnalysisRing(ring, output, frameCount);
+        }
+        return;
+    }
+
+    const DenormalGuard denormalGuard;
+    float *block = m_conversionBuffer.data();
+
+    for (int offset = 0; offset < frameCount; offset += BlockFrames) {
+        const int frames = std::min(BlockFrames, frameCount - offset);
+        const size_t count = static_cast<size_t>(frames) * channels;
+        const std::int16_t *in = input + offset * channels;
+        std::int16_t *out = output + offset * channels;
+
+        for (size_t i = 0; i < count; ++i) {
+            block[i] = in[i] * (1.0f / Int16Scale);
+        }
+        processSamples(block, frames);
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = toInt16(block[i]);
+        }
+    }
+}
+
+void EqualizerEngine::beginProcess()
+{
+    if (m_parameterChannel.consume()) {
+        const Parameters &parameters = m_parameterChannel.readBuffer();
+        for (int i = 0; i < BandCount; ++i) {
+            m_targetGains[i] = parameters.gains[i];
+            if (m_targetGains[i] != m_gains[i]) {
+                m_isRamping = true;
+            }
+        }
+    }
+
+    updateBypass();
+}
+
+void EqualizerEngine::processSamples(float *samples, int frameCount)
+{
+    int offset = 0;
+    if (m_fadePosition < m_fadeFrames) {
+        offset = processCrossfade(samples, frameCount);
+    }
+
+    float *remaining = samples + offset * m_channelCount;
+    const int remainingFrames = frameCount - offset;
+    if (remainingFrames > 0) {
+        if (!m_isBypassed) {
+            processFiltered(remaining, remainingFrames);
+        } else if (m_bypassMode == KeepRunning) {
+            processDiscarded(remaining, remainingFrames);
+        }
+    }
+
+    SampleRing *ring = m_analysisRing.load(std::memory_order_acquire);
+    if (ring) {
+        writeAnalysisRing(ring, samples, frameCount);
+    }
+}
+
+void EqualizerEngine::updateBypass()
+{
+    const bool requested = m_requestedBypass.load(std::memory_order_acquire);
+    if (requested == m_isBypassed) {
+        return;
+    }
+
+    const bool isSettled = m_fadePosition >= m_fadeFrames;
+    if (!requested && isSettled && m_bypassMode == FreezeAndReset) {
+        reset();
+    }
+
+    // A fade reversed part way continues from the mix it had reached.
+    m_isBypassed = requested;
+    m_fadePosition = isSettled ? 0 : m_fadeFrames - m_fadePosition;
+}
+
+void EqualizerEngine::processFiltered(float *samples, int frameCount)
+{
+    int offset = 0;
+    while (offset < frameCount) {
+        int frames = frameCount - offset;
+        if (m_isRamping) {
+            advanceRamp();
+            frames = std::min(frames, RampFrames);
+        }
+
+        processCascade(samples + offset * m_channelCount, frames);
+        offset += frames;
+    }
+}
+
+int EqualizerEngine::processCrossfade(float *samples, int frameCount)
+{
+    const int channels = m_channelCount;
+    float *dry = m_scratch.data();
+    const float *curve = m_fadeCurve.data();
+
+    int done = 0;
+    while (done < frameCount && m_fadePosition < m_fadeFrames) {
+        const int frames = std::min(std::min(frameCount - done, m_fadeFrames - m_fadePosition), BlockFrames);
+        float *block = samples + done * channels;
+
+        std::copy(block, block + frames * channels, dry);
+        processFiltered(block, frames);
+
+        for (int frame = 0; frame < frames; ++frame) {
+            const int position = m_fadePosition + frame;
+            const float rising = curve[position];
+            const float falling = curve[m_fadeFrames - 1 - position];
+            const float wetGain = m_isBypassed ? falling : rising;
+            const float dryGain = m_isBypassed ? rising : falling;
+
+            float *wet = block + frame * channels;
+            const float *in = dry + frame * channels;
+            for (int channel = 0; channel < channels; ++channel) {
+                wet[channel] = wet[channel] * wetGain + in[channel] * dryGain;
+            }
+        }
+
+        m_fadePosition += frames;
+        done += frames;
+    }
+
+    return done;
+}
+
+void EqualizerEngine::processDiscarded(const float *samples, int frameCount)
+{
+    for (int offset = 0; offset < frameCount; offset += BlockFrames) {
+        const int frames = std::min(BlockFrames, frameCount - offset);
+        const float *block = samples + offset * m_channelCount;
+        std::copy(block, block + frames * m_channelCount, m_scratch.data());
+        processFiltered(m_scratch.data(), frames);
+    }
+}
+
+void EqualizerEngine::writeAnalysisRing(SampleRing *ring, const float *samples, int frameCount)
+{
+    const int channels = m_channelCount;
+    const float scale = 1.0f / channels;
+    float *mono = m_scratch.data();
+
+    for (int offset = 0; offset < frameCount; offset += BlockFrames) {
+        const int frames = std::min(BlockFrames, frameCount - offset);
+        const float *block = samples + offset * channels;
+        for (int frame = 0; frame < frames; ++frame) {
+            float sum = 0.0f;
+            for (int channel = 0; channel < channels; ++channel) {
+                sum += block[frame * channels + channel];
+            }
+            mono[frame] = sum * scale;
+        }
+        ring->write(mono, frames);
+    }
+}
+
+void EqualizerEngine::writeAnalysisRing(SampleRing *ring, const std::int16_t *samples, int frameCount)
+{
+    const int channels = m_channelCount;
+    const float scale = 1.0f / (Int16Scale * channels);
+    float *mono = m_scratch.data();
+
+    for (int offset = 0; offset < frameCount; offset += BlockFrames) {
+        const int frames = std::min(BlockFrames, frameCount - offset);
+        const std::int16_t *block = samples + offset * channels;
+        for (int frame = 0; frame < frames; ++frame) {
+            int sum = 0;
+            for (int channel = 0; channel < channels; ++channel) {
+                sum += block[frame * channels + channel];
+            }
+            mono[frame] = sum * scale;
+        }
+        ring->write(mono, frames);
+    }
+}
+
+void EqualizerEngine::advanceRamp()
+{
+    bool isRamping = false;
+    for (int i = 0; i < BandCount; ++i) {
+        if (m_gains[i] == m_targetGains[i]) {
+            continue;
+        }
+
+        double gain = m_gains[i] + (m_targetGains[i] - m_gains[i]) * m_rampCoefficient;
+        if (std::fabs(m_targetGains[i] - gain) < RampSnapThreshold) {
+            gain = m_targetGains[i];
+        } else {
+            isRamping = true;
+        }
+
+        m_gains[i] = gain;
+        m_coefficients[i] = coefficientsFor(i, gain);
+    }
+
+    m_isRamping = isRamping;
+    updateActiveBands();
+}
+
+BiquadCoefficients EqualizerEngine::coefficientsFor(int band, double gainDb) const
+{
+    if (!isBandEnabled(band)) {
+        return Biquad::identity();
+    }
+
+    const bool oversampled = isBandOversampled(band);
+    BiquadCoefficients coefficients;
+    if (BiquadCoefficientTable::lookup(oversampled ? m_oversampledTableIndex : m_tableIndex, band, gainDb, &coefficients)) {
+        return coefficients;
+    }
+
+    const double sampleRate = oversampled ? m_sampleRate * m_oversampling : m_sampleRate;
+    return Biquad::peaking(EqualizerBands::Frequencies[band], gainDb, EqualizerBands::Q, sampleRate);
+}
+
+void EqualizerEngine::processCascade(float *samples, int frameCount)
+{
+    // While oversampling the filters run regardless, so the delay they add
+    // does not come and go with the bands.
+    if (m_activeBandCount == 0 && m_oversampling == 1) {
+        return;
+    }
+
+    useFloatState();
+
+    const int channels = m_channelCount;
+    const int lanes = m_kernel.laneCount;
+    float *buffer = m_laneBuffer.data();
+    std::int64_t blocks = 0;
+    std::int64_t silentBlocks = 0;
+
+    for (int offset = 0; offset < frameCount; offset += BlockFrames) {
+        const int frames = std::min(BlockFrames, frameCount - offset);
+        float *block = samples + offset * channels;
+        ++blocks;
+
+        // Silence into rung out filters comes out as the same silence. The
+        // state is cleared so it is exactly at rest when signal returns.
+        if (isSilent(block, static_cast<size_t>(frames) * channels) && isStateSilent()) {
+            reset();
+            ++silentBlocks;
+            continue;
+        }
+
+        for (int group = 0; group < m_groupCount; ++group) {
+            const int firstChannel = group * lanes;
+            const int used = std::min(lanes, channels - firstChannel);
+
+            // Single group covering exactly the interleaved layout: the kernel
+            // can work on the caller's buffer directly.
+            if (used == channels && lanes == channels) {
+                processGroup(0, block, frames);
+                continue;
+            }
+
+            for (int frame = 0; frame < frames; ++frame) {
+                const float *in = block + frame * channels + firstChannel;
+                float *out = buffer + frame * lanes;
+                int lane = 0;
+                for (; lane < used; ++lane) {
+                    out[lane] = in[lane];
+                }
+                for (; lane < lanes; ++lane) {
+                    out[lane] = 0.0f;
+                }
+            }
+
+            processGroup(group, buffer, frames);
+
+            for (int frame = 0; frame < frames; ++frame) {
+                const float *in = buffer + frame * lanes;
+                float *out = block + frame * channels + firstChannel;
+                for (int lane = 0; lane < used; ++lane) {
+                    out[lane] = in[lane];
+                }
+            }
+        }
+    }
+
+    m_counters.addBlocks(blocks, silentBlocks);
+}
+
+void EqualizerEngine::processGroup(int group, float *samples, int frameCount)
+{
+    const int lanes = m_kernel.laneCount;
+    float *states = m_laneStates.data() + static_cast<size_t>(group) * BandCount * 2 * lanes;
+    const int baseCount = m_activeBandCount - m_oversampledBandCount;
+    if (baseCount > 0) {
+        m_cascade(m_laneCoefficients.data(), states, baseCount, samples, frameCount);
+    }
+    if (m_oversampling == 1) {
+        return;
+    }
+
+    Oversampler &oversampler = m_oversamplers[static_cast<size_t>(group)];
+    float *oversampled = m_oversampledBuffer.data();
+    oversampler.upsample(samples, oversampled, frameCount);
+    if (m_oversampledBandCount > 0) {
+        m_oversampledCascade(m_laneCoefficients.data() + static_cast<size_t>(baseCount) * 5 * lanes,
+                             states + static_cast<size_t>(baseCount) * 2 * lanes, m_oversampledBandCount,
+                             oversampled, frameCount * m_oversampling);
+    }
+    oversampler.downsample(oversampled, samples, frameCount);
+}
+
+bool EqualizerEngine::isSilent(const float *samples, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        if (std::fabs(samples[i]) > SilenceThreshold) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool EqualizerEngine::isSilent(const std::int16_t *samples, size_t count)
+{
+    // 2^-20 of full scale is below one LSB, so only zero qualifies.
+    for (size_t i = 0; i < count; ++i) {
+        if (samples[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool EqualizerEngine::isFixedPointStateSilent() const
+{
+    // The saved rounding error is below one unit of the fixed point scale
+    // and does not count.
+    const int lanes = m_fixedKernel.laneCount;
+    const size_t groupStateSize = static_cast<size_t>(BandCount) * 5 * lanes;
+
+    for (int group = 0; group < m_fixedGroupCount; ++group) {
+        const std::int32_t *section = m_fixedStates.data() + group * groupStateSize;
+        for (int slot = 0; slot < m_activeBandCount; ++slot, section += 5 * lanes) {
+            for (int i = 0; i < 4 * lanes; ++i) {
+                if (std::abs(section[i]) > FixedPointSilenceThreshold) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool EqualizerEngine::isStateSilent() const
+{
+    const size_t used = static_cast<size_t>(m_activeBandCount) * 2 * m_kernel.laneCount;
+    const size_t groupStateSize = static_cast<size_t>(BandCount) * 2 * m_kernel.laneCount;
+
+    for (int group = 0; group < m_groupCount; ++group) {
+        if (!isSilent(m_laneStates.data() + group * groupStateSize, used)) {
+            return false;
+        }
+    }
+    for (const Oversampler &oversampler : m_oversamplers) {
+        if (!oversampler.isSilent(SilenceThreshold)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void EqualizerEngine::updateActiveBands()
+{
+    // Ascending band order puts the oversampled sections last.
+    int active[BandCount];
+    int activeCount = 0;
+    int oversampledCount = 0;
+    for (int i = 0; i < BandCount; ++i) {
+        if (!Biquad::isIdentity(m_coefficients[i])) {
+            active[activeCount++] = i;
+            if (isBandOversampled(i)) {
+                ++oversampledCount;
+            }
+        }
+    }
+
+    const bool changed = activeCount != m_activeBandCount
+            || !std::equal(active, active + activeCount, m_activeBands);
+
+    if (changed) {
+        if (m_isFixedPointState) {
+            moveSectionStates(m_fixedStates.data(), m_fixedGroupCount, static_cast<size_t>(5) * m_fixedKernel.laneCount,
+                              m_activeBands, m_activeBandCount, active, activeCount);
+        } else {
+            moveSectionStates(m_laneStates.data(), m_groupCount, static_cast<size_t>(2) * m_kernel.laneCount,
+                              m_activeBands, m_activeBandCount, active, activeCount);
+        }
+
+        std::copy(active, active + activeCount, m_activeBands);
+        m_activeBandCount = activeCount;
+    }
+
+    if (changed || oversampledCount != m_oversampledBandCount) {
+        m_oversampledBandCount = oversampledCount;
+        m_cascade = BiquadKernels::unrolled(m_kernel, activeCount - oversampledCount);
+        m_oversampledCascade = BiquadKernels::unrolled(m_kernel, oversampledCount);
+    }
+
+    updateLaneCoefficients();
+}
+
+void EqualizerEngine::updateLaneCoefficients()
+{
+    const int lanes = m_kernel.laneCount;
+    float *c = m_laneCoefficients.data();
+
+    for (int slot = 0; slot < m_activeBandCount; ++slot, c += 5 * lanes) {
+        const BiquadCoefficients &coefficients = m_coefficients[m_activeBands[slot]];
+        std::fill(c, c + lanes, coefficients.b0);
+        std::fill(c + lanes, c + 2 * lanes, coefficients.b1);
+        std::fill(c + 2 * lanes, c + 3 * lanes, coefficients.b2);
+        std::fill(c + 3 * lanes, c + 4 * lanes, coefficients.a1);
+        std::fill(c + 4 * lanes, c + 5 * lanes, coefficients.a2);
+    }
+
+    const int fixedLanes = m_fixedKernel.laneCount;
+    std::int32_t *q = m_fixedCoefficients.data();
+
+    for (int slot = 0; slot < m_activeBandCount; ++slot, q += 5 * fixedLanes) {
+        std::int32_t quantized[5];
+        FixedPointKernels::quantize(m_coefficients[m_activeBands[slot]], quantized);
+        for (int i = 0; i < 5; ++i) {
+            std::fill(q + i * fixedLanes, q + (i + 1) * fixedLanes, quantized[i]);
+        }
+    }
+}
+
+void EqualizerEngine::processFixedPoint(const std::int16_t *input, std::int16_t *output, int frameCount)
+{
+    const int channels = m_channelCount;
+    int offset = 0;
+    while (offset < frameCount) {
+        int frames = frameCount - offset;
+        if (m_isRamping) {
+            advanceRamp();
+            frames = std::min(frames, RampFrames);
+        }
+
+        processFixedPointCascade(input + offset * channels, output + offset * channels, frames);
+        offset += frames;
+    }
+}
+
+void EqualizerEngine::processFixedPointCascade(const std::int16_t *input, std::int16_t *output, int frameCount)
+{
+    const int channels = m_channelCount;
+
+    if (m_activeBandCount == 0) {
+        if (input != output) {
+            std::memmove(output, input, static_cast<size_t>(frameCount) * channels * sizeof(std::int16_t));
+        }
+        return;
+    }
+
+    useFixedPointState();
+
+    const int lanes = m_fixedKernel.laneCount;
+    const size_t groupStateSize = static_cast<size_t>(BandCount) * 5 * lanes;
+    const std::int32_t rounding = 1 << (FixedPointKernels::SampleShift - 1);
+    std::int32_t *buffer = m_fixedBuffer.data();
+    std::int64_t blocks = 0;
+    std::int64_t silentBlocks = 0;
+
+    for (int offset = 0; offset < frameCount; offset += BlockFrames) {
+        const int frames = std::min(BlockFrames, frameCount - offset);
+        const std::int16_t *in = input + offset * channels;
+        std::int16_t *out = output + offset * channels;
+        ++blocks;
+
+        if (isSilent(in, static_cast<size_t>(frames) * channels) && isFixedPointStateSilent()) {
+            reset();
+            ++silentBlocks;
+            if (in != out) {
+                std::memmove(out, in, static_cast<size_t>(frames) * channels * sizeof(std::int16_t));
+            }
+            continue;
+        }
+
+        // Each group reads and writes only its own channels, so in may alias
+        // out.
+        for (int group = 0; group < m_fixedGroupCount; ++group) {
+            const int firstChannel = group * lanes;
+            const int used = std::min(lanes, channels - firstChannel);
+
+            for (int frame = 0; frame < frames; ++frame) {
+                const std::int16_t *source = in + frame * channels + firstChannel;
+                std::int32_t *target = buffer + frame * lanes;
+                int lane = 0;
+                for (; lane < used; ++lane) {
+                    target[lane] = source[lane] * (1 << FixedPointKernels::SampleShift);
+                }
+                for (; lane < lanes; ++lane) {
+                    target[lane] = 0;
+                }
+            }
+
+            m_fixedKernel.process(m_fixedCoefficients.data(), m_fixedStates.data() + group * groupStateSize,
+                                  m_activeBandCount, buffer, frames);
+
+            for (int frame = 0; frame < frames; ++frame) {
+                const std::int32_t *source = buffer + frame * lanes;
+                std::int16_t *target = out + frame * channels + firstChannel;
+                for (int lane = 0; lane < used; ++lane) {
+                    const std::int32_t sample = (source[lane] + rounding) >> FixedPointKernels::SampleShift;
+                    target[lane] = static_cast<std::int16_t>(std::max(-32768, std::min(sample, 32767)));
+                }
+            }
+        }
+    }
+
+    m_counters.addBlocks(blocks, silentBlocks);
+}
+
+void EqualizerEngine::useFloatState()
+{
+    if (!m_isFixedPointState) {
+        return;
+    }
+
+    // Direct form I history (x1 x2 y1 y2, plus the saved rounding error)
+    // folds into the two transposed direct form II states exactly.
+    const int lanes = m_kernel.laneCount;
+    const int fixedLanes = m_fixedKernel.laneCount;
+    const double errorScale = 1.0 / static_cast<double>(std::int64_t(1) << FixedPointKernels::CoefficientBits);
+
+    for (int channel = 0; channel < m_channelCount; ++channel) {
+        float *state = m_laneStates.data() + (channel / lanes) * static_cast<size_t>(BandCount) * 2 * lanes
+                + channel % lanes;
+        const std::int32_t *fixed = m_fixedStates.data()
+                + (channel / fixedLanes) * static_cast<size_t>(BandCount) * 5 * fixedLanes + channel % fixedLanes;
+
+        for (int slot = 0; slot < m_activeBandCount; ++slot, state += 2 * lanes, fixed += 5 * fixedLanes) {
+            const BiquadCoefficients &c = m_coefficients[m_activeBands[slot]];
+            const double x1 = fixed[0];
+            const double x2 = fixed[fixedLanes];
+            const double y1 = fixed[2 * fixedLanes];
+            const double y2 = fixed[3 * fixedLanes];
+            const double e = fixed[4 * fixedLanes] * errorScale;
+            state[0] = static_cast<float>((c.b1 * x1 + c.b2 * x2 - c.a1 * y1 - c.a2 * y2 + e) / FixedPointScale);
+            state[lanes] = static_cast<float>((c.b2 * x1 - c.a2 * y1) / FixedPointScale);
+        }
+    }
+
+    m_isFixedPointState = false;
+}
+
+void EqualizerEngine::useFixedPointState()
+{
+    if (m_isFixedPointState) {
+        return;
+    }
+
+    // Any direct form I history with the same two transposed direct form II
+    // states gives the same output from here on; take the one with no past
+    // input: y1 = -s2 / a2 and y2 = -(s1 + a1 * y1) / a2.
+    const int lanes = m_kernel.laneCount;
+    const int fixedLanes = m_fixedKernel.laneCount;
+    std::fill(m_fixedStates.begin(), m_fixedStates.end(), 0);
+
+    for (int channel = 0; channel < m_channelCount; ++channel) {
+        const float *state = m_laneStates.data() + (channel / lanes) * static_cast<size_t>(BandCount) * 2 * lanes
+                + channel % lanes;
+        std::int32_t *fixed = m_fixedStates.data()
+                + (channel / fixedLanes) * static_cast<size_t>(BandCount) * 5 * fixedLanes + channel % fixedLanes;
+
+        for (int slot = 0; slot < m_activeBandCount; ++slot, state += 2 * lanes, fixed += 5 * fixedLanes) {
+            const BiquadCoefficients &c = m_coefficients[m_activeBands[slot]];
+            if (std::fabs(c.a2) < 1.0e-6f) {
+                continue;
+            }
+
+            const double y1 = -state[lanes] / c.a2;
+            const double y2 = -(state[0] + c.a1 * y1) / c.a2;
+            fixed[2 * fixedLanes] = static_cast<std::int32_t>(
+                        std::max(-FixedPointStateLimit, std::min(std::round(y1 * FixedPointScale), FixedPointStateLimit)));
+            fixed[3 * fixedLanes] = static_cast<std::int32_t>(
+                        std::max(-FixedPointStateLimit, std::min(std::round(y2 * FixedPointScale), FixedPointStateLimit)));
+        }
+    }
+
+    m_isFixedPointState = true;
+}
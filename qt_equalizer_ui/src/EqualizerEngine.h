@@ -0,0 +1,237 @@
+#ifndef EQUALIZERENGINE_H
+#define EQUALIZERENGINE_H
+
+#include "BiquadFilter.h"
+#include "BiquadKernels.h"
+#include "EqualizerBands.h"
+#include "FixedPointKernels.h"
+#include "Oversampler.h"
+#include "ParameterChannel.h"
+#include "ProcessingCounters.h"
+#include "SampleRing.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Graphic equaliser, one peaking biquad per band of EqualizerBands.h. The
+// engine has no Qt dependency so it can be driven from an audio callback;
+// all storage is allocated up front and process() never allocates.
+//
+// process() runs with denormals flushed to zero (see DenormalGuard.h), and
+// once a block of digital silence finds the filters rung out it leaves the
+// block alone instead of running the cascade, so silent streams are cheap.
+//
+// 16-bit PCM can be passed in directly. While the engine is engaged and no
+// crossfade is running it is filtered in fixed point (see
+// FixedPointKernels.h) without ever converting to float; crossfades and
+// the bypassed modes convert and take the float path. The filter state
+// carries over when the engine moves between the two.
+//
+// The band set follows the sample rate: bands at or above the Nyquist
+// frequency are left out (see EqualizerBands::isAvailable()). Optionally
+// the upper bands run 2x or 4x oversampled, where the bilinear transform
+// warps them less; see setOversampling().
+//
+// Threading: publishBandGains(), setBypassed() and setAnalysisRing() may be
+// called from one control thread (the UI) while another thread runs
+// process(). Everything else must be called from the thread that runs
+// process(), or while it is stopped.
+class EqualizerEngine
+{
+public:
+    static const int BandCount = EqualizerBands::Count;
+    static const int MaximumChannels = 8;
+
+    // What the filters do while the engine is bypassed.
+    enum BypassMode
+    {
+        // Stop filtering; switching back in starts from rest. A bypassed
+        // engine then costs next to nothing.
+        FreezeAndReset,
+        // Keep filtering the input and discard the result, so switching back
+        // in resumes exactly as if the engine had never been bypassed.
+        KeepRunning
+    };
+
+    explicit EqualizerEngine(double sampleRate = 48000.0, int channelCount = 2);
+    EqualizerEngine(double sampleRate, int channelCount, BiquadKernels::Isa maximumIsa);
+
+    double sampleRate() const;
+    int channelCount() const;
+    BiquadKernels::Isa isa() const;
+
+    static double bandFrequency(int band);
+    static double bandQ();
+
+    // False for bands this engine's sample rate cannot realise. Their gains
+    // are kept but have no effect.
+    bool isBandEnabled(int band) const;
+
+    // 1, 2 or 4. Above 1 the bands of EqualizerBands::isUpperBand() run
+    // at that multiple of the sample rate between a pair of Oversampler
+    // filters, the rest at the base rate ahead of them. The 16-bit input
+    // then takes the float path. Costs the filters' cost on every block and
+    // Oversampler::latency() frames of delay, which the bypass crossfade does
+    // not compensate. Resets the filter state and allocates, so call it
+    // while process() is not running.
+    void setOversampling(int factor);
+    int oversampling() const;
+    bool isBandOversampled(int band) const;
+    // Delay the oversampling filters add, in frames.
+    double latency() const;
+
+    // Wait-free handoff to the audio thread. The new gains are picked up at
+    // the start of the next process() call and ramped in over a few
+    // milliseconds so dragging a band does not produce zipper noise.
+    void publishBandGains(const int *gains, int count);
+
+    // Gains in dB, as reported by EqualizerWidget::bandValues(). Applied
+    // immediately, without smoothing.
+    void setBandGains(const int *gains, int count);
+    void setBandGain(int band, double gainDb);
+    double bandGain(int band) const;
+
+    // Picked up at the start of the next process() call. Switching in or
+    // out crossfades between the filtered and the dry signal with equal
+    // power over about 10 ms.
+    void setBypassed(bool bypassed);
+    bool isBypassed() const;
+    void setBypassMode(BypassMode mode);
+    BypassMode bypassMode() const;
+
+    void reset();
+
+    // After every process() call the output, downmixed to mono, is written
+    // to ring for a spectrum analyser to read on another thread. The write
+    // never blocks; what does not fit is dropped. Pass nullptr to stop. The
+    // ring must outlive any process() call that may still be using it.
+    void setAnalysisRing(SampleRing *ring);
+
+    // Blocks of up to 256 frames that went through the cascade, and how
+    // many of them skipped it because both the input and the filter state
+    // were silent. Readable from any thread.
+    std::int64_t blockCount() const;
+    std::int64_t silentBlockCount() const;
+
+    // Time spent in process() against the real-time budget, with the block
+    // counts above. Readable from any thread without locking.
+    ProcessingStatistics statistics() const;
+    // For the audio host to count device underruns and overruns, which the
+    // engine cannot see. Any thread.
+    void addXrun();
+
+    // True when no sample exceeds 2^-20, under half an LSB of 16-bit PCM:
+    // the level below which the engine treats input and state as silent.
+    static bool isSilent(const float *samples, size_t count);
+    static bool isSilent(const std::int16_t *samples, size_t count);
+
+    // Filters interleaved samples in place. Once bypassed and faded out it
+    // returns without touching them.
+    void process(float *samples, int frameCount);
+    // As above, from input into output. When the two alias the bypassed
+    // path copies nothing.
+    void process(const float *input, float *output, int frameCount);
+    // Interleaved 16-bit PCM from input into output, which may alias.
+    void process(const std::int16_t *input, std::int16_t *output, int frameCount);
+
+    // Kernel the 16-bit path uses.
+    BiquadKernels::Isa fixedPointIsa() const;
+
+private:
+    struct Parameters
+    {
+        double gains[BandCount];
+    };
+
+    double m_sampleRate;
+    int m_channelCount;
+    int m_tableIndex;
+    int m_oversampling;
+    int m_oversampledTableIndex;
+
+    ParameterChannel<Parameters> m_parameterChannel;
+
+    double m_gains[BandCount];
+    double m_targetGains[BandCount];
+    double m_rampCoefficient;
+    bool m_isRamping;
+
+    std::atomic<bool> m_requestedBypass;
+    bool m_isBypassed;
+    BypassMode m_bypassMode;
+    // Equal-power crossfade: m_fadeCurve rises from 0 to 1 over
+    // m_fadeFrames; m_fadePosition is m_fadeFrames when no fade is running.
+    int m_fadeFrames;
+    int m_fadePosition;
+    std::vector<float> m_fadeCurve;
+    // Dry copy during a crossfade, discarded output while KeepRunning.
+    std::vector<float> m_scratch;
+
+    BiquadCoefficients m_coefficients[BandCount];
+
+    // Indices of the sections that are not an identity, in cascade order.
+    int m_activeBands[BandCount];
+    int m_activeBandCount;
+
+    // Channels are split into groups of m_kernel.laneCount and each group runs
+    // through the kernel in lane-interleaved form. Coefficients and state are
+    // kept only for the active sections, in cascade order; see BiquadKernels.h
+    // for the layout.
+    BiquadKernels::Kernel m_kernel;
+    // The oversampled sections are the last m_oversampledBandCount of the
+    // active ones. m_cascade is m_kernel unrolled for the others,
+    // m_oversampledCascade for these.
+    int m_oversampledBandCount;
+    BiquadKernels::CascadeFunction m_cascade;
+    BiquadKernels::CascadeFunction m_oversampledCascade;
+    int m_groupCount;
+    std::vector<float> m_laneCoefficients;
+    std::vector<float> m_laneStates;
+    std::vector<float> m_laneBuffer;
+    // One per group while oversampling, and a lane buffer at the higher
+    // rate.
+    std::vector<Oversampler> m_oversamplers;
+    std::vector<float> m_oversampledBuffer;
+
+    // The same for the 16-bit path, in FixedPointKernels' layout. Only one
+    // of the two state sets is live at a time; m_isFixedPointState says
+    // which, and the other is derived from it on the first block that
+    // needs it.
+    FixedPointKernels::Kernel m_fixedKernel;
+    int m_fixedGroupCount;
+    std::vector<std::int32_t> m_fixedCoefficients;
+    std::vector<std::int32_t> m_fixedStates;
+    std::vector<std::int32_t> m_fixedBuffer;
+    bool m_isFixedPointState;
+    // Float copy of a 16-bit block on its way through the float path.
+    std::vector<float> m_conversionBuffer;
+
+    ProcessingCounters m_counters;
+
+    std::atomic<SampleRing *> m_analysisRing;
+
+    BiquadCoefficients coefficientsFor(int band, double gainDb) const;
+    void advanceRamp();
+    void beginProcess();
+    void updateBypass();
+    void processSamples(float *samples, int frameCount);
+    void processFiltered(float *samples, int frameCount);
+    int processCrossfade(float *samples, int frameCount);
+    void processDiscarded(const float *samples, int frameCount);
+    void writeAnalysisRing(SampleRing *ring, const float *samples, int frameCount);
+    void writeAnalysisRing(SampleRing *ring, const std::int16_t *samples, int frameCount);
+    void processCascade(float *samples, int frameCount);
+    void processGroup(int group, float *samples, int frameCount);
+    void processFixedPoint(const std::int16_t *input, std::int16_t *output, int frameCount);
+    void processFixedPointCascade(const std::int16_t *input, std::int16_t *output, int frameCount);
+    void useFloatState();
+    void useFixedPointState();
+    bool isStateSilent() const;
+    bool isFixedPointStateSilent() const;
+    void updateActiveBands();
+    void updateLaneCoefficients();
+};
+
+#endif // EQUALIZERENGINE_H
@@ -1,20 +1,58 @@
 #include "EqualizerWidget.h"
 #include "ui_EqualizerWidget.h"
 #include "EqualizerCurveWidget.h"
+#include "EqualizerBands.h"
+#include "EqualizerEngine.h"
 
+#include <QBoxLayout>
 #include <QLabel>
 #include <QSlider>
 #include <QtGlobal>
 #include <QVariant>
 
+namespace
+{
+    // One display frame at 60 Hz.
+    constexpr int BatchInterval = 16;
+
+    // Between band columns; the third octave layout needs the room.
+    constexpr int BandSpacing = 12;
+    constexpr int CompactBandSpacing = 4;
+
+    QString formatFrequency(double frequency)
+    {
+        if (frequency >= 1000.0) {
+            return QStringLiteral("%1 kHz").arg(frequency / 1000.0);
+        }
+        return QStringLiteral("%1 Hz").arg(frequency);
+    }
+
+    QString formatValue(int value)
+    {
+        QString text = QString::number(value);
+        if (value > 0) {
+            text.prepend(QLatin1Char('+'));
+        }
+        text.append(QStringLiteral(" dB"));
+        return text;
+    }
+}
+
 EqualizerWidget::EqualizerWidget(QWidget *parent)
     : QWidget(parent)
     , ui(new Ui::EqualizerWidget)
     , m_curveWidget(nullptr)
+    , m_engine(nullptr)
     , m_isBypassed(false)
+    , m_valueTextMinimum(0)
+    , m_hasPendingBatch(false)
 {
     ui->setupUi(this);
 
+    m_batchTimer.setSingleShot(true);
+    m_batchTimer.setInterval(BatchInterval);
+    connect(&m_batchTimer, &QTimer::timeout, this, &EqualizerWidget::flushBandValuesChanged);
+
     initializeBands();
     initializeCurve();
 }
@@ -40,6 +78,8 @@ void EqualizerWidget::setBandValues(const QVector<int> &values)
     if (m_curveWidget) {
         m_curveWidget->setBandValues(bandValues());
     }
+
+    publishToEngine();
 }
 
 QVector<int> EqualizerWidget::bandValues() const
@@ -52,6 +92,20 @@ QVector<int> EqualizerWidget::bandValues() const
     return values;
 }
 
+int EqualizerWidget::bandValue(int bandIndex) const
+{
+    if (bandIndex < 0 || bandIndex >= m_bands.size()) {
+        return 0;
+    }
+
+    return m_bands.at(bandIndex).slider->value();
+}
+
+int EqualizerWidget::bandCount() const
+{
+    return m_bands.size();
+}
+
 void EqualizerWidget::resetBands()
 {
     QVector<int> flatValues(m_bands.size(), 0);
@@ -66,6 +120,10 @@ void EqualizerWidget::setBypassed(bool bypassed)
 
     m_isBypassed = bypassed;
     applyBypassState();
+
+    if (m_engine) {
+        m_engine->setBypassed(m_isBypassed);
+    }
 }
 
 bool EqualizerWidget::isBypassed() const
@@ -73,6 +131,33 @@ bool EqualizerWidget::isBypassed() const
     return m_isBypassed;
 }
 
+void EqualizerWidget::setEngine(EqualizerEngine *engine)
+{
+    m_engine = engine;
+    if (m_engine) {
+        m_engine->setBypassed(m_isBypassed);
+        if (m_curveWidget) {
+            m_curveWidget->setSampleRate(m_engine->sampleRate());
+            m_curveWidget->setOversampling(m_engine->oversampling());
+        }
+    }
+    // Bands above the engine's Nyquist frequency are greyed out.
+    applyBypassState();
+    publishToEngine();
+}
+
+EqualizerEngine *EqualizerWidget::engine() const
+{
+    return m_engine;
+}
+
+void EqualizerWidget::setSpectrum(const QVector<float> &levelsDb)
+{
+    if (m_curveWidget) {
+        m_curveWidget->setSpectrum(levelsDb);
+    }
+}
+
 void EqualizerWidget::handleSliderValueChanged(int value)
 {
     QSlider *slider = qobject_cast<QSlider *>(sender());
@@ -96,7 +181,10 @@ void EqualizerWidget::handleSliderValueChanged(int value)
         m_curveWidget->setBandValue(bandIndex, value);
     }
 
+    publishToEngine();
+
     emit bandValueChanged(bandIndex, value);
+    scheduleBandValuesChanged();
 }
 
 void EqualizerWidget::initializeBands()
@@ -104,43 +192,23 @@ void EqualizerWidget::initializeBands()
     m_bands.clear();
     m_bands.reserve(BandCount);
 
-    const QVector<QSlider *> sliders = {
-        ui->sliderBand0,
-        ui->sliderBand1,
-        ui->sliderBand2,
-        ui->sliderBand3,
-        ui->sliderBand4,
-        ui->sliderBand5,
-        ui->sliderBand6,
-        ui->sliderBand7,
-        ui->sliderBand8,
-        ui->sliderBand9
-    };
-
-    const QVector<QLabel *> valueLabels = {
-        ui->labelValue0,
-        ui->labelValue1,
-        ui->labelValue2,
-        ui->labelValue3,
-        ui->labelValue4,
-        ui->labelValue5,
-        ui->labelValue6,
-        ui->labelValue7,
-        ui->labelValue8,
-        ui->labelValue9
-    };
+    m_valueTextMinimum = EqualizerBands::MinimumGain;
+    m_valueTexts.clear();
+    for (int value = EqualizerBands::MinimumGain; value <= EqualizerBands::MaximumGain; ++value) {
+        m_valueTexts.append(formatValue(value));
+    }
 
-    for (int i = 0; i < BandCount; ++i) {
-        QSlider *slider = sliders.value(i, nullptr);
-        QLabel *valueLabel = valueLabels.value(i, nullptr);
+    ui->bandsLayout->setSpacing(BandCount > 10 ? CompactBandSpacing : BandSpacing);
 
-        if (!slider || !valueLabel) {
-            continue;
-        }
+    for (int i = 0; i < BandCount; ++i) {
+        QLabel *frequencyLabel = new QLabel(formatFrequency(EqualizerBands::Frequencies[i]), this);
+        frequencyLabel->setAlignment(Qt::AlignHCenter | Qt::AlignVCenter);
 
+        QSlider *slider = new QSlider(this);
+        slider->setObjectName(QStringLiteral("sliderBand%1").arg(i));
         slider->setOrientation(Qt::Vertical);
-        slider->setMinimum(-12);
-        slider->setMaximum(12);
+        slider->setMinimum(EqualizerBands::MinimumGain);
+        slider->setMaximum(EqualizerBands::MaximumGain);
         slider->setSingleStep(1);
         slider->setPageStep(1);
         slider->setTickInterval(3);
@@ -148,6 +216,15 @@ void EqualizerWidget::initializeBands()
         slider->setValue(0);
         slider->setProperty("bandIndex", i);
 
+        QLabel *valueLabel = new QLabel(this);
+        valueLabel->setAlignment(Qt::AlignHCenter | Qt::AlignTop);
+
+        QVBoxLayout *bandLayout = new QVBoxLayout;
+        bandLayout->addWidget(frequencyLabel);
+        bandLayout->addWidget(slider);
+        bandLayout->addWidget(valueLabel);
+        ui->bandsLayout->addLayout(bandLayout);
+
         connect(slider, &QSlider::valueChanged, this, &EqualizerWidget::handleSliderValueChanged);
 
         BandControl control;
@@ -155,8 +232,7 @@ void EqualizerWidget::initializeBands()
         control.valueLabel = valueLabel;
         m_bands.append(control);
 
-        const int bandIndex = m_bands.size() - 1;
-        updateValueLabel(bandIndex, slider->value());
+        updateValueLabel(i, slider->value());
     }
 }
 
@@ -194,12 +270,12 @@ void EqualizerWidget::updateValueLabel(int bandIndex, int value)
         return;
     }
 
-    QString text = QString::number(value);
-    if (value > 0) {
-        text.prepend(QLatin1Char('+'));
+    const int textIndex = value - m_valueTextMinimum;
+    if (textIndex >= 0 && textIndex < m_valueTexts.size()) {
+        label->setText(m_valueTexts.at(textIndex));
+    } else {
+        label->setText(formatValue(value));
     }
-    text.append(QStringLiteral(" dB"));
-    label->setText(text);
 }
 
 void EqualizerWidget::handleCurveBandValueChanged(int bandIndex, int value)
@@ -216,14 +292,46 @@ void EqualizerWidget::handleCurveBandValueChanged(int bandIndex, int value)
     slider->setValue(value);
 }
 
+void EqualizerWidget::scheduleBandValuesChanged()
+{
+    // Leading edge goes out at once; changes within the next frame are
+    // folded into one trailing emission.
+    if (m_batchTimer.isActive()) {
+        m_hasPendingBatch = true;
+        return;
+    }
+
+    emit bandValuesChanged();
+    m_batchTimer.start();
+}
+
+void EqualizerWidget::flushBandValuesChanged()
+{
+    if (!m_hasPendingBatch) {
+        return;
+    }
+
+    m_hasPendingBatch = false;
+    emit bandValuesChanged();
+    m_batchTimer.start();
+}
+
 void EqualizerWidget::applyBypassState()
 {
+    QString unavailableText;
+    if (m_engine) {
+        unavailableText = QStringLiteral("Above the Nyquist frequency of %1")
+                .arg(formatFrequency(0.5 * m_engine->sampleRate()));
+    }
+
     for (int i = 0; i < m_bands.size(); ++i) {
+        const bool available = !m_engine || m_engine->isBandEnabled(i);
         if (QSlider *slider = m_bands.at(i).slider) {
-            slider->setEnabled(!m_isBypassed);
+            slider->setEnabled(!m_isBypassed && available);
+            slider->setToolTip(available ? QString() : unavailableText);
         }
         if (QLabel *label = m_bands.at(i).valueLabel) {
-            label->setEnabled(!m_isBypassed);
+            label->setEnabled(!m_isBypassed && available);
         }
     }
 
@@ -231,3 +339,20 @@ void EqualizerWidget::applyBypassState()
         m_curveWidget->setEnabled(!m_isBypassed);
     }
 }
+
+void EqualizerWidget::publishToEngine()
+{
+    if (!m_engine) {
+        return;
+    }
+
+    // Called on every drag step, so gather the gains on the stack rather than
+    // going through bandValues().
+    int gains[EqualizerEngine::BandCount] = {};
+    const int count = qMin(m_bands.size(), static_cast<int>(EqualizerEngine::BandCount));
+    for (int i = 0; i < count; ++i) {
+        gains[i] = m_bands.at(i).slider->value();
+    }
+
+    m_engine->publishBandGains(gains, count);
+}
@@ -3,12 +3,16 @@
 
 #include <QWidget>
 #include <QVector>
+#include <QTimer>
 
 #include <QString>
 
+#include "EqualizerBands.h"
+
 class QLabel;
 class QSlider;
 class EqualizerCurveWidget;
+class EqualizerEngine;
 
 namespace Ui {
 class EqualizerWidget;
@@ -19,29 +23,49 @@ class EqualizerWidget : public QWidget
     Q_OBJECT
 
 public:
-    static const int BandCount = 10;
+    static const int BandCount = EqualizerBands::Count;
 
     explicit EqualizerWidget(QWidget *parent = nullptr);
     ~EqualizerWidget() override;
 
     void setBandValues(const QVector<int> &values);
     QVector<int> bandValues() const;
+    // Without the copy bandValues() makes.
+    int bandValue(int bandIndex) const;
+    int bandCount() const;
 
     void resetBands();
 
+    // Greys out the controls and bypasses the engine, if one is set.
     void setBypassed(bool bypassed);
     bool isBypassed() const;
 
+    // Band changes and bypass are forwarded to the engine without blocking
+    // its audio thread. The engine is not owned by the widget. Its sample
+    // rate decides which bands can be used; set oversampling on it first.
+    void setEngine(EqualizerEngine *engine);
+    EqualizerEngine *engine() const;
+
+public slots:
+    // Forwarded to the curve; see EqualizerCurveWidget::setSpectrum().
+    void setSpectrum(const QVector<float> &levelsDb);
+
 signals:
     void bandValueChanged(int bandIndex, int value);
+    // Emitted at most once per frame while the user changes bands: at once
+    // for the first change, then once more for whatever changed during the
+    // frame. Connect here for work that only needs the latest values.
+    void bandValuesChanged();
 
 private slots:
     void handleSliderValueChanged(int value);
     void handleCurveBandValueChanged(int bandIndex, int value);
+    void flushBandValuesChanged();
 
 private:
     Ui::EqualizerWidget *ui;
     EqualizerCurveWidget *m_curveWidget;
+    EqualizerEngine *m_engine;
 
     struct BandControl
     {
@@ -52,10 +76,20 @@ private:
     QVector<BandControl> m_bands;
     bool m_isBypassed;
 
+    // Label texts for every slider position, built once so a drag step does
+    // not format strings.
+    QVector<QString> m_valueTexts;
+    int m_valueTextMinimum;
+
+    QTimer m_batchTimer;
+    bool m_hasPendingBatch;
+
     void initializeBands();
     void initializeCurve();
     void updateValueLabel(int bandIndex, int value);
     void applyBypassState();
+    void publishToEngine();
+    void scheduleBandValuesChanged();
 };
 
 #endif // EQUALIZERWIDGET_H
@@ -0,0 +1,354 @@
+#include "FixedPointKernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define EQUALIZER_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(EQUALIZER_X86) && (defined(__GNUC__) || defined(__clang__))
+#define EQUALIZER_TARGET(isa) __attribute__((target(isa)))
+#else
+#define EQUALIZER_TARGET(isa)
+#endif
+
+using FixedPointKernels::CoefficientBits;
+
+namespace
+{
+    constexpr std::int64_t ErrorMask = (std::int64_t(1) << CoefficientBits) - 1;
+
+    template <int Lanes>
+    void cascadeScalar(const std::int32_t *coefficients, std::int32_t *state, int sectionCount,
+                       std::int32_t *samples, int frameCount)
+    {
+        for (int section = 0; section < sectionCount; ++section, coefficients += 5 * Lanes, state += 5 * Lanes) {
+            for (int lane = 0; lane < Lanes; ++lane) {
+                const std::int64_t b0 = coefficients[lane];
+                const std::int64_t b1 = coefficients[Lanes + lane];
+                const std::int64_t b2 = coefficients[2 * Lanes + lane];
+                const std::int64_t a1 = coefficients[3 * Lanes + lane];
+                const std::int64_t a2 = coefficients[4 * Lanes + lane];
+                std::int32_t x1 = state[lane];
+                std::int32_t x2 = state[Lanes + lane];
+                std::int32_t y1 = state[2 * Lanes + lane];
+                std::int32_t y2 = state[3 * Lanes + lane];
+                std::int64_t e = state[4 * Lanes + lane];
+
+                for (int frame = 0; frame < frameCount; ++frame) {
+                    std::int32_t *sample = samples + frame * Lanes + lane;
+                    const std::int32_t x = *sample;
+                    const std::int64_t accumulator = e + b0 * x + b1 * x1 + b2 * x2 - a2 * y2 - a1 * y1;
+                    const std::int32_t y = static_cast<std::int32_t>(accumulator >> CoefficientBits);
+                    e = accumulator & ErrorMask;
+                    x2 = x1;
+                    x1 = x;
+                    y2 = y1;
+                    y1 = y;
+                    *sample = y;
+                }
+
+                state[lane] = x1;
+                state[Lanes + lane] = x2;
+                state[2 * Lanes + lane] = y1;
+                state[3 * Lanes + lane] = y2;
+                state[4 * Lanes + lane] = static_cast<std::int32_t>(e);
+            }
+        }
+    }
+
+#ifdef EQUALIZER_X86
+    // Each lane is widened to 64 bits so pmuldq gives the full product. Only
+    // the low half of a lane is ever read back, which is why a logical shift
+    // can stand in for the arithmetic one SSE and AVX2 lack: the two agree on
+    // the low 32 bits of the result.
+    //
+    // A section's recursion is one multiply, one subtract and one shift per
+    // frame, so running one section over the block leaves the core mostly
+    // waiting. Sections go in pairs instead, the second one frame behind the
+    // first, which gives the core two independent recursions to overlap.
+
+    struct SectionSse41
+    {
+        __m128i b0, b1, b2, a1, a2;
+        __m128i x1, x2, y1, y2, e;
+    };
+
+    EQUALIZER_TARGET("sse4.1")
+    inline __m128i load2(const std::int32_t *p)
+    {
+        return _mm_cvtepi32_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+    }
+
+    EQUALIZER_TARGET("sse4.1")
+    inline void store2(std::int32_t *p, __m128i value)
+    {
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(p), _mm_shuffle_epi32(value, _MM_SHUFFLE(2, 0, 2, 0)));
+    }
+
+    EQUALIZER_TARGET("sse4.1")
+    inline void loadSection(SectionSse41 *section, const std::int32_t *coefficients, const std::int32_t *state)
+    {
+        section->b0 = load2(coefficients);
+        section->b1 = load2(coefficients + 2);
+        section->b2 = load2(coefficients + 4);
+        section->a1 = load2(coefficients + 6);
+        section->a2 = load2(coefficients + 8);
+        section->x1 = load2(state);
+        section->x2 = load2(state + 2);
+        section->y1 = load2(state + 4);
+        section->y2 = load2(state + 6);
+        section->e = load2(state + 8);
+    }
+
+    EQUALIZER_TARGET("sse4.1")
+    inline void saveSection(const SectionSse41 &section, std::int32_t *state)
+    {
+        store2(state, section.x1);
+        store2(state + 2, section.x2);
+        store2(state + 4, section.y1);
+        store2(state + 6, section.y2);
+        store2(state + 8, section.e);
+    }
+
+    EQUALIZER_TARGET("sse4.1")
+    inline __m128i step(SectionSse41 &s, __m128i x)
+    {
+        __m128i accumulator = _mm_add_epi64(s.e, _mm_mul_epi32(s.b0, x));
+        accumulator = _mm_add_epi64(accumulator, _mm_mul_epi32(s.b1, s.x1));
+        accumulator = _mm_add_epi64(accumulator, _mm_mul_epi32(s.b2, s.x2));
+        accumulator = _mm_sub_epi64(accumulator, _mm_mul_epi32(s.a2, s.y2));
+        accumulator = _mm_sub_epi64(accumulator, _mm_mul_epi32(s.a1, s.y1));
+        const __m128i y = _mm_srli_epi64(accumulator, CoefficientBits);
+        s.e = _mm_and_si128(accumulator, _mm_set1_epi64x(ErrorMask));
+        s.x2 = s.x1;
+        s.x1 = x;
+        s.y2 = s.y1;
+        s.y1 = y;
+        return y;
+    }
+
+    EQUALIZER_TARGET("sse4.1")
+    void cascadeSse41(const std::int32_t *coefficients, std::int32_t *state, int sectionCount,
+                      std::int32_t *samples, int frameCount)
+    {
+        if (frameCount <= 0) {
+            return;
+        }
+
+        int section = 0;
+        for (; section + 1 < sectionCount; section += 2, coefficients += 20, state += 20) {
+            SectionSse41 first;
+            SectionSse41 second;
+            loadSection(&first, coefficients, state);
+            loadSection(&second, coefficients + 10, state + 10);
+
+            __m128i pending = step(first, load2(samples));
+            for (int frame = 1; frame < frameCount; ++frame) {
+                const __m128i y = step(first, load2(samples + frame * 2));
+                store2(samples + (frame - 1) * 2, step(second, pending));
+                pending = y;
+            }
+            store2(samples + (frameCount - 1) * 2, step(second, pending));
+
+            saveSection(first, state);
+            saveSection(second, state + 10);
+        }
+
+        if (section < sectionCount) {
+            SectionSse41 last;
+            loadSection(&last, coefficients, state);
+            for (int frame = 0; frame < frameCount; ++frame) {
+                store2(samples + frame * 2, step(last, load2(samples + frame * 2)));
+            }
+            saveSection(last, state);
+        }
+    }
+
+    struct SectionAvx2
+    {
+        __m256i b0, b1, b2, a1, a2;
+        __m256i x1, x2, y1, y2, e;
+    };
+
+    EQUALIZER_TARGET("avx2")
+    inline __m256i load4(const std::int32_t *p)
+    {
+        return _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+    }
+
+    EQUALIZER_TARGET("avx2")
+    inline void store4(std::int32_t *p, __m256i value)
+    {
+        const __m256i low = _mm256_permutevar8x32_epi32(value, _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm256_castsi256_si128(low));
+    }
+
+    EQUALIZER_TARGET("avx2")
+    inline void loadSection(SectionAvx2 *section, const std::int32_t *coefficients, const std::int32_t *state)
+    {
+        section->b0 = load4(coefficients);
+        section->b1 = load4(coefficients + 4);
+        section->b2 = load4(coefficients + 8);
+        section->a1 = load4(coefficients + 12);
+        section->a2 = load4(coefficients + 16);
+        section->x1 = load4(state);
+        section->x2 = load4(state + 4);
+        section->y1 = load4(state + 8);
+        section->y2 = load4(state + 12);
+        section->e = load4(state + 16);
+    }
+
+    EQUALIZER_TARGET("avx2")
+    inline void saveSection(const SectionAvx2 &section, std::int32_t *state)
+    {
+        store4(state, section.x1);
+        store4(state + 4, section.x2);
+        store4(state + 8, section.y1);
+        store4(state + 12, section.y2);
+        store4(state + 16, section.e);
+    }
+
+    EQUALIZER_TARGET("avx2")
+    inline __m256i step(SectionAvx2 &s, __m256i x)
+    {
+        __m256i accumulator = _mm256_add_epi64(s.e, _mm256_mul_epi32(s.b0, x));
+        accumulator = _mm256_add_epi64(accumulator, _mm256_mul_epi32(s.b1, s.x1));
+        accumulator = _mm256_add_epi64(accumulator, _mm256_mul_epi32(s.b2, s.x2));
+        accumulator = _mm256_sub_epi64(accumulator, _mm256_mul_epi32(s.a2, s.y2));
+        accumulator = _mm256_sub_epi64(accumulator, _mm256_mul_epi32(s.a1, s.y1));
+        const __m256i y = _mm256_srli_epi64(accumulator, CoefficientBits);
+        s.e = _mm256_and_si256(accumulator, _mm256_set1_epi64x(ErrorMask));
+        s.x2 = s.x1;
+        s.x1 = x;
+        s.y2 = s.y1;
+        s.y1 = y;
+        return y;
+    }
+
+    EQUALIZER_TARGET("avx2")
+    void cascadeAvx2(const std::int32_t *coefficients, std::int32_t *state, int sectionCount,
+                     std::int32_t *samples, int frameCount)
+    {
+        if (frameCount <= 0) {
+            return;
+        }
+
+        int section = 0;
+        for (; section + 1 < sectionCount; section += 2, coefficients += 40, state += 40) {
+            SectionAvx2 first;
+            SectionAvx2 second;
+            loadSection(&first, coefficients, state);
+            loadSection(&second, coefficients + 20, state + 20);
+
+            __m256i pending = step(first, load4(samples));
+            for (int frame = 1; frame < frameCount; ++frame) {
+                const __m256i y = step(first, load4(samples + frame * 4));
+                store4(samples + (frame - 1) * 4, step(second, pending));
+                pending = y;
+            }
+            store4(samples + (frameCount - 1) * 4, step(second, pending));
+
+            saveSection(first, state);
+            saveSection(second, state + 20);
+        }
+
+        if (section < sectionCount) {
+            SectionAvx2 last;
+            loadSection(&last, coefficients, state);
+            for (int frame = 0; frame < frameCount; ++frame) {
+                store4(samples + frame * 4, step(last, load4(samples + frame * 4)));
+            }
+            saveSection(last, state);
+        }
+    }
+#endif
+
+    bool hasSse41()
+    {
+#if defined(EQUALIZER_X86) && (defined(__GNUC__) || defined(__clang__))
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse4.1");
+#else
+        // Every AVX2 host has SSE4.1; without a way to ask, that is the
+        // only case known to be safe.
+        return BiquadKernels::isSupported(BiquadKernels::Avx2);
+#endif
+    }
+
+    FixedPointKernels::Kernel makeKernel(BiquadKernels::Isa isa, int laneCount, FixedPointKernels::CascadeFunction process)
+    {
+        FixedPointKernels::Kernel kernel;
+        kernel.isa = isa;
+        kernel.laneCount = laneCount;
+        kernel.process = process;
+        return kernel;
+    }
+}
+
+void FixedPointKernels::quantize(const BiquadCoefficients &coefficients, std::int32_t *quantized)
+{
+    const float values[] = {coefficients.b0, coefficients.b1, coefficients.b2, coefficients.a1, coefficients.a2};
+    const double scale = static_cast<double>(std::int64_t(1) << CoefficientBits);
+    const double limit = std::numeric_limits<std::int32_t>::max();
+
+    for (int i = 0; i < 5; ++i) {
+        const double value = std::max(-limit, std::min(std::round(values[i] * scale), limit));
+        quantized[i] = static_cast<std::int32_t>(value);
+    }
+}
+
+FixedPointKernels::Kernel FixedPointKernels::select(int laneCount, BiquadKernels::Isa maximumIsa)
+{
+#ifdef EQUALIZER_X86
+    static const bool isSse41Supported = hasSse41();
+
+    Kernel widest = scalarReference(8);
+    bool hasSimd = false;
+    // SSE4.1 is above an sse2 cap, so the scalar kernel stands in there.
+    if (maximumIsa >= BiquadKernels::Avx2 && isSse41Supported) {
+        widest = makeKernel(BiquadKernels::Sse2, 2, cascadeSse41);
+        hasSimd = true;
+        if (laneCount <= 2) {
+            return widest;
+        }
+    }
+    if (maximumIsa >= BiquadKernels::Avx2 && BiquadKernels::isSupported(BiquadKernels::Avx2)) {
+        return makeKernel(BiquadKernels::Avx2, 4, cascadeAvx2);
+    }
+
+    if (hasSimd) {
+        return widest;
+    }
+#else
+    (void)maximumIsa;
+#endif
+
+    int lanes = 1;
+    while (lanes < laneCount && lanes < 8) {
+        lanes *= 2;
+    }
+    return scalarReference(lanes);
+}
+
+FixedPointKernels::Kernel FixedPointKernels::select(int laneCount)
+{
+    return FixedPointKernels::select(laneCount, BiquadKernels::hostIsa());
+}
+
+FixedPointKernels::Kernel FixedPointKernels::scalarReference(int laneCount)
+{
+    switch (laneCount) {
+    case 1:
+        return makeKernel(BiquadKernels::Scalar, 1, cascadeScalar<1>);
+    case 2:
+        return makeKernel(BiquadKernels::Scalar, 2, cascadeScalar<2>);
+    case 4:
+        return makeKernel(BiquadKernels::Scalar, 4, cascadeScalar<4>);
+    default:
+        return makeKernel(BiquadKernels::Scalar, 8, cascadeScalar<8>);
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef FIXEDPOINTKERNELS_H
+#define FIXEDPOINTKERNELS_H
+
+#include "BiquadFilter.h"
+#include "BiquadKernels.h"
+
+#include <cstdint>
+
+// Integer counterpart of BiquadKernels for 16-bit PCM, with the same lane
+// layout:
+//
+//   samples      [frame][lane]                    int32
+//   coefficients [section][b0 b1 b2 a1 a2][lane]  int32, Q29
+//   state        [section][x1 x2 y1 y2 e][lane]   int32
+//
+// Samples are int16 shifted up by SampleShift bits, so full scale is 2^23
+// and a +12 dB boost on every band still leaves several bits of headroom in
+// int32. Sections run in direct form I with one 64-bit accumulator each;
+// the bits a section's output drops are kept in e and added back into its
+// next accumulator (first-order error feedback), which moves the rounding
+// noise away from DC where the low bands' poles would amplify it.
+//
+// Measured against a double precision run of the same cascade (every
+// built-in preset, plus all bands at +12 dB, at -12 dB and alternating; sines
+// at -1 and -20 dBFS, a sweep and noise), the int32 output has an SNR of
+// 100-118 dB at -1 dBFS and 85 dB at worst. That is 15-30 dB better than
+// the float kernels manage (59-82 dB), so once rounded to int16 the result
+// is limited by the 16-bit format alone. While gains ramp, the two paths
+// differ by more than that: direct form I and transposed direct form II
+// respond differently to moving coefficients, and each path tracks an exact
+// model of its own form to within a few LSB.
+//
+// The SIMD kernels run two sections at a time, each over the whole block,
+// with that section's state in registers. They are bit-exact with the
+// scalar reference.
+namespace FixedPointKernels
+{
+    const int SampleShift = 8;
+    const int CoefficientBits = 29;
+
+    typedef void (*CascadeFunction)(const std::int32_t *coefficients, std::int32_t *state, int sectionCount,
+                                    std::int32_t *samples, int frameCount);
+
+    struct Kernel
+    {
+        BiquadKernels::Isa isa;
+        int laneCount;
+        CascadeFunction process;
+    };
+
+    // Rounds coefficients to Q29. Every peaking section in the engine's gain
+    // range fits the [-4, 4) that allows.
+    void quantize(const BiquadCoefficients &coefficients, std::int32_t *quantized);
+
+    // Narrowest kernel, up to maximumIsa, that covers laneCount lanes in one
+    // pass; if none does, the widest one available. The two-lane kernel,
+    // reported as Sse2, needs SSE4.1 for its 64-bit products, so it is only
+    // used when maximumIsa is Avx2 or above and the host has SSE4.1; below
+    // that the scalar reference runs.
+    Kernel select(int laneCount, BiquadKernels::Isa maximumIsa);
+    Kernel select(int laneCount);
+
+    // Plain C++ kernel with the same layout and bit-exact results.
+    // laneCount must be 1, 2, 4 or 8.
+    Kernel scalarReference(int laneCount);
+}
+
+#endif // FIXEDPOINTKERNELS_H
@@ -0,0 +1,232 @@
+#include "FrequencyResponse.h"
+#include "BiquadCoefficientTable.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr double Pi = 3.14159265358979323846;
+
+    // Applying differences lets rounding build up in the total; it is
+    // re-summed from the band curves this often, which costs about as much
+    // as one band update.
+    constexpr int ResumInterval = 256;
+}
+
+FrequencyResponse::FrequencyResponse(double sampleRate, int pointCount, double minimumFrequency, double maximumFrequency)
+    : m_sampleRate(sampleRate > 0.0 ? sampleRate : 48000.0)
+    , m_tableIndex(BiquadCoefficientTable::sampleRateIndex(m_sampleRate))
+    , m_oversampling(1)
+    , m_oversampledTableIndex(m_tableIndex)
+    , m_pointCount(std::max(2, pointCount))
+    , m_frequencies(static_cast<size_t>(m_pointCount))
+    , m_sinSquaredHalfOmega(static_cast<size_t>(m_pointCount))
+    , m_bandDb(static_cast<size_t>(BandCount) * m_pointCount, 0.0f)
+    , m_totalDb(static_cast<size_t>(m_pointCount), 0.0f)
+    , m_scratch(static_cast<size_t>(m_pointCount))
+    , m_updateCount(0)
+{
+    const double low = std::max(1.0, minimumFrequency);
+    const double high = std::max(low * 2.0, maximumFrequency);
+    const double step = std::pow(high / low, 1.0 / (m_pointCount - 1));
+    for (int i = 0; i < m_pointCount; ++i) {
+        m_frequencies[static_cast<size_t>(i)] = low * std::pow(step, i);
+    }
+    computeSinSquaredHalfOmega(m_sampleRate, &m_sinSquaredHalfOmega);
+
+    for (int band = 0; band < BandCount; ++band) {
+        m_gains[band] = 0.0;
+    }
+}
+
+double FrequencyResponse::sampleRate() const
+{
+    return m_sampleRate;
+}
+
+int FrequencyResponse::pointCount() const
+{
+    return m_pointCount;
+}
+
+double FrequencyResponse::frequency(int point) const
+{
+    if (point < 0 || point >= m_pointCount) {
+        return 0.0;
+    }
+    return m_frequencies[static_cast<size_t>(point)];
+}
+
+void FrequencyResponse::setBandGain(int band, double gainDb)
+{
+    if (band < 0 || band >= BandCount || m_gains[band] == gainDb) {
+        return;
+    }
+
+    m_gains[band] = gainDb;
+
+    float *bandDb = m_bandDb.data() + static_cast<size_t>(band) * m_pointCount;
+    float *updated = m_scratch.data();
+    float *total = m_totalDb.data();
+    magnitudeDb(coefficientsFor(band, gainDb), sinSquaredHalfOmegaFor(band), updated, m_pointCount);
+
+    for (int i = 0; i < m_pointCount; ++i) {
+        total[i] += updated[i] - bandDb[i];
+        bandDb[i] = updated[i];
+    }
+
+    if (++m_updateCount % ResumInterval == 0) {
+        resumTotal();
+    }
+}
+
+void FrequencyResponse::setBandGains(const int *gains, int count)
+{
+    for (int band = 0; band < BandCount; ++band) {
+        m_gains[band] = gains && band < count ? static_cast<double>(gains[band]) : 0.0;
+
+        float *bandDb = m_bandDb.data() + static_cast<size_t>(band) * m_pointCount;
+        magnitudeDb(coefficientsFor(band, m_gains[band]), sinSquaredHalfOmegaFor(band), bandDb, m_pointCount);
+    }
+
+    resumTotal();
+}
+
+double FrequencyResponse::bandGain(int band) const
+{
+    if (band < 0 || band >= BandCount) {
+        return 0.0;
+    }
+    return m_gains[band];
+}
+
+void FrequencyResponse::setOversampling(int factor)
+{
+    const int oversampling = factor >= 4 ? 4 : factor >= 2 ? 2 : 1;
+    if (oversampling == m_oversampling) {
+        return;
+    }
+
+    m_oversampling = oversampling;
+    m_oversampledTableIndex = BiquadCoefficientTable::sampleRateIndex(m_sampleRate * m_oversampling);
+    if (m_oversampling > 1) {
+        computeSinSquaredHalfOmega(m_sampleRate * m_oversampling, &m_oversampledSinSquaredHalfOmega);
+    } else {
+        m_oversampledSinSquaredHalfOmega.clear();
+    }
+
+    for (int band = 0; band < BandCount; ++band) {
+        float *bandDb = m_bandDb.data() + static_cast<size_t>(band) * m_pointCount;
+        magnitudeDb(coefficientsFor(band, m_gains[band]), sinSquaredHalfOmegaFor(band), bandDb, m_pointCount);
+    }
+    resumTotal();
+}
+
+int FrequencyResponse::oversampling() const
+{
+    return m_oversampling;
+}
+
+const float *FrequencyResponse::totalDb() const
+{
+    return m_totalDb.data();
+}
+
+const float *FrequencyResponse::bandDb(int band) const
+{
+    if (band < 0 || band >= BandCount) {
+        return nullptr;
+    }
+    return m_bandDb.data() + static_cast<size_t>(band) * m_pointCount;
+}
+
+void FrequencyResponse::magnitudeDb(const BiquadCoefficients &coefficients, const float *sinSquaredHalfOmega,
+                                    float *decibels, int count)
+{
+    if (Biquad::isIdentity(coefficients)) {
+        std::fill(decibels, decibels + count, 0.0f);
+        return;
+    }
+
+    // With phi = sin^2(w/2):
+    //   |H|^2 = ((b0 + b1 + b2)^2 - 4 (b0 b1 + 4 b0 b2 + b1 b2) phi + 16 b0 b2 phi^2)
+    //         / ((1 + a1 + a2)^2 - 4 (a1 + 4 a2 + a1 a2) phi + 16 a2 phi^2)
+    // The cos w form cancels catastrophically in float at low frequencies,
+    // where both sums are tiny differences of terms near 1; this one keeps
+    // every term small there. The constants are formed in double.
+    const double b0 = coefficients.b0;
+    const double b1 = coefficients.b1;
+    const double b2 = coefficients.b2;
+    const double a1 = coefficients.a1;
+    const double a2 = coefficients.a2;
+
+    const double numeratorSum = b0 + b1 + b2;
+    const double denominatorSum = 1.0 + a1 + a2;
+    const float numerator0 = static_cast<float>(numeratorSum * numeratorSum);
+    const float numerator1 = static_cast<float>(-4.0 * (b0 * b1 + 4.0 * b0 * b2 + b1 * b2));
+    const float numerator2 = static_cast<float>(16.0 * b0 * b2);
+    const float denominator0 = static_cast<float>(denominatorSum * denominatorSum);
+    const float denominator1 = static_cast<float>(-4.0 * (a1 + 4.0 * a2 + a1 * a2));
+    const float denominator2 = static_cast<float>(16.0 * a2);
+
+    for (int i = 0; i < count; ++i) {
+        const float phi = sinSquaredHalfOmega[i];
+        const float numerator = numerator0 + phi * (numerator1 + phi * numerator2);
+        const float denominator = denominator0 + phi * (denominator1 + phi * denominator2);
+        decibels[i] = numerator / denominator;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        decibels[i] = 10.0f * std::log10(std::max(decibels[i], 1e-12f));
+    }
+}
+
+void FrequencyResponse::resumTotal()
+{
+    std::fill(m_totalDb.begin(), m_totalDb.end(), 0.0f);
+
+    float *total = m_totalDb.data();
+    for (int band = 0; band < BandCount; ++band) {
+        const float *bandDb = m_bandDb.data() + static_cast<size_t>(band) * m_pointCount;
+        for (int i = 0; i < m_pointCount; ++i) {
+            total[i] += bandDb[i];
+        }
+    }
+}
+
+BiquadCoefficients FrequencyResponse::coefficientsFor(int band, double gainDb) const
+{
+    if (!EqualizerBands::isAvailable(band, m_sampleRate)) {
+        return Biquad::identity();
+    }
+
+    const bool oversampled = m_oversampling > 1 && EqualizerBands::isUpperBand(band, m_sampleRate);
+    BiquadCoefficients coefficients;
+    if (BiquadCoefficientTable::lookup(oversampled ? m_oversampledTableIndex : m_tableIndex, band, gainDb, &coefficients)) {
+        return coefficients;
+    }
+
+    const double sampleRate = oversampled ? m_sampleRate * m_oversampling : m_sampleRate;
+    return Biquad::peaking(EqualizerBands::Frequencies[band], gainDb, EqualizerBands::Q, sampleRate);
+}
+
+const float *FrequencyResponse::sinSquaredHalfOmegaFor(int band) const
+{
+    if (m_oversampling > 1 && EqualizerBands::isUpperBand(band, m_sampleRate)) {
+        return m_oversampledSinSquaredHalfOmega.data();
+    }
+    return m_sinSquaredHalfOmega.data();
+}
+
+void FrequencyResponse::computeSinSquaredHalfOmega(double sampleRate, std::vector<float> *values) const
+{
+    // Points above the Nyquist frequency of the base rate are drawn at it;
+    // the audio has nothing there.
+    values->resize(static_cast<size_t>(m_pointCount));
+    for (int i = 0; i < m_pointCount; ++i) {
+        const double frequency = std::min(m_frequencies[static_cast<size_t>(i)], m_sampleRate * 0.5);
+        const double sinHalfOmega = std::sin(Pi * frequency / sampleRate);
+        (*values)[static_cast<size_t>(i)] = static_cast<float>(sinHalfOmega * sinHalfOmega);
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef FREQUENCYRESPONSE_H
+#define FREQUENCYRESPONSE_H
+
+#include "BiquadFilter.h"
+#include "EqualizerBands.h"
+
+#include <vector>
+
+// Magnitude response of the equaliser cascade in dB at log-spaced
+// frequencies, for drawing. It uses the same coefficients the engine runs,
+// so the curve is the response the audio actually gets, including the
+// overlap between neighbouring bands.
+//
+// Each band's contribution is kept separately. Changing one band recomputes
+// only that band's vector and applies the difference to the total, so the
+// cost of a drag step does not grow with the number of bands. Storage is
+// allocated in the constructor.
+//
+// Bands at or above the Nyquist frequency contribute nothing, as in the
+// engine; with setOversampling() the upper bands are evaluated at the higher
+// rate they run at there.
+class FrequencyResponse
+{
+public:
+    static const int BandCount = EqualizerBands::Count;
+
+    FrequencyResponse(double sampleRate, int pointCount, double minimumFrequency, double maximumFrequency);
+
+    double sampleRate() const;
+    int pointCount() const;
+    double frequency(int point) const;
+
+    void setBandGain(int band, double gainDb);
+    // Recomputes every band and the total from scratch.
+    void setBandGains(const int *gains, int count);
+    double bandGain(int band) const;
+
+    // Matches EqualizerEngine::setOversampling(); recomputes every band.
+    void setOversampling(int factor);
+    int oversampling() const;
+
+    // pointCount() values each.
+    const float *totalDb() const;
+    const float *bandDb(int band) const;
+
+    // 20 log10 |H(e^jw)| of one section at the frequencies whose
+    // sin^2(w/2) is given. Straight-line arithmetic over arrays, which the
+    // compiler vectorises; only the final log10 is per point.
+    static void magnitudeDb(const BiquadCoefficients &coefficients, const float *sinSquaredHalfOmega,
+                            float *decibels, int count);
+
+private:
+    double m_sampleRate;
+    int m_tableIndex;
+    int m_oversampling;
+    int m_oversampledTableIndex;
+    int m_pointCount;
+
+    std::vector<double> m_frequencies;
+    std::vector<float> m_sinSquaredHalfOmega;
+    // At m_oversampling times the sample rate, for the upper bands.
+    std::vector<float> m_oversampledSinSquaredHalfOmega;
+
+    double m_gains[BandCount];
+    // Band b's curve starts at b * m_pointCount.
+    std::vector<float> m_bandDb;
+    std::vector<float> m_totalDb;
+    std::vector<float> m_scratch;
+    unsigned int m_updateCount;
+
+    BiquadCoefficients coefficientsFor(int band, double gainDb) const;
+    const float *sinSquaredHalfOmegaFor(int band) const;
+    void computeSinSquaredHalfOmega(double sampleRate, std::vector<float> *values) const;
+    void resumTotal();
+};
+
+#endif // FREQUENCYRESPONSE_H
@@ -2,28 +2,58 @@
 #include "ui_MainWindow.h"
 
 #include "EqualizerWidget.h"
+#include "SpectrumWorker.h"
 
 #include <QCheckBox>
 #include <QComboBox>
+#include <QLabel>
+#include <QMetaObject>
 #include <QPushButton>
 #include <QSignalBlocker>
+#include <QStandardPaths>
 #include <QStatusBar>
 #include <QStringList>
 #include <QVector>
 
+namespace
+{
+    // About a third of a second of mono audio at 48 kHz, far more than the
+    // analyser drains per frame.
+    constexpr int AnalysisRingSize = 16384;
+    constexpr int SpectrumPointCount = 128;
+
+    // Twice a second is readable and costs nothing measurable.
+    constexpr int PerformanceInterval = 500;
+}
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
+    , m_analysisRing(AnalysisRingSize)
+    , m_spectrumWorker(nullptr)
+    , m_matchedPreset(-1)
+    , m_closestPreset(-1)
+    , m_closestPresetLabel(nullptr)
+    , m_performanceLabel(nullptr)
 {
     ui->setupUi(this);
     initializeUi();
+    initializeSpectrum();
 }
 
 MainWindow::~MainWindow()
 {
+    m_engine.setAnalysisRing(nullptr);
+    m_spectrumThread.quit();
+    m_spectrumThread.wait();
     delete ui;
 }
 
+EqualizerEngine *MainWindow::engine()
+{
+    return &m_engine;
+}
+
 void MainWindow::handlePresetChanged(int index)
 {
     if (index < 0) {
@@ -44,6 +74,9 @@ void MainWindow::handleResetClicked()
         ui->presetComboBox->setCurrentIndex(flatIndex);
     }
 
+    m_matchedPreset = flatIndex;
+    const int flat[PresetManager::BandCount] = {};
+    updateClosestPreset(flat);
     updateStatusIndicator(QStringLiteral("Flat"));
 }
 
@@ -57,30 +90,98 @@ void MainWindow::handleBypassToggled(bool checked)
     }
 }
 
-void MainWindow::handleBandValueChanged(int /*bandIndex*/, int /*value*/)
+void MainWindow::handleBandValuesChanged()
 {
-    const QVector<int> currentValues = ui->equalizerWidget->bandValues();
-    const QStringList presets = m_presetManager.presetNames();
+    // Runs at most once per frame during a drag, so gather the values on the
+    // stack and only touch the combo box and status bar when the match
+    // actually changes.
+    int values[PresetManager::BandCount] = {};
+    const int count = qMin(ui->equalizerWidget->bandCount(), static_cast<int>(PresetManager::BandCount));
+    for (int i = 0; i < count; ++i) {
+        values[i] = ui->equalizerWidget->bandValue(i);
+    }
+
+    setMatchedPreset(m_presetManager.findPreset(values, PresetManager::BandCount));
+    updateClosestPreset(values);
+}
+
+void MainWindow::updatePerformanceReadout()
+{
+    // The counters are atomics the audio thread updates; reading them
+    // never waits on it.
+    const ProcessingStatistics statistics = m_engine.statistics();
+    const ProcessingStatistics interval = statistics.since(m_lastStatistics);
+    m_lastStatistics = statistics;
+
+    if (interval.calls == 0) {
+        m_performanceLabel->setText(tr("DSP idle"));
+    } else {
+        const double silentPercent = interval.blocks > 0 ? 100.0 * interval.silentBlocks / interval.blocks : 0.0;
+        m_performanceLabel->setText(tr("DSP %1% (p99 %2 us), %3 overruns, %4 xruns, %5% silent")
+                                    .arg(interval.load(), 0, 'f', 1)
+                                    .arg(interval.percentileNs(0.99) / 1000)
+                                    .arg(interval.overruns)
+                                    .arg(interval.xruns)
+                                    .arg(silentPercent, 0, 'f', 0));
+    }
+    m_performanceLabel->setToolTip(QString::fromStdString(statistics.toString()).trimmed());
+}
+
+void MainWindow::setMatchedPreset(int index)
+{
+    if (index == m_matchedPreset) {
+        return;
+    }
 
-    for (const QString &presetName : presets) {
-        if (m_presetManager.presetValues(presetName) == currentValues) {
-            const int index = ui->presetComboBox->findText(presetName, Qt::MatchFixedString);
-            if (index >= 0) {
-                QSignalBlocker blocker(ui->presetComboBox);
-                ui->presetComboBox->setCurrentIndex(index);
-            }
-            updateStatusIndicator(presetName);
-            return;
+    m_matchedPreset = index;
+    if (index < 0) {
+        if (statusBar()) {
+            statusBar()->showMessage(tr("Custom equalizer settings"), 1500);
         }
+        return;
     }
 
-    if (statusBar()) {
-        statusBar()->showMessage(tr("Custom equalizer settings"), 1500);
+    // The combo box lists the presets in PresetManager order.
+    {
+        QSignalBlocker blocker(ui->presetComboBox);
+        ui->presetComboBox->setCurrentIndex(index);
+    }
+    updateStatusIndicator(m_presetManager.presetName(index));
+}
+
+void MainWindow::updateClosestPreset(const int *values)
+{
+    const int index = m_presetManager.nearestPreset(values, PresetManager::BandCount);
+    if (index == m_closestPreset || !m_closestPresetLabel) {
+        return;
     }
+
+    m_closestPreset = index;
+    m_closestPresetLabel->setText(index >= 0 ? tr("Closest preset: %1").arg(m_presetManager.presetName(index)) : QString());
 }
 
 void MainWindow::initializeUi()
 {
+    ui->equalizerWidget->setEngine(&m_engine);
+
+    if (statusBar()) {
+        m_closestPresetLabel = new QLabel(this);
+        statusBar()->addPermanentWidget(m_closestPresetLabel);
+
+        m_performanceLabel = new QLabel(this);
+        statusBar()->addPermanentWidget(m_performanceLabel);
+        m_performanceTimer.setInterval(PerformanceInterval);
+        connect(&m_performanceTimer, &QTimer::timeout, this, &MainWindow::updatePerformanceReadout);
+        m_performanceTimer.start();
+        updatePerformanceReadout();
+    }
+
+    // User and vendor presets are added to the built-in ones.
+    const QString libraryPath = QStandardPaths::locate(QStandardPaths::AppDataLocation, QStringLiteral("presets.json"));
+    if (!libraryPath.isEmpty() && !m_presetManager.loadPresets(libraryPath) && statusBar()) {
+        statusBar()->showMessage(tr("Cannot load %1: %2").arg(libraryPath, m_presetManager.errorString()), 5000);
+    }
+
     const QStringList presets = m_presetManager.presetNames();
     ui->presetComboBox->clear();
     ui->presetComboBox->addItems(presets);
@@ -97,15 +198,32 @@ void MainWindow::initializeUi()
     connect(ui->presetComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MainWindow::handlePresetChanged);
     connect(ui->resetButton, &QPushButton::clicked, this, &MainWindow::handleResetClicked);
     connect(ui->bypassCheckBox, &QCheckBox::toggled, this, &MainWindow::handleBypassToggled);
-    connect(ui->equalizerWidget, &EqualizerWidget::bandValueChanged, this, &MainWindow::handleBandValueChanged);
+    connect(ui->equalizerWidget, &EqualizerWidget::bandValuesChanged, this, &MainWindow::handleBandValuesChanged);
 
     updateStatusIndicator(ui->presetComboBox->currentText());
 }
 
+void MainWindow::initializeSpectrum()
+{
+    // The engine writes its output into the ring from the audio thread; the
+    // worker drains it and runs the FFT on its own thread, and only the
+    // finished levels reach the GUI thread.
+    m_spectrumWorker = new SpectrumWorker(&m_analysisRing, m_engine.sampleRate(), SpectrumPointCount);
+    m_spectrumWorker->moveToThread(&m_spectrumThread);
+    connect(&m_spectrumThread, &QThread::finished, m_spectrumWorker, &QObject::deleteLater);
+    connect(m_spectrumWorker, &SpectrumWorker::spectrumChanged, ui->equalizerWidget, &EqualizerWidget::setSpectrum);
+
+    m_engine.setAnalysisRing(&m_analysisRing);
+    m_spectrumThread.start(QThread::LowPriority);
+    QMetaObject::invokeMethod(m_spectrumWorker, "start", Qt::QueuedConnection);
+}
+
 void MainWindow::applyPreset(const QString &presetName)
 {
     const QVector<int> values = m_presetManager.presetValues(presetName);
     ui->equalizerWidget->setBandValues(values);
+    m_matchedPreset = m_presetManager.findPreset(values.constData(), values.size());
+    updateClosestPreset(values.constData());
     updateStatusIndicator(presetName);
 }
 
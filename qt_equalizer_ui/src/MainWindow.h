@@ -2,8 +2,15 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QThread>
+#include <QTimer>
 
+#include "EqualizerEngine.h"
 #include "PresetManager.h"
+#include "SampleRing.h"
+
+class QLabel;
+class SpectrumWorker;
 
 namespace Ui {
 class MainWindow;
@@ -17,19 +24,43 @@ public:
     explicit MainWindow(QWidget *parent = nullptr);
     ~MainWindow() override;
 
+    // The engine the controls drive. The window has no audio I/O of its
+    // own: the host calls process() from its audio callback and addXrun()
+    // when the device reports an underrun or overrun, following the
+    // threading rules in EqualizerEngine.h. Until then the readout shows
+    // the DSP as idle and the spectrum stays empty.
+    EqualizerEngine *engine();
+
 private slots:
     void handlePresetChanged(int index);
     void handleResetClicked();
     void handleBypassToggled(bool checked);
-    void handleBandValueChanged(int bandIndex, int value);
+    void handleBandValuesChanged();
+    void updatePerformanceReadout();
 
 private:
     Ui::MainWindow *ui;
     PresetManager m_presetManager;
+    SampleRing m_analysisRing;
+    EqualizerEngine m_engine;
+    QThread m_spectrumThread;
+    SpectrumWorker *m_spectrumWorker;
+    // Preset the bands currently match, -1 for custom settings.
+    int m_matchedPreset;
+    // Nearest preset in band space, shown permanently in the status bar.
+    int m_closestPreset;
+    QLabel *m_closestPresetLabel;
+    // Engine load over the last interval, refreshed from its counters.
+    QLabel *m_performanceLabel;
+    QTimer m_performanceTimer;
+    ProcessingStatistics m_lastStatistics;
 
     void initializeUi();
+    void initializeSpectrum();
     void applyPreset(const QString &presetName);
     void updateStatusIndicator(const QString &presetName);
+    void setMatchedPreset(int index);
+    void updateClosestPreset(const int *values);
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,229 @@
+#include "Oversampler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Even-phase taps of the two half-band filters, first half of each
+    // symmetric branch: Kaiser windowed sinc, 4 * N - 1 taps long, beta 5.8
+    // for N = 12 and 6.0 for N = 4, normalised to unity gain at DC.
+    constexpr int FirstStageHalfLength = 12;
+    constexpr float FirstStageTaps[FirstStageHalfLength] = {
+        -0.00049399461f, 0.0016076669f, -0.0036369758f, 0.0069698492f, -0.012093268f, 0.019651891f,
+        -0.030594726f, 0.046549198f, -0.070873445f, 0.11227097f, -0.20288839f, 0.63353122f
+    };
+
+    constexpr int SecondStageHalfLength = 4;
+    constexpr float SecondStageTaps[SecondStageHalfLength] = {
+        -0.0013513617f, 0.025412505f, -0.12535937f, 0.60129823f
+    };
+
+    // history holds 2 * Half - 1 frames before the block and the block;
+    // each input frame becomes the filtered even output and the delayed odd
+    // one. The lane loops have a constant trip count and vectorise.
+    template <int Lanes, int Half>
+    void interpolate(const float *taps, const float *history, float *output, int frameCount)
+    {
+        for (int frame = 0; frame < frameCount; ++frame) {
+            const float *window = history + frame * Lanes;
+            float sum[Lanes] = {};
+            for (int k = 0; k < Half; ++k) {
+                const float *early = window + k * Lanes;
+                const float *late = window + (2 * Half - 1 - k) * Lanes;
+                for (int lane = 0; lane < Lanes; ++lane) {
+                    sum[lane] += taps[k] * (early[lane] + late[lane]);
+                }
+            }
+
+            float *even = output + 2 * frame * Lanes;
+            float *odd = even + Lanes;
+            const float *delayed = window + Half * Lanes;
+            for (int lane = 0; lane < Lanes; ++lane) {
+                even[lane] = sum[lane];
+                odd[lane] = delayed[lane];
+            }
+        }
+    }
+
+    // history holds 4 * Half - 2 frames before the block and the block, at
+    // twice the output rate.
+    template <int Lanes, int Half>
+    void decimate(const float *taps, const float *history, float *output, int frameCount)
+    {
+        for (int frame = 0; frame < frameCount; ++frame) {
+            const float *window = history + 2 * frame * Lanes;
+            float sum[Lanes] = {};
+            for (int k = 0; k < Half; ++k) {
+                const float *early = window + 2 * k * Lanes;
+                const float *late = window + (4 * Half - 2 - 2 * k) * Lanes;
+                for (int lane = 0; lane < Lanes; ++lane) {
+                    sum[lane] += taps[k] * (early[lane] + late[lane]);
+                }
+            }
+
+            float *out = output + frame * Lanes;
+            const float *centre = window + (2 * Half - 1) * Lanes;
+            for (int lane = 0; lane < Lanes; ++lane) {
+                out[lane] = 0.5f * (sum[lane] + centre[lane]);
+            }
+        }
+    }
+
+    template <int Half>
+    void stageFunctions(int laneCount, void (**interpolateFunction)(const float *, const float *, float *, int),
+                        void (**decimateFunction)(const float *, const float *, float *, int))
+    {
+        switch (laneCount) {
+        case 1:
+            *interpolateFunction = interpolate<1, Half>;
+            *decimateFunction = decimate<1, Half>;
+            break;
+        case 2:
+            *interpolateFunction = interpolate<2, Half>;
+            *decimateFunction = decimate<2, Half>;
+            break;
+        case 4:
+            *interpolateFunction = interpolate<4, Half>;
+            *decimateFunction = decimate<4, Half>;
+            break;
+        case 8:
+            *interpolateFunction = interpolate<8, Half>;
+            *decimateFunction = decimate<8, Half>;
+            break;
+        default:
+            *interpolateFunction = interpolate<16, Half>;
+            *decimateFunction = decimate<16, Half>;
+            break;
+        }
+    }
+
+    bool isSilent(const std::vector<float> &samples, size_t count, float threshold)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            if (std::fabs(samples[i]) > threshold) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+Oversampler::Oversampler(int factor, int laneCount, int maximumFrames)
+    : m_factor(factor >= 4 ? 4 : factor >= 2 ? 2 : 1)
+    , m_laneCount(laneCount <= 1 ? 1 : laneCount <= 2 ? 2 : laneCount <= 4 ? 4 : laneCount <= 8 ? 8 : 16)
+{
+    const int lanes = m_laneCount;
+    int inputFrames = std::max(1, maximumFrames);
+
+    for (int factorLeft = m_factor; factorLeft > 1; factorLeft /= 2) {
+        Stage stage;
+        if (m_stages.empty()) {
+            stage.halfLength = FirstStageHalfLength;
+            stage.taps = FirstStageTaps;
+            stageFunctions<FirstStageHalfLength>(lanes, &stage.interpolate, &stage.decimate);
+        } else {
+            stage.halfLength = SecondStageHalfLength;
+            stage.taps = SecondStageTaps;
+            stageFunctions<SecondStageHalfLength>(lanes, &stage.interpolate, &stage.decimate);
+        }
+
+        stage.upHistory.assign(static_cast<size_t>(2 * stage.halfLength - 1 + inputFrames) * lanes, 0.0f);
+        stage.downHistory.assign(static_cast<size_t>(4 * stage.halfLength - 2 + 2 * inputFrames) * lanes, 0.0f);
+        m_stages.push_back(stage);
+        inputFrames *= 2;
+    }
+
+    if (m_stages.size() > 1) {
+        m_intermediate.resize(static_cast<size_t>(2 * std::max(1, maximumFrames)) * lanes);
+    }
+}
+
+int Oversampler::factor() const
+{
+    return m_factor;
+}
+
+int Oversampler::laneCount() const
+{
+    return m_laneCount;
+}
+
+double Oversampler::latency() const
+{
+    // Each filter delays by half its length, at the higher rate of its
+    // stage, and runs twice.
+    double latency = 0.0;
+    double rate = 1.0;
+    for (const Stage &stage : m_stages) {
+        latency += (2 * stage.halfLength - 1) / rate;
+        rate *= 2.0;
+    }
+    return latency;
+}
+
+void Oversampler::upsample(const float *input, float *output, int frameCount)
+{
+    if (m_stages.empty()) {
+        std::copy(input, input + static_cast<size_t>(frameCount) * m_laneCount, output);
+    } else if (m_stages.size() == 1) {
+        upsampleStage(m_stages[0], input, output, frameCount);
+    } else {
+        upsampleStage(m_stages[0], input, m_intermediate.data(), frameCount);
+        upsampleStage(m_stages[1], m_intermediate.data(), output, 2 * frameCount);
+    }
+}
+
+void Oversampler::downsample(const float *input, float *output, int frameCount)
+{
+    if (m_stages.empty()) {
+        std::copy(input, input + static_cast<size_t>(frameCount) * m_laneCount, output);
+    } else if (m_stages.size() == 1) {
+        downsampleStage(m_stages[0], input, output, frameCount);
+    } else {
+        downsampleStage(m_stages[1], input, m_intermediate.data(), 2 * frameCount);
+        downsampleStage(m_stages[0], m_intermediate.data(), output, frameCount);
+    }
+}
+
+void Oversampler::reset()
+{
+    for (Stage &stage : m_stages) {
+        std::fill(stage.upHistory.begin(), stage.upHistory.end(), 0.0f);
+        std::fill(stage.downHistory.begin(), stage.downHistory.end(), 0.0f);
+    }
+}
+
+bool Oversampler::isSilent(float threshold) const
+{
+    for (const Stage &stage : m_stages) {
+        const size_t upKept = static_cast<size_t>(2 * stage.halfLength - 1) * m_laneCount;
+        const size_t downKept = static_cast<size_t>(4 * stage.halfLength - 2) * m_laneCount;
+        if (!::isSilent(stage.upHistory, upKept, threshold) || !::isSilent(stage.downHistory, downKept, threshold)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Oversampler::upsampleStage(Stage &stage, const float *input, float *output, int frameCount)
+{
+    const size_t lanes = static_cast<size_t>(m_laneCount);
+    const size_t kept = static_cast<size_t>(2 * stage.halfLength - 1) * lanes;
+    float *history = stage.upHistory.data();
+
+    std::copy(input, input + frameCount * lanes, history + kept);
+    stage.interpolate(stage.taps, history, output, frameCount);
+    std::copy(history + frameCount * lanes, history + frameCount * lanes + kept, history);
+}
+
+void Oversampler::downsampleStage(Stage &stage, const float *input, float *output, int frameCount)
+{
+    const size_t lanes = static_cast<size_t>(m_laneCount);
+    const size_t kept = static_cast<size_t>(4 * stage.halfLength - 2) * lanes;
+    float *history = stage.downHistory.data();
+
+    std::copy(input, input + 2 * frameCount * lanes, history + kept);
+    stage.decimate(stage.taps, history, output, frameCount);
+    std::copy(history + 2 * frameCount * lanes, history + 2 * frameCount * lanes + kept, history);
+}
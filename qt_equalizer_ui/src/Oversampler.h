@@ -0,0 +1,74 @@
+#ifndef OVERSAMPLER_H
+#define OVERSAMPLER_H
+
+#include <vector>
+
+// 2x or 4x oversampling for the upper bands of EqualizerEngine, on blocks in
+// the lane-interleaved layout of BiquadKernels.h ([frame][lane]).
+//
+// Each doubling is a linear phase half-band FIR split into its two polyphase
+// branches. Every other tap of a half-band filter is zero and the middle one
+// is 1/2, so one branch is a plain delay and the other a short symmetric
+// filter: upsampling costs one multiply per tap pair and lane per input
+// frame, and so does downsampling. The first doubling is flat to within
+// 0.01 dB up to 84% of the input's Nyquist frequency with 60 dB of stopband;
+// the second only has to separate that band from its image an octave up and
+// makes do with a third of the taps.
+//
+// Images left by upsampling are attenuated once on the way up and again on
+// the way down, so what the upper bands boost in between does not alias
+// back. Above 84% of Nyquist the round trip rolls off, by 2 dB at 92%, and
+// it delays the signal by latency() frames.
+class Oversampler
+{
+public:
+    static const int MaximumFactor = 4;
+
+    // factor is 1, 2 or 4 (others are rounded down to one of those);
+    // laneCount 1, 2, 4, 8 or 16. Blocks may be up to maximumFrames long at
+    // the base rate. Factor 1 copies.
+    Oversampler(int factor, int laneCount, int maximumFrames);
+
+    int factor() const;
+    int laneCount() const;
+
+    // Delay of upsample() followed by downsample(), in frames at the base
+    // rate.
+    double latency() const;
+
+    // frameCount frames of input become frameCount * factor() of output.
+    void upsample(const float *input, float *output, int frameCount);
+    // frameCount * factor() frames of input become frameCount of output.
+    void downsample(const float *input, float *output, int frameCount);
+
+    void reset();
+
+    // True when nothing in the filters' history exceeds threshold.
+    bool isSilent(float threshold) const;
+
+private:
+    typedef void (*StageFunction)(const float *taps, const float *history, float *output, int frameCount);
+
+    // One doubling. The histories hold the frames the filters still need
+    // from earlier blocks, followed by room for a block.
+    struct Stage
+    {
+        int halfLength;
+        const float *taps;
+        StageFunction interpolate;
+        StageFunction decimate;
+        std::vector<float> upHistory;
+        std::vector<float> downHistory;
+    };
+
+    int m_factor;
+    int m_laneCount;
+    std::vector<Stage> m_stages;
+    // Between the two stages of 4x.
+    std::vector<float> m_intermediate;
+
+    void upsampleStage(Stage &stage, const float *input, float *output, int frameCount);
+    void downsampleStage(Stage &stage, const float *input, float *output, int frameCount);
+};
+
+#endif // OVERSAMPLER_H
@@ -0,0 +1,79 @@
+#ifndef PARAMETERCHANNEL_H
+#define PARAMETERCHANNEL_H
+
+#include <atomic>
+#include <cstdint>
+
+// Wait-free single producer / single consumer triple buffer. The producer
+// (UI thread) always has a private buffer to write into and the consumer
+// (audio thread) always sees the most recently published value; neither side
+// ever blocks, retries or allocates. Intermediate values published between
+// two reads are dropped, which is what we want for control parameters.
+template <typename T>
+class ParameterChannel
+{
+public:
+    ParameterChannel()
+        : m_middle(1)
+        , m_back(2)
+        , m_front(0)
+    {
+    }
+
+    ParameterChannel(const ParameterChannel &) = delete;
+    ParameterChannel &operator=(const ParameterChannel &) = delete;
+
+    // Producer side.
+    T &writeBuffer()
+    {
+        return m_buffers[m_back];
+    }
+
+    void publish()
+    {
+        const std::uint8_t previous = m_middle.exchange(static_cast<std::uint8_t>(m_back | DirtyFlag),
+                                                        std::memory_order_acq_rel);
+        m_back = previous & IndexMask;
+    }
+
+    void write(const T &value)
+    {
+        writeBuffer() = value;
+        publish();
+    }
+
+    // Consumer side. Returns true when a new value was picked up; readBuffer()
+    // then refers to it until the next successful consume().
+    bool consume()
+    {
+        if ((m_middle.load(std::memory_order_relaxed) & DirtyFlag) == 0) {
+            return false;
+        }
+
+        const std::uint8_t previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+        m_front = previous & IndexMask;
+        return true;
+    }
+
+    const T &readBuffer() const
+    {
+        return m_buffers[m_front];
+    }
+
+private:
+    static const std::uint8_t IndexMask = 0x3;
+    static const std::uint8_t DirtyFlag = 0x4;
+    static const int CacheLineSize = 64;
+
+    T m_buffers[3];
+
+    // Shared slot, plus one index owned by each side. The padding keeps the
+    // private indices off the shared cache line.
+    std::atomic<std::uint8_t> m_middle;
+    char m_middlePadding[CacheLineSize];
+    std::uint8_t m_back;
+    char m_backPadding[CacheLineSize];
+    std::uint8_t m_front;
+};
+
+#endif // PARAMETERCHANNEL_H
@@ -0,0 +1,362 @@
+#include "PcmToWavConverter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#endif
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+namespace
+{
+    bool writeAll(int fd, const unsigned char *data, size_t size)
+    {
+        while (size > 0) {
+            const ssize_t written = ::write(fd, data, size);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    ssize_t readSome(int fd, unsigned char *data, size_t size)
+    {
+        for (;;) {
+            const ssize_t result = ::read(fd, data, size);
+            if (result >= 0 || errno != EINTR) {
+                return result;
+            }
+        }
+    }
+
+#ifdef __linux__
+    // errno values with which the kernel side copies reject a pair of file
+    // descriptors they cannot handle (pipes, sockets, cross-filesystem copies on
+    // older kernels); anything else is a real I/O error.
+    bool isUnsupportedCopy(int error)
+    {
+        return error == EINVAL || error == EXDEV || error == ENOSYS || error == EBADF
+                || error == ESPIPE || error == EOPNOTSUPP || error == ENOTSUP;
+    }
+
+    // Largest count the Linux copy calls accept in one go.
+    const size_t KernelCopyChunk = 0x7ffff000;
+#endif
+
+    const off_t MapWindowSize = 64 * 1024 * 1024;
+}
+
+PcmToWavConverter::PcmToWavConverter()
+    : m_copyMethod(Automatic)
+    , m_copyMethodUsed(Buffered)
+    , m_dataSize(0)
+    , m_isHeaderPatched(false)
+{
+}
+
+void PcmToWavConverter::setFormat(std::uint32_t sampleRate, std::uint16_t channels, std::uint16_t bitsPerSample)
+{
+    m_header.sampleRate = sampleRate;
+    m_header.channels = channels;
+    m_header.bitsPerSample = bitsPerSample;
+}
+
+const WaveHeader &PcmToWavConverter::header() const
+{
+    return m_header;
+}
+
+void PcmToWavConverter::setCopyMethod(CopyMethod method)
+{
+    m_copyMethod = method;
+}
+
+PcmToWavConverter::CopyMethod PcmToWavConverter::copyMethod() const
+{
+    return m_copyMethod;
+}
+
+PcmToWavConverter::CopyMethod PcmToWavConverter::copyMethodUsed() const
+{
+    return m_copyMethodUsed;
+}
+
+bool PcmToWavConverter::convert(const std::string &sourcePath, const std::string &targetPath)
+{
+    const bool sourceIsStdin = sourcePath == "-";
+    const bool targetIsStdout = targetPath == "-";
+
+    const int sourceFd = sourceIsStdin ? 0 : ::open(sourcePath.c_str(), O_RDONLY | O_BINARY);
+    if (sourceFd < 0) {
+        return setError("Cannot open " + sourcePath);
+    }
+
+    const int targetFd = targetIsStdout ? 1 : ::open(targetPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644);
+    if (targetFd < 0) {
+        setError("Cannot create " + targetPath);
+        if (!sourceIsStdin) {
+            ::close(sourceFd);
+        }
+        return false;
+    }
+
+    bool ok = convert(sourceFd, targetFd);
+
+    if (!sourceIsStdin) {
+        ::close(sourceFd);
+    }
+    if (!targetIsStdout && ::close(targetFd) != 0 && ok) {
+        ok = setError("Cannot close " + targetPath);
+    }
+
+    return ok;
+}
+
+bool PcmToWavConverter::convert(int sourceFd, int targetFd)
+{
+    m_dataSize = 0;
+    m_isHeaderPatched = false;
+    m_errorString.clear();
+
+    // Where the header goes; -1 when the output cannot seek.
+    const off_t headerOffset = ::lseek(targetFd, 0, SEEK_CUR);
+
+    unsigned char header[WaveHeader::Size];
+    m_header.dataLength = WaveHeader::UnknownSize;
+    m_header.write(header);
+    if (!writeAll(targetFd, header, sizeof(header))) {
+        return setError("Cannot write WAV header");
+    }
+
+    if (!copyPayload(sourceFd, targetFd)) {
+        return false;
+    }
+
+    // RIFF chunks are word aligned.
+    if (m_dataSize & 1u) {
+        const unsigned char pad = 0;
+        if (!writeAll(targetFd, &pad, 1)) {
+            return setError("Cannot write WAV padding");
+        }
+    }
+
+    return headerOffset < 0 || patchHeader(targetFd, headerOffset);
+}
+
+std::uint64_t PcmToWavConverter::dataSize() const
+{
+    return m_dataSize;
+}
+
+bool PcmToWavConverter::isHeaderPatched() const
+{
+    return m_isHeaderPatched;
+}
+
+const std::string &PcmToWavConverter::errorString() const
+{
+    return m_errorString;
+}
+
+bool PcmToWavConverter::copyPayload(int sourceFd, int targetFd)
+{
+    // Every method works from the current file offsets, so if one gives up
+    // part way through the next one carries on where it stopped.
+    const struct
+    {
+        CopyMethod method;
+        CopyResult (PcmToWavConverter::*copy)(int, int);
+    } kernelMethods[] = {
+        {CopyFileRange, &PcmToWavConverter::copyFileRange},
+        {SendFile, &PcmToWavConverter::sendFile},
+        {MemoryMap, &PcmToWavConverter::copyMemoryMapped}
+    };
+
+    for (const auto &candidate : kernelMethods) {
+        if (m_copyMethod != Automatic && m_copyMethod != candidate.method) {
+            continue;
+        }
+
+        const CopyResult result = (this->*candidate.copy)(sourceFd, targetFd);
+        if (result == Copied) {
+            m_copyMethodUsed = candidate.method;
+            return true;
+        }
+        if (result == Failed) {
+            return false;
+        }
+    }
+
+    m_copyMethodUsed = Buffered;
+    return copyBuffered(sourceFd, targetFd);
+}
+
+PcmToWavConverter::CopyResult PcmToWavConverter::copyFileRange(int sourceFd, int targetFd)
+{
+#if defined(__linux__) && defined(SYS_copy_file_range)
+    for (;;) {
+        const long copied = ::syscall(SYS_copy_file_range, sourceFd, nullptr, targetFd, nullptr, KernelCopyChunk, 0u);
+        if (copied < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (isUnsupportedCopy(errno)) {
+                return NotSupported;
+            }
+            setError("Cannot copy PCM payload");
+            return Failed;
+        }
+        if (copied == 0) {
+            return Copied;
+        }
+        m_dataSize += static_cast<std::uint64_t>(copied);
+    }
+#else
+    (void)sourceFd;
+    (void)targetFd;
+    return NotSupported;
+#endif
+}
+
+PcmToWavConverter::CopyResult PcmToWavConverter::sendFile(int sourceFd, int targetFd)
+{
+#ifdef __linux__
+    for (;;) {
+        const ssize_t copied = ::sendfile(targetFd, sourceFd, nullptr, KernelCopyChunk);
+        if (copied < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (isUnsupportedCopy(errno)) {
+                return NotSupported;
+            }
+            setError("Cannot copy PCM payload");
+            return Failed;
+        }
+        if (copied == 0) {
+            return Copied;
+        }
+        m_dataSize += static_cast<std::uint64_t>(copied);
+    }
+#else
+    (void)sourceFd;
+    (void)targetFd;
+    return NotSupported;
+#endif
+}
+
+PcmToWavConverter::CopyResult PcmToWavConverter::copyMemoryMapped(int sourceFd, int targetFd)
+{
+#ifndef _WIN32
+    struct stat info;
+    if (::fstat(sourceFd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        return NotSupported;
+    }
+
+    const off_t offset = ::lseek(sourceFd, 0, SEEK_CUR);
+    if (offset < 0 || offset > info.st_size) {
+        return NotSupported;
+    }
+
+    // Map a window at a time so huge inputs fit 32-bit address spaces too.
+    // mmap offsets must be page aligned.
+    const off_t pageSize = static_cast<off_t>(::sysconf(_SC_PAGESIZE));
+    off_t position = offset;
+    while (position < info.st_size) {
+        const off_t mapOffset = position - position % pageSize;
+        const size_t skip = static_cast<size_t>(position - mapOffset);
+        const size_t length = static_cast<size_t>(std::min<off_t>(info.st_size - position, MapWindowSize));
+
+        void *mapping = ::mmap(nullptr, length + skip, PROT_READ, MAP_PRIVATE, sourceFd, mapOffset);
+        if (mapping == MAP_FAILED) {
+            ::lseek(sourceFd, position, SEEK_SET);
+            return NotSupported;
+        }
+        ::madvise(mapping, length + skip, MADV_SEQUENTIAL);
+
+        const bool written = writeAll(targetFd, static_cast<const unsigned char *>(mapping) + skip, length);
+        ::munmap(mapping, length + skip);
+        if (!written) {
+            setError("Cannot write PCM payload");
+            return Failed;
+        }
+
+        m_dataSize += length;
+        position += static_cast<off_t>(length);
+    }
+
+    ::lseek(sourceFd, position, SEEK_SET);
+    return Copied;
+#else
+    (void)sourceFd;
+    (void)targetFd;
+    return NotSupported;
+#endif
+}
+
+bool PcmToWavConverter::copyBuffered(int sourceFd, int targetFd)
+{
+    if (m_buffer.empty()) {
+        m_buffer.resize(BufferSize);
+    }
+
+    for (;;) {
+        const ssize_t size = readSome(sourceFd, m_buffer.data(), m_buffer.size());
+        if (size < 0) {
+            return setError("Cannot read PCM input");
+        }
+        if (size == 0) {
+            return true;
+        }
+        if (!writeAll(targetFd, m_buffer.data(), static_cast<size_t>(size))) {
+            return setError("Cannot write PCM payload");
+        }
+        m_dataSize += static_cast<std::uint64_t>(size);
+    }
+}
+
+bool PcmToWavConverter::patchHeader(int targetFd, off_t headerOffset)
+{
+    if (::lseek(targetFd, headerOffset, SEEK_SET) != headerOffset) {
+        return setError("Cannot seek WAV output");
+    }
+
+    unsigned char header[WaveHeader::Size];
+    m_header.setDataSize(m_dataSize);
+    m_header.write(header);
+    if (!writeAll(targetFd, header, sizeof(header))) {
+        return setError("Cannot patch WAV header");
+    }
+
+    m_isHeaderPatched = true;
+    return ::lseek(targetFd, 0, SEEK_END) >= 0 || setError("Cannot seek WAV output");
+}
+
+bool PcmToWavConverter::setError(const std::string &context)
+{
+    m_errorString = context + ": " + std::strerror(errno);
+    return false;
+}
@@ -0,0 +1,84 @@
+#ifndef PCMTOWAVCONVERTER_H
+#define PCMTOWAVCONVERTER_H
+
+#include "WaveHeader.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+// Wraps raw PCM in a WAV container in a single pass. A placeholder header is
+// written first and the payload streamed behind it; when the output can seek
+// the header is then patched with the real sizes, otherwise it keeps the
+// "unknown length" sizes streaming readers expect. Input may be a pipe, so a
+// file that is still being written (TTS output) can be converted as it grows.
+//
+// The payload is never modified, so for file to file conversions it is moved
+// kernel side where the platform allows (copy_file_range, then sendfile, then
+// an mmap of the source) and only pipes go through a user space buffer.
+class PcmToWavConverter
+{
+public:
+    enum CopyMethod
+    {
+        Automatic,
+        CopyFileRange,
+        SendFile,
+        MemoryMap,
+        Buffered
+    };
+
+    PcmToWavConverter();
+
+    // Automatic tries the methods in the order above. Any other value forces
+    // that method, falling back to Buffered where it does not apply.
+    void setCopyMethod(CopyMethod method);
+    CopyMethod copyMethod() const;
+    // The method that moved (the last part of) the payload in the last
+    // conversion.
+    CopyMethod copyMethodUsed() const;
+
+    // Defaults match MainActivity.startPcmToWav(): 16-bit stereo, 8000 Hz.
+    void setFormat(std::uint32_t sampleRate, std::uint16_t channels, std::uint16_t bitsPerSample);
+    const WaveHeader &header() const;
+
+    // "-" stands for stdin / stdout.
+    bool convert(const std::string &sourcePath, const std::string &targetPath);
+    bool convert(int sourceFd, int targetFd);
+
+    std::uint64_t dataSize() const;
+    // False when the output could not seek and the header kept streaming sizes.
+    bool isHeaderPatched() const;
+
+    const std::string &errorString() const;
+
+private:
+    static const int BufferSize = 256 * 1024;
+
+    enum CopyResult
+    {
+        Copied,
+        NotSupported,
+        Failed
+    };
+
+    WaveHeader m_header;
+    CopyMethod m_copyMethod;
+    CopyMethod m_copyMethodUsed;
+    std::vector<unsigned char> m_buffer;
+    std::uint64_t m_dataSize;
+    bool m_isHeaderPatched;
+    std::string m_errorString;
+
+    bool copyPayload(int sourceFd, int targetFd);
+    CopyResult copyFileRange(int sourceFd, int targetFd);
+    CopyResult sendFile(int sourceFd, int targetFd);
+    CopyResult copyMemoryMapped(int sourceFd, int targetFd);
+    bool copyBuffered(int sourceFd, int targetFd);
+    bool patchHeader(int targetFd, off_t headerOffset);
+    bool setError(const std::string &context);
+};
+
+#endif // PCMTOWAVCONVERTER_H
@@ -0,0 +1,135 @@
+#include "PipelineStages.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Two 24-bit uniforms per sample are drawn from one 64-bit step.
+    const float UniformRange = 16777216.0f;
+
+    float leastSignificantBit(SampleFormat format)
+    {
+        switch (format) {
+        case SampleUInt8:
+            return 1.0f / 128.0f;
+        case SampleInt16:
+            return 1.0f / 32768.0f;
+        case SampleInt24:
+            return 1.0f / 8388608.0f;
+        default:
+            return 0.0f;
+        }
+    }
+}
+
+PeakLimiter::PeakLimiter(double sampleRate, int channels, double ceilingDb, double releaseSeconds)
+    : m_channels(std::max(1, channels))
+    , m_ceilingDb(std::min(0.0, ceilingDb))
+    , m_ceiling(static_cast<float>(std::pow(10.0, m_ceilingDb / 20.0)))
+    , m_release(static_cast<float>(std::exp(-1.0 / (std::max(1e-4, releaseSeconds) * std::max(1.0, sampleRate)))))
+    , m_gain(1.0f)
+    , m_isEnabled(true)
+    , m_limitedFrames(0)
+{
+}
+
+void PeakLimiter::setEnabled(bool enabled)
+{
+    m_isEnabled = enabled;
+}
+
+bool PeakLimiter::isEnabled() const
+{
+    return m_isEnabled;
+}
+
+double PeakLimiter::ceilingDb() const
+{
+    return m_ceilingDb;
+}
+
+void PeakLimiter::reset()
+{
+    m_gain = 1.0f;
+    m_limitedFrames = 0;
+}
+
+void PeakLimiter::process(float *samples, int frameCount)
+{
+    if (!m_isEnabled) {
+        return;
+    }
+
+    const int channels = m_channels;
+    float gain = m_gain;
+    std::int64_t limited = 0;
+
+    for (int frame = 0; frame < frameCount; ++frame, samples += channels) {
+        float peak = 0.0f;
+        for (int channel = 0; channel < channels; ++channel) {
+            peak = std::max(peak, std::fabs(samples[channel]));
+        }
+
+        const float required = peak > m_ceiling ? m_ceiling / peak : 1.0f;
+        gain = required < gain ? required : required - (required - gain) * m_release;
+        if (gain >= 1.0f) {
+            // Released all the way: nothing to scale.
+            gain = 1.0f;
+            continue;
+        }
+
+        for (int channel = 0; channel < channels; ++channel) {
+            samples[channel] *= gain;
+        }
+        ++limited;
+    }
+
+    m_gain = gain;
+    m_limitedFrames += limited;
+}
+
+std::int64_t PeakLimiter::limitedFrames() const
+{
+    return m_limitedFrames;
+}
+
+TpdfDither::TpdfDither(SampleFormat target, int channels, std::uint32_t seed)
+    : m_channels(std::max(1, channels))
+    , m_scale(leastSignificantBit(target) / UniformRange)
+    // Any odd state is a valid xorshift state.
+    , m_state((static_cast<std::uint64_t>(seed) * 0x9E3779B97F4A7C15ull) | 1u)
+    , m_isEnabled(true)
+{
+}
+
+void TpdfDither::setEnabled(bool enabled)
+{
+    m_isEnabled = enabled;
+}
+
+bool TpdfDither::isEnabled() const
+{
+    return m_isEnabled;
+}
+
+void TpdfDither::process(float *samples, int frameCount)
+{
+    if (!m_isEnabled || m_scale == 0.0f) {
+        return;
+    }
+
+    std::uint64_t state = m_state;
+    const int count = frameCount * m_channels;
+    for (int i = 0; i < count; ++i) {
+        // xorshift64*; the difference of two uniforms is triangular.
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        const std::uint64_t random = state * 0x2545F4914F6CDD1Dull;
+        const int first = static_cast<int>(random >> 40);
+        const int second = static_cast<int>((random >> 16) & 0xFFFFFF);
+        samples[i] += static_cast<float>(first - second) * m_scale;
+    }
+    m_state = state;
+}
@@ -0,0 +1,83 @@
+#ifndef PIPELINESTAGES_H
+#define PIPELINESTAGES_H
+
+#include "EqualizerEngine.h"
+#include "WavFormat.h"
+
+#include <cstdint>
+
+// Stages for BlockPipeline. Each works in place on interleaved float blocks
+// and keeps its state across calls, so a stream can be fed in any block size.
+
+// Runs an EqualizerEngine the stage does not own.
+class EqualizerStage
+{
+public:
+    explicit EqualizerStage(EqualizerEngine *engine)
+        : m_engine(engine)
+    {
+    }
+
+    void process(float *samples, int frameCount)
+    {
+        m_engine->process(samples, frameCount);
+    }
+
+private:
+    EqualizerEngine *m_engine;
+};
+
+// Peak limiter that keeps every sample within the ceiling, so a boost does
+// not hard clip in the integer encoder. The gain is shared by all channels of
+// a frame, drops instantly to what the loudest channel needs and recovers
+// with a one pole release. There is no look-ahead, so the attack is not
+// smoothed; it is meant as a safety net for occasional overs, not as a
+// loudness tool.
+class PeakLimiter
+{
+public:
+    PeakLimiter(double sampleRate, int channels, double ceilingDb = -0.3, double releaseSeconds = 0.050);
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+
+    double ceilingDb() const;
+    void reset();
+
+    void process(float *samples, int frameCount);
+
+    // Frames processed with a gain below one since the last reset().
+    std::int64_t limitedFrames() const;
+
+private:
+    int m_channels;
+    double m_ceilingDb;
+    float m_ceiling;
+    float m_release;
+    float m_gain;
+    bool m_isEnabled;
+    std::int64_t m_limitedFrames;
+};
+
+// Triangular (TPDF) dither of +/-1 LSB of the target integer format, added
+// just before the encoder so requantising the filtered signal leaves
+// signal-independent noise instead of distortion. It is a no-op for 32-bit
+// and float targets, whose LSB is below float resolution at full scale.
+class TpdfDither
+{
+public:
+    TpdfDither(SampleFormat target, int channels, std::uint32_t seed = 1);
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+
+    void process(float *samples, int frameCount);
+
+private:
+    int m_channels;
+    float m_scale;
+    std::uint64_t m_state;
+    bool m_isEnabled;
+};
+
+#endif // PIPELINESTAGES_H
@@ -1,20 +1,31 @@
 #include "PresetManager.h"
+#include "EqualizerBands.h"
 
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
 #include <QtGlobal>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 PresetManager::PresetManager()
+    : m_isTreeValid(false)
 {
     m_presets.reserve(9);
 
-    m_presets.append({QStringLiteral("Flat"), makeValues({0, 0, 0, 0, 0, 0, 0, 0, 0, 0})});
-    m_presets.append({QStringLiteral("Rock"), makeValues({-1, 3, 5, 4, 1, -1, -2, -1, 2, 4})});
-    m_presets.append({QStringLiteral("Pop"), makeValues({-1, 2, 4, 5, 3, -1, -2, -1, 1, 2})});
-    m_presets.append({QStringLiteral("Jazz"), makeValues({0, 2, 3, 2, 0, -1, -1, 0, 2, 3})});
-    m_presets.append({QStringLiteral("Classical"), makeValues({0, 1, 2, 3, 4, 3, 2, 1, 0, 0})});
-    m_presets.append({QStringLiteral("Vocal"), makeValues({-2, -1, 2, 4, 5, 4, 2, 1, 0, 1})});
-    m_presets.append({QStringLiteral("Dance"), makeValues({2, 4, 6, 4, 0, -2, -1, 2, 4, 5})});
-    m_presets.append({QStringLiteral("Bass Boost"), makeValues({8, 7, 6, 4, 2, 0, -1, -2, -3, -4})});
-    m_presets.append({QStringLiteral("Treble Boost"), makeValues({-4, -3, -2, -1, 0, 2, 4, 6, 7, 8})});
+    addPreset(QStringLiteral("Flat"), makeValues({0, 0, 0, 0, 0, 0, 0, 0, 0, 0}));
+    addPreset(QStringLiteral("Rock"), makeValues({-1, 3, 5, 4, 1, -1, -2, -1, 2, 4}));
+    addPreset(QStringLiteral("Pop"), makeValues({-1, 2, 4, 5, 3, -1, -2, -1, 1, 2}));
+    addPreset(QStringLiteral("Jazz"), makeValues({0, 2, 3, 2, 0, -1, -1, 0, 2, 3}));
+    addPreset(QStringLiteral("Classical"), makeValues({0, 1, 2, 3, 4, 3, 2, 1, 0, 0}));
+    addPreset(QStringLiteral("Vocal"), makeValues({-2, -1, 2, 4, 5, 4, 2, 1, 0, 1}));
+    addPreset(QStringLiteral("Dance"), makeValues({2, 4, 6, 4, 0, -2, -1, 2, 4, 5}));
+    addPreset(QStringLiteral("Bass Boost"), makeValues({8, 7, 6, 4, 2, 0, -1, -2, -3, -4}));
+    addPreset(QStringLiteral("Treble Boost"), makeValues({-4, -3, -2, -1, 0, 2, 4, 6, 7, 8}));
 }
 
 QStringList PresetManager::presetNames() const
@@ -29,30 +40,254 @@ QStringList PresetManager::presetNames() const
 
 QVector<int> PresetManager::presetValues(const QString &presetName) const
 {
-    for (const Preset &preset : m_presets) {
-        if (preset.name.compare(presetName, Qt::CaseInsensitive) == 0) {
-            return preset.values;
-        }
+    const int index = presetIndex(presetName);
+    if (index >= 0) {
+        return m_presets.at(index).values;
     }
 
     return m_presets.isEmpty() ? QVector<int>(BandCount, 0) : m_presets.first().values;
 }
 
-QVector<int> PresetManager::makeValues(std::initializer_list<int> values) const
+int PresetManager::presetCount() const
 {
-    QVector<int> result;
-    result.reserve(BandCount);
+    return m_presets.size();
+}
 
-    for (int value : values) {
-        if (result.size() == BandCount) {
-            break;
+QString PresetManager::presetName(int index) const
+{
+    if (index < 0 || index >= m_presets.size()) {
+        return QString();
+    }
+
+    return m_presets.at(index).name;
+}
+
+int PresetManager::presetIndex(const QString &presetName) const
+{
+    return m_nameIndex.value(presetName.toCaseFolded(), -1);
+}
+
+int PresetManager::addPreset(const QString &presetName, const QVector<int> &values)
+{
+    QVector<int> gains = values.mid(0, BandCount);
+    gains.resize(BandCount);
+    for (int &gain : gains) {
+        gain = qBound(EqualizerBands::MinimumGain, gain, EqualizerBands::MaximumGain);
+    }
+
+    const QString key = presetName.toCaseFolded();
+    int index = m_nameIndex.value(key, -1);
+    if (index >= 0) {
+        Preset &preset = m_presets[index];
+        m_valueIndex.remove(hashValues(preset.values.constData()), index);
+        preset.values = gains;
+    } else {
+        index = m_presets.size();
+        m_presets.append({presetName, gains});
+        m_nameIndex.insert(key, index);
+    }
+
+    m_valueIndex.insert(hashValues(gains.constData()), index);
+    m_isTreeValid = false;
+    return index;
+}
+
+bool PresetManager::loadPresets(const QString &filePath)
+{
+    m_errorString.clear();
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        m_errorString = file.errorString();
+        return false;
+    }
+
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (document.isNull()) {
+        m_errorString = parseError.errorString();
+        return false;
+    }
+    if (!document.isArray()) {
+        m_errorString = QStringLiteral("Expected an array of presets");
+        return false;
+    }
+
+    const QJsonArray entries = document.array();
+    QVector<Preset> loaded;
+    loaded.reserve(entries.size());
+    for (int i = 0; i < entries.size(); ++i) {
+        const QJsonObject entry = entries.at(i).toObject();
+        const QString name = entry.value(QStringLiteral("name")).toString();
+        const QJsonArray gains = entry.value(QStringLiteral("gains")).toArray();
+        const bool isLayout = EqualizerBands::frequenciesFor(gains.size()) != nullptr;
+        if (name.isEmpty() || gains.isEmpty() || (gains.size() > BandCount && !isLayout)) {
+            m_errorString = QStringLiteral("Preset %1 needs a name and 1 to %2 gains, or gains for a 5, 10, 15 "
+                                           "or 31 band layout").arg(i).arg(BandCount);
+            return false;
+        }
+
+        Preset preset;
+        preset.name = name;
+        for (const QJsonValue &gain : gains) {
+            if (!gain.isDouble()) {
+                m_errorString = QStringLiteral("Preset \"%1\" has a gain that is not a number").arg(name);
+                return false;
+            }
+            preset.values.append(qRound(gain.toDouble()));
         }
-        result.append(value);
+        if (isLayout && gains.size() != BandCount) {
+            QVector<int> resampled(BandCount);
+            EqualizerBands::resample(preset.values.constData(), preset.values.size(), resampled.data());
+            preset.values = resampled;
+        }
+        loaded.append(preset);
+    }
+
+    m_presets.reserve(m_presets.size() + loaded.size());
+    for (const Preset &preset : loaded) {
+        addPreset(preset.name, preset.values);
+    }
+    return true;
+}
+
+QString PresetManager::errorString() const
+{
+    return m_errorString;
+}
+
+int PresetManager::findPreset(const int *values, int count) const
+{
+    if (!values || count != BandCount) {
+        return -1;
     }
 
-    while (result.size() < BandCount) {
-        result.append(0);
+    // Several presets may share gains; report the first one.
+    int found = -1;
+    const uint key = hashValues(values);
+    for (auto it = m_valueIndex.constFind(key); it != m_valueIndex.constEnd() && it.key() == key; ++it) {
+        const QVector<int> &presetValues = m_presets.at(it.value()).values;
+        if ((found < 0 || it.value() < found) && std::equal(presetValues.constBegin(), presetValues.constEnd(), values)) {
+            found = it.value();
+        }
     }
 
+    return found;
+}
+
+int PresetManager::nearestPreset(const int *values, int count, double *distance) const
+{
+    if (!values || count != BandCount || m_presets.isEmpty()) {
+        return -1;
+    }
+
+    if (!m_isTreeValid) {
+        m_tree.resize(static_cast<size_t>(m_presets.size()));
+        for (int i = 0; i < m_presets.size(); ++i) {
+            m_tree[static_cast<size_t>(i)] = i;
+        }
+        buildTree(0, m_presets.size(), 0);
+
+        m_treeGains.resize(m_tree.size() * BandCount);
+        for (size_t i = 0; i < m_tree.size(); ++i) {
+            const QVector<int> &presetValues = m_presets.at(m_tree[i]).values;
+            std::copy(presetValues.constBegin(), presetValues.constEnd(), m_treeGains.begin() + i * BandCount);
+        }
+        m_isTreeValid = true;
+    }
+
+    int best = -1;
+    int bestDistance = std::numeric_limits<int>::max();
+    int offsets[BandCount] = {};
+    searchTree(0, m_presets.size(), 0, values, offsets, 0, &best, &bestDistance);
+
+    if (distance) {
+        *distance = std::sqrt(static_cast<double>(bestDistance));
+    }
+    return best;
+}
+
+QVector<int> PresetManager::makeValues(std::initializer_list<int> values) const
+{
+    // The built-in presets are written for the ten band layout.
+    const int layoutCount = EqualizerBands::Layout<10>::Count;
+    int gains[layoutCount] = {};
+    std::copy(values.begin(), values.begin() + std::min<int>(layoutCount, static_cast<int>(values.size())), gains);
+
+    QVector<int> result(BandCount);
+    EqualizerBands::resample(gains, layoutCount, result.data());
     return result;
 }
+
+uint PresetManager::hashValues(const int *values)
+{
+    return qHashRange(values, values + BandCount);
+}
+
+void PresetManager::buildTree(int begin, int end, int depth) const
+{
+    if (end - begin <= 1) {
+        return;
+    }
+
+    const int middle = begin + (end - begin) / 2;
+    const int axis = depth % BandCount;
+    std::nth_element(m_tree.begin() + begin, m_tree.begin() + middle, m_tree.begin() + end,
+                     [this, axis](int left, int right) {
+        return m_presets.at(left).values.at(axis) < m_presets.at(right).values.at(axis);
+    });
+
+    buildTree(begin, middle, depth + 1);
+    buildTree(middle + 1, end, depth + 1);
+}
+
+void PresetManager::searchTree(int begin, int end, int depth, const int *values, int *offsets, int cellDistance,
+                               int *best, int *bestDistance) const
+{
+    if (begin >= end) {
+        return;
+    }
+
+    const int middle = begin + (end - begin) / 2;
+    const int *gains = m_treeGains.data() + static_cast<size_t>(middle) * BandCount;
+
+    int distance = 0;
+    for (int band = 0; band < BandCount; ++band) {
+        const int difference = values[band] - gains[band];
+        distance += difference * difference;
+    }
+
+    const int index = m_tree[static_cast<size_t>(middle)];
+    if (distance < *bestDistance || (distance == *bestDistance && index < *best)) {
+        *best = index;
+        *bestDistance = distance;
+    }
+
+    // Descend on the query's side of the split first. The far side is
+    // visited only if its cell can hold something at least as close:
+    // offsets[] holds the query's per-axis distance to the current cell, so
+    // cellDistance is a lower bound over all the splits so far, not just
+    // this one, which is what keeps the search tight with many bands.
+    const int axis = depth % BandCount;
+    const int offset = values[axis] - gains[axis];
+    const bool isLeft = offset < 0;
+    if (isLeft) {
+        searchTree(begin, middle, depth + 1, values, offsets, cellDistance, best, bestDistance);
+    } else {
+        searchTree(middle + 1, end, depth + 1, values, offsets, cellDistance, best, bestDistance);
+    }
+
+    const int previous = offsets[axis];
+    const int farDistance = cellDistance - previous * previous + offset * offset;
+    if (farDistance > *bestDistance) {
+        return;
+    }
+
+    offsets[axis] = offset;
+    if (isLeft) {
+        searchTree(middle + 1, end, depth + 1, values, offsets, farDistance, best, bestDistance);
+    } else {
+        searchTree(begin, middle, depth + 1, values, offsets, farDistance, best, bestDistance);
+    }
+    offsets[axis] = previous;
+}
@@ -1,22 +1,62 @@
 #ifndef PRESETMANAGER_H
 #define PRESETMANAGER_H
 
+#include <QHash>
+#include <QMultiHash>
 #include <QString>
 #include <QStringList>
 #include <QVector>
 
+#include "EqualizerBands.h"
+
 #include <initializer_list>
+#include <vector>
 
+// Preset store sized for large user and vendor libraries. Names are looked
+// up through a case-insensitive hash index, exact gain matches through a
+// hash of the gain vector, and the closest preset through a k-d tree over
+// band space, so none of the lookups the UI makes per frame scan the
+// library.
 class PresetManager
 {
 public:
-    static const int BandCount = 10;
+    static const int BandCount = EqualizerBands::Count;
 
     PresetManager();
 
     QStringList presetNames() const;
     QVector<int> presetValues(const QString &presetName) const;
 
+    // Index-based access in presetNames() order; neither allocates.
+    int presetCount() const;
+    QString presetName(int index) const;
+
+    // Case-insensitive. -1 if there is no such preset.
+    int presetIndex(const QString &presetName) const;
+
+    // Adds a preset, or replaces the gains of the one with the same name.
+    // Missing gains are zero and all are clamped to the slider range.
+    // Returns the preset's index.
+    int addPreset(const QString &presetName, const QVector<int> &values);
+
+    // Adds the presets in a JSON file holding an array of objects of the
+    // form {"name": "Rock", "gains": [-1, 3, 5, 4, 1, -1, -2, -1, 2, 4]}.
+    // Gains written for another band layout (5, 10, 15 or 31 entries) are
+    // resampled onto this build's; shorter lists are padded with zeros.
+    // Nothing is added if any entry is invalid.
+    bool loadPresets(const QString &filePath);
+    QString errorString() const;
+
+    // Index of the first preset whose gains equal values, or -1. Does not
+    // allocate, so it can run on every band change.
+    int findPreset(const int *values, int count) const;
+
+    // Index of the preset at the smallest Euclidean distance from values in
+    // band space, the lowest index on ties, or -1 if there are no presets.
+    // The tree is rebuilt on the first call after presets change; after that
+    // a lookup visits O(log n) presets for typical libraries.
+    int nearestPreset(const int *values, int count, double *distance = nullptr) const;
+
 private:
     struct Preset
     {
@@ -25,8 +65,24 @@ private:
     };
 
     QVector<Preset> m_presets;
+    // Case-folded name to index.
+    QHash<QString, int> m_nameIndex;
+    // Hash of the gains to the indices of the presets that have them.
+    QMultiHash<uint, int> m_valueIndex;
+    QString m_errorString;
+
+    // k-d tree stored as preset indices: the root of every range is its
+    // middle element and the split axis is the depth modulo BandCount.
+    // m_treeGains holds the gains in the same order, for locality.
+    mutable std::vector<int> m_tree;
+    mutable std::vector<int> m_treeGains;
+    mutable bool m_isTreeValid;
 
     QVector<int> makeValues(std::initializer_list<int> values) const;
+    static uint hashValues(const int *values);
+    void buildTree(int begin, int end, int depth) const;
+    void searchTree(int begin, int end, int depth, const int *values, int *offsets, int cellDistance,
+                    int *best, int *bestDistance) const;
 };
 
 #endif // PRESETMANAGER_H
@@ -0,0 +1,201 @@
+#include "ProcessingCounters.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+    // Single writer, so a load and a store do instead of a locked add.
+    void add(std::atomic<std::int64_t> &counter, std::int64_t value)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    int histogramBin(std::int64_t elapsedNs)
+    {
+        std::int64_t microseconds = elapsedNs / 1000;
+        int bin = 0;
+        while (microseconds > 0 && bin < ProcessingStatistics::HistogramBins - 1) {
+            microseconds >>= 1;
+            ++bin;
+        }
+        return bin;
+    }
+
+    std::int64_t binUpperBoundNs(int bin)
+    {
+        return (std::int64_t(1) << bin) * 1000;
+    }
+
+    std::string format(const char *pattern, double value)
+    {
+        char text[64];
+        std::snprintf(text, sizeof(text), pattern, value);
+        return text;
+    }
+}
+
+ProcessingStatistics::ProcessingStatistics()
+    : calls(0)
+    , frames(0)
+    , busyNs(0)
+    , audioNs(0)
+    , maximumNs(0)
+    , overruns(0)
+    , xruns(0)
+    , blocks(0)
+    , silentBlocks(0)
+{
+    std::fill(histogram, histogram + HistogramBins, 0);
+}
+
+double ProcessingStatistics::load() const
+{
+    return audioNs > 0 ? 100.0 * busyNs / audioNs : 0.0;
+}
+
+std::int64_t ProcessingStatistics::percentileNs(double fraction) const
+{
+    if (calls <= 0) {
+        return 0;
+    }
+
+    const double wanted = std::max(0.0, std::min(fraction, 1.0)) * calls;
+    std::int64_t counted = 0;
+    for (int bin = 0; bin < HistogramBins - 1; ++bin) {
+        counted += histogram[bin];
+        if (counted >= wanted) {
+            return binUpperBoundNs(bin);
+        }
+    }
+    return std::max(maximumNs, binUpperBoundNs(HistogramBins - 2));
+}
+
+ProcessingStatistics ProcessingStatistics::since(const ProcessingStatistics &earlier) const
+{
+    ProcessingStatistics difference;
+    difference.calls = calls - earlier.calls;
+    difference.frames = frames - earlier.frames;
+    difference.busyNs = busyNs - earlier.busyNs;
+    difference.audioNs = audioNs - earlier.audioNs;
+    difference.maximumNs = maximumNs;
+    difference.overruns = overruns - earlier.overruns;
+    difference.xruns = xruns - earlier.xruns;
+    difference.blocks = blocks - earlier.blocks;
+    difference.silentBlocks = silentBlocks - earlier.silentBlocks;
+    for (int bin = 0; bin < HistogramBins; ++bin) {
+        difference.histogram[bin] = histogram[bin] - earlier.histogram[bin];
+    }
+    return difference;
+}
+
+std::string ProcessingStatistics::toString() const
+{
+    std::string text;
+    text += "calls " + std::to_string(calls) + ", frames " + std::to_string(frames)
+            + format(" (%.2f s of audio)\n", audioNs / 1e9);
+    text += format("load %.2f%% of real time", load())
+            + format(", longest call %.1f us\n", maximumNs / 1e3);
+    text += "overruns " + std::to_string(overruns) + ", xruns " + std::to_string(xruns) + "\n";
+    text += "blocks " + std::to_string(blocks) + ", silent " + std::to_string(silentBlocks) + "\n";
+    for (int bin = 0; bin < HistogramBins; ++bin) {
+        if (histogram[bin] == 0) {
+            continue;
+        }
+        if (bin == 0) {
+            text += "  < 1 us";
+        } else if (bin == HistogramBins - 1) {
+            text += "  >= " + std::to_string(binUpperBoundNs(bin - 1) / 1000) + " us";
+        } else {
+            text += "  " + std::to_string(binUpperBoundNs(bin - 1) / 1000) + "-"
+                    + std::to_string(binUpperBoundNs(bin) / 1000) + " us";
+        }
+        text += ": " + std::to_string(histogram[bin]) + "\n";
+    }
+    return text;
+}
+
+ProcessingCounters::Timer::Timer(ProcessingCounters *counters, int frameCount)
+    : m_counters(counters)
+    , m_frameCount(frameCount)
+    , m_start(std::chrono::steady_clock::now())
+{
+}
+
+ProcessingCounters::Timer::~Timer()
+{
+    if (m_frameCount > 0) {
+        const auto elapsed = std::chrono::steady_clock::now() - m_start;
+        m_counters->addCall(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), m_frameCount);
+    }
+}
+
+ProcessingCounters::ProcessingCounters(double sampleRate)
+    : m_nanosecondsPerFrame(1e9 / (sampleRate > 0.0 ? sampleRate : 48000.0))
+    , m_calls(0)
+    , m_frames(0)
+    , m_busyNs(0)
+    , m_maximumNs(0)
+    , m_overruns(0)
+    , m_xruns(0)
+    , m_blocks(0)
+    , m_silentBlocks(0)
+{
+    for (std::atomic<std::int64_t> &count : m_histogram) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+void ProcessingCounters::addCall(std::int64_t elapsedNs, int frameCount)
+{
+    add(m_calls, 1);
+    add(m_frames, frameCount);
+    add(m_busyNs, elapsedNs);
+    add(m_histogram[histogramBin(elapsedNs)], 1);
+    if (elapsedNs > m_maximumNs.load(std::memory_order_relaxed)) {
+        m_maximumNs.store(elapsedNs, std::memory_order_relaxed);
+    }
+    if (elapsedNs > frameCount * m_nanosecondsPerFrame) {
+        add(m_overruns, 1);
+    }
+}
+
+void ProcessingCounters::addBlocks(std::int64_t blocks, std::int64_t silentBlocks)
+{
+    add(m_blocks, blocks);
+    add(m_silentBlocks, silentBlocks);
+}
+
+void ProcessingCounters::addXrun()
+{
+    m_xruns.fetch_add(1, std::memory_order_relaxed);
+}
+
+ProcessingStatistics ProcessingCounters::statistics() const
+{
+    ProcessingStatistics statistics;
+    statistics.calls = m_calls.load(std::memory_order_relaxed);
+    statistics.frames = m_frames.load(std::memory_order_relaxed);
+    statistics.busyNs = m_busyNs.load(std::memory_order_relaxed);
+    statistics.audioNs = std::llround(statistics.frames * m_nanosecondsPerFrame);
+    statistics.maximumNs = m_maximumNs.load(std::memory_order_relaxed);
+    statistics.overruns = m_overruns.load(std::memory_order_relaxed);
+    statistics.xruns = m_xruns.load(std::memory_order_relaxed);
+    statistics.blocks = m_blocks.load(std::memory_order_relaxed);
+    statistics.silentBlocks = m_silentBlocks.load(std::memory_order_relaxed);
+    for (int bin = 0; bin < ProcessingStatistics::HistogramBins; ++bin) {
+        statistics.histogram[bin] = m_histogram[bin].load(std::memory_order_relaxed);
+    }
+    return statistics;
+}
+
+std::int64_t ProcessingCounters::blockCount() const
+{
+    return m_blocks.load(std::memory_order_relaxed);
+}
+
+std::int64_t ProcessingCounters::silentBlockCount() const
+{
+    return m_silentBlocks.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,98 @@
+#ifndef PROCESSINGCOUNTERS_H
+#define PROCESSINGCOUNTERS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Totals since the counters were created, as read by
+// ProcessingCounters::statistics().
+struct ProcessingStatistics
+{
+    // Bin 0 counts calls under 1 us, bin k calls of [2^(k-1), 2^k) us and
+    // the last bin everything longer.
+    static const int HistogramBins = 16;
+
+    std::int64_t calls;
+    std::int64_t frames;
+    // Time spent in the calls, and the duration of the audio they carried.
+    std::int64_t busyNs;
+    std::int64_t audioNs;
+    // Longest single call; since() keeps the later value.
+    std::int64_t maximumNs;
+    // Calls that took longer than the audio they carried.
+    std::int64_t overruns;
+    // Underruns and overruns the audio host reported.
+    std::int64_t xruns;
+    // Blocks of up to 256 frames, and those skipped as silent.
+    std::int64_t blocks;
+    std::int64_t silentBlocks;
+    std::int64_t histogram[HistogramBins];
+
+    ProcessingStatistics();
+
+    // Time spent as a percentage of the real-time budget.
+    double load() const;
+    // Upper bound of the histogram bin the given fraction of calls falls
+    // within, in nanoseconds; 0 without calls.
+    std::int64_t percentileNs(double fraction) const;
+
+    // What happened between earlier and this.
+    ProcessingStatistics since(const ProcessingStatistics &earlier) const;
+
+    // Several lines of text for logs and bug reports.
+    std::string toString() const;
+};
+
+// Cost of an engine's process() calls. Each engine is driven by one audio
+// thread at a time, which is the only writer, so the counters are plain
+// atomics updated with a load and a store rather than a locked add. Any
+// thread can read them without locking; each value is exact, but two
+// values may be a call apart.
+class ProcessingCounters
+{
+public:
+    // Times one call from construction to destruction.
+    class Timer
+    {
+    public:
+        Timer(ProcessingCounters *counters, int frameCount);
+        ~Timer();
+
+        Timer(const Timer &) = delete;
+        Timer &operator=(const Timer &) = delete;
+
+    private:
+        ProcessingCounters *m_counters;
+        int m_frameCount;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    explicit ProcessingCounters(double sampleRate);
+
+    // Writer side.
+    void addCall(std::int64_t elapsedNs, int frameCount);
+    void addBlocks(std::int64_t blocks, std::int64_t silentBlocks);
+    // From any thread.
+    void addXrun();
+
+    ProcessingStatistics statistics() const;
+    std::int64_t blockCount() const;
+    std::int64_t silentBlockCount() const;
+
+private:
+    double m_nanosecondsPerFrame;
+
+    std::atomic<std::int64_t> m_calls;
+    std::atomic<std::int64_t> m_frames;
+    std::atomic<std::int64_t> m_busyNs;
+    std::atomic<std::int64_t> m_maximumNs;
+    std::atomic<std::int64_t> m_overruns;
+    std::atomic<std::int64_t> m_xruns;
+    std::atomic<std::int64_t> m_blocks;
+    std::atomic<std::int64_t> m_silentBlocks;
+    std::atomic<std::int64_t> m_histogram[ProcessingStatistics::HistogramBins];
+};
+
+#endif // PROCESSINGCOUNTERS_H
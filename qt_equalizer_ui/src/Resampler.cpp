@@ -0,0 +1,404 @@
+#include "Resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define EQUALIZER_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(EQUALIZER_X86) && (defined(__GNUC__) || defined(__clang__))
+#define EQUALIZER_TARGET(isa) __attribute__((target(isa)))
+#else
+#define EQUALIZER_TARGET(isa)
+#endif
+
+struct Resampler::FilterBank
+{
+    int taps;
+    // Phase p's taps at [p * taps, (p + 1) * taps), in the order of the
+    // input history they multiply (oldest first).
+    std::vector<float> coefficients;
+};
+
+namespace
+{
+    constexpr double Pi = 3.14159265358979323846;
+
+    constexpr int SupportedRates[] = {8000, 16000, 22050, 44100, 48000};
+
+    // Taps per phase at the lower of the two rates; decimation scales them
+    // up by M / L. Rounded up to a multiple of TapAlignment so the dot
+    // products need no tail loop.
+    constexpr int LowRateTaps = 64;
+    constexpr int TapAlignment = 32;
+    constexpr double StopbandDb = 80.0;
+
+    bool isSupportedRate(int rate)
+    {
+        return std::find(std::begin(SupportedRates), std::end(SupportedRates), rate) != std::end(SupportedRates);
+    }
+
+    int greatestCommonDivisor(int a, int b)
+    {
+        while (b != 0) {
+            const int remainder = a % b;
+            a = b;
+            b = remainder;
+        }
+        return a;
+    }
+
+    int tapsFor(int interpolation, int decimation)
+    {
+        const int taps = (LowRateTaps * std::max(interpolation, decimation) + interpolation - 1) / interpolation;
+        return (taps + TapAlignment - 1) / TapAlignment * TapAlignment;
+    }
+
+    double besselI0(double x)
+    {
+        double sum = 1.0;
+        double term = 1.0;
+        const double quarterSquare = x * x / 4.0;
+        for (int k = 1; k < 64 && term > sum * 1e-17; ++k) {
+            term *= quarterSquare / (static_cast<double>(k) * k);
+            sum += term;
+        }
+        return sum;
+    }
+
+    // Kaiser windowed sinc at the interpolated rate L * fin, taps * L long
+    // and centred on taps * L / 2, split into its L phases. Each phase is
+    // normalised to unity gain at DC so the phases do not imprint a ripple
+    // at the input rate on the output.
+    std::vector<float> designFilterBank(int interpolation, int decimation, int taps)
+    {
+        const int length = taps * interpolation;
+
+        // Kaiser's estimates for the window shape and the transition width
+        // a window this long gets, in cycles per sample at the interpolated
+        // rate. The stopband starts at the lower rate's Nyquist frequency.
+        const double beta = 0.1102 * (StopbandDb - 8.7);
+        const double transition = (StopbandDb - 7.95) / (2.285 * 2.0 * Pi * length);
+        const double cutoff = 0.5 / std::max(interpolation, decimation) - 0.5 * transition;
+
+        const double centre = 0.5 * length;
+        const double windowNormal = besselI0(beta);
+
+        std::vector<double> prototype(static_cast<size_t>(length));
+        for (int i = 0; i < length; ++i) {
+            const double offset = i - centre;
+            const double argument = 2.0 * cutoff * offset;
+            const double sinc = argument == 0.0 ? 1.0 : std::sin(Pi * argument) / (Pi * argument);
+            const double position = offset / centre;
+            const double window = besselI0(beta * std::sqrt(std::max(0.0, 1.0 - position * position))) / windowNormal;
+            prototype[static_cast<size_t>(i)] = 2.0 * cutoff * sinc * window;
+        }
+
+        std::vector<float> bank(static_cast<size_t>(length));
+        for (int phase = 0; phase < interpolation; ++phase) {
+            double sum = 0.0;
+            for (int j = 0; j < taps; ++j) {
+                sum += prototype[static_cast<size_t>(phase + j * interpolation)];
+            }
+
+            // Tap j weights the input j frames before the newest in the
+            // window, so it goes at the far end of the row.
+            float *row = bank.data() + static_cast<size_t>(phase) * taps;
+            for (int j = 0; j < taps; ++j) {
+                row[taps - 1 - j] = static_cast<float>(prototype[static_cast<size_t>(phase + j * interpolation)] / sum);
+            }
+        }
+
+        return bank;
+    }
+
+    float dotScalar(const float *coefficients, const float *samples, int count)
+    {
+        float sums[4] = {};
+        for (int i = 0; i < count; i += 4) {
+            for (int lane = 0; lane < 4; ++lane) {
+                sums[lane] += coefficients[i + lane] * samples[i + lane];
+            }
+        }
+        return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+    }
+
+#ifdef EQUALIZER_X86
+    EQUALIZER_TARGET("sse2")
+    float horizontalSum(__m128 sum)
+    {
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55));
+        return _mm_cvtss_f32(sum);
+    }
+
+    // Two accumulators each, so consecutive multiply-adds do not wait on
+    // one another.
+
+    EQUALIZER_TARGET("sse2")
+    float dotSse2(const float *coefficients, const float *samples, int count)
+    {
+        __m128 sum0 = _mm_setzero_ps();
+        __m128 sum1 = _mm_setzero_ps();
+        for (int i = 0; i < count; i += 8) {
+            sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(coefficients + i), _mm_loadu_ps(samples + i)));
+            sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(coefficients + i + 4), _mm_loadu_ps(samples + i + 4)));
+        }
+        return horizontalSum(_mm_add_ps(sum0, sum1));
+    }
+
+    EQUALIZER_TARGET("avx2,fma")
+    float dotAvx2(const float *coefficients, const float *samples, int count)
+    {
+        __m256 sum0 = _mm256_setzero_ps();
+        __m256 sum1 = _mm256_setzero_ps();
+        for (int i = 0; i < count; i += 16) {
+            sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(coefficients + i), _mm256_loadu_ps(samples + i), sum0);
+            sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(coefficients + i + 8), _mm256_loadu_ps(samples + i + 8), sum1);
+        }
+        const __m256 sum = _mm256_add_ps(sum0, sum1);
+        return horizontalSum(_mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1)));
+    }
+
+    EQUALIZER_TARGET("avx512f")
+    float dotAvx512(const float *coefficients, const float *samples, int count)
+    {
+        __m512 sum0 = _mm512_setzero_ps();
+        __m512 sum1 = _mm512_setzero_ps();
+        for (int i = 0; i < count; i += 32) {
+            sum0 = _mm512_fmadd_ps(_mm512_loadu_ps(coefficients + i), _mm512_loadu_ps(samples + i), sum0);
+            sum1 = _mm512_fmadd_ps(_mm512_loadu_ps(coefficients + i + 16), _mm512_loadu_ps(samples + i + 16), sum1);
+        }
+        // Through memory: GCC's _mm512_reduce_add_ps trips -Wuninitialized.
+        float lanes[16];
+        _mm512_storeu_ps(lanes, _mm512_add_ps(sum0, sum1));
+        const __m128 low = _mm_add_ps(_mm_loadu_ps(lanes), _mm_loadu_ps(lanes + 4));
+        const __m128 high = _mm_add_ps(_mm_loadu_ps(lanes + 8), _mm_loadu_ps(lanes + 12));
+        return horizontalSum(_mm_add_ps(low, high));
+    }
+#endif
+}
+
+Resampler::Resampler(int inputRate, int outputRate, int channels)
+    : Resampler(inputRate, outputRate, channels, BiquadKernels::hostIsa())
+{
+}
+
+Resampler::Resampler(int inputRate, int outputRate, int channels, BiquadKernels::Isa maximumIsa)
+    : m_inputRate(inputRate)
+    , m_outputRate(outputRate)
+    , m_channelCount(std::max(1, channels))
+    , m_interpolation(1)
+    , m_decimation(1)
+    , m_taps(0)
+    , m_isa(BiquadKernels::Scalar)
+    , m_dot(dotScalar)
+    , m_historyFrames(0)
+    , m_bufferedFrames(0)
+    , m_base(0)
+    , m_phase(0)
+    , m_inputFrames(0)
+    , m_outputFrames(0)
+    , m_isFlushing(false)
+{
+    if (!isSupported(inputRate, outputRate) || inputRate == outputRate) {
+        return;
+    }
+
+    const int divisor = greatestCommonDivisor(inputRate, outputRate);
+    m_interpolation = outputRate / divisor;
+    m_decimation = inputRate / divisor;
+    m_bank = filterBank(m_interpolation, m_decimation);
+    m_taps = m_bank->taps;
+
+#ifdef EQUALIZER_X86
+    if (maximumIsa >= BiquadKernels::Avx512 && BiquadKernels::isSupported(BiquadKernels::Avx512)) {
+        m_isa = BiquadKernels::Avx512;
+        m_dot = dotAvx512;
+    } else if (maximumIsa >= BiquadKernels::Avx2 && BiquadKernels::isSupported(BiquadKernels::Avx2)) {
+        m_isa = BiquadKernels::Avx2;
+        m_dot = dotAvx2;
+    } else if (maximumIsa >= BiquadKernels::Sse2 && BiquadKernels::isSupported(BiquadKernels::Sse2)) {
+        m_isa = BiquadKernels::Sse2;
+        m_dot = dotSse2;
+    }
+#else
+    (void)maximumIsa;
+#endif
+
+    reset();
+}
+
+bool Resampler::isSupported(int inputRate, int outputRate)
+{
+    return isSupportedRate(inputRate) && isSupportedRate(outputRate);
+}
+
+int Resampler::inputRate() const
+{
+    return m_inputRate;
+}
+
+int Resampler::outputRate() const
+{
+    return m_outputRate;
+}
+
+int Resampler::channelCount() const
+{
+    return m_channelCount;
+}
+
+bool Resampler::isActive() const
+{
+    return m_bank != nullptr;
+}
+
+BiquadKernels::Isa Resampler::isa() const
+{
+    return m_isa;
+}
+
+int Resampler::process(float *samples, int frameCount)
+{
+    if (!isActive()) {
+        return frameCount;
+    }
+    if (frameCount <= 0) {
+        return 0;
+    }
+
+    // The whole block goes into the history first: when interpolating, the
+    // output overwrites input that has not been read yet.
+    append(samples, frameCount);
+    m_inputFrames += frameCount;
+    return produce(samples, std::numeric_limits<std::int64_t>::max());
+}
+
+int Resampler::flush(float *samples, int maximumFrames)
+{
+    if (!isActive()) {
+        return 0;
+    }
+
+    if (!m_isFlushing) {
+        // The last output needs half a window of input past the end.
+        append(nullptr, m_taps / 2);
+        m_isFlushing = true;
+    }
+
+    const std::int64_t total = (m_inputFrames * m_interpolation + m_decimation - 1) / m_decimation;
+    return produce(samples, std::min(total, m_outputFrames + std::max(0, maximumFrames)));
+}
+
+int Resampler::maximumOutputFrames(int frameCount) const
+{
+    if (!isActive()) {
+        return frameCount;
+    }
+
+    // Outputs are M / L input frames apart, and one more may fall due
+    // because the block completes the window of an earlier one.
+    const std::int64_t frames = std::max(0, frameCount);
+    return static_cast<int>((frames * m_interpolation + m_decimation - 1) / m_decimation + 1);
+}
+
+void Resampler::reset()
+{
+    if (!isActive()) {
+        return;
+    }
+
+    // Silence before the stream, so output 0 is centred on input 0.
+    m_bufferedFrames = 0;
+    m_base = 0;
+    m_phase = 0;
+    m_inputFrames = 0;
+    m_outputFrames = 0;
+    m_isFlushing = false;
+    append(nullptr, m_taps / 2 - 1);
+}
+
+std::shared_ptr<const Resampler::FilterBank> Resampler::filterBank(int interpolation, int decimation)
+{
+    static std::mutex mutex;
+    static std::map<std::pair<int, int>, std::shared_ptr<const FilterBank>> banks;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<const FilterBank> &bank = banks[std::make_pair(interpolation, decimation)];
+    if (!bank) {
+        std::shared_ptr<FilterBank> designed = std::make_shared<FilterBank>();
+        designed->taps = tapsFor(interpolation, decimation);
+        designed->coefficients = designFilterBank(interpolation, decimation, designed->taps);
+        bank = designed;
+    }
+    return bank;
+}
+
+void Resampler::append(const float *samples, int frameCount)
+{
+    const int needed = m_bufferedFrames + frameCount;
+    if (needed > m_historyFrames) {
+        std::vector<float> history(static_cast<size_t>(needed) * m_channelCount);
+        for (int channel = 0; channel < m_channelCount; ++channel) {
+            const float *row = m_history.data() + static_cast<size_t>(channel) * m_historyFrames;
+            std::copy(row, row + m_bufferedFrames, history.begin() + static_cast<size_t>(channel) * needed);
+        }
+        m_history.swap(history);
+        m_historyFrames = needed;
+    }
+
+    for (int channel = 0; channel < m_channelCount; ++channel) {
+        float *row = m_history.data() + static_cast<size_t>(channel) * m_historyFrames + m_bufferedFrames;
+        if (!samples) {
+            std::fill(row, row + frameCount, 0.0f);
+            continue;
+        }
+        for (int frame = 0; frame < frameCount; ++frame) {
+            row[frame] = samples[static_cast<size_t>(frame) * m_channelCount + channel];
+        }
+    }
+    m_bufferedFrames = needed;
+}
+
+int Resampler::produce(float *samples, std::int64_t limit)
+{
+    const float *coefficients = m_bank->coefficients.data();
+    const int channels = m_channelCount;
+    int produced = 0;
+
+    while (m_base + m_taps <= m_bufferedFrames && m_outputFrames < limit) {
+        const float *phase = coefficients + static_cast<size_t>(m_phase) * m_taps;
+        const float *window = m_history.data() + m_base;
+        float *out = samples + static_cast<size_t>(produced) * channels;
+        for (int channel = 0; channel < channels; ++channel) {
+            out[channel] = m_dot(phase, window + static_cast<size_t>(channel) * m_historyFrames, m_taps);
+        }
+
+        ++produced;
+        ++m_outputFrames;
+        m_phase += m_decimation;
+        m_base += m_phase / m_interpolation;
+        m_phase %= m_interpolation;
+    }
+
+    // Keep only what later outputs still need.
+    const int kept = std::max(0, m_bufferedFrames - m_base);
+    const int dropped = m_bufferedFrames - kept;
+    if (dropped > 0) {
+        for (int channel = 0; channel < channels; ++channel) {
+            float *row = m_history.data() + static_cast<size_t>(channel) * m_historyFrames;
+            std::copy(row + dropped, row + m_bufferedFrames, row);
+        }
+        m_bufferedFrames = kept;
+        m_base -= dropped;
+    }
+
+    return produced;
+}
@@ -0,0 +1,98 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include "BiquadKernels.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Polyphase sample rate converter between 8000, 16000, 22050, 44100 and
+// 48000 Hz, usable as a BlockPipeline stage so a stream is converted and
+// equalised in the same pass.
+//
+// The ratio is reduced to L/M and the converter is the textbook interpolate
+// by L, low-pass, decimate by M, evaluated only at the outputs that are
+// kept: each output is one dot product of a phase of the filter bank with
+// the input history. The low-pass is a Kaiser windowed sinc with 80 dB of
+// stopband, which starts at the lower rate's Nyquist frequency, and 64 taps
+// per phase at the lower rate (more when decimating). Banks are designed
+// once per rate pair and shared by every converter using it.
+//
+// Output frame k is the input at time k * M / L, so the output is aligned
+// with the input rather than delayed by the filter. In return the last 32
+// or so input frames' worth of output are held back until more input
+// arrives or flush() ends the stream.
+//
+// The dot products use the widest SIMD the host supports; the history is
+// kept per channel so they run over contiguous samples.
+class Resampler
+{
+public:
+    Resampler(int inputRate, int outputRate, int channels);
+    Resampler(int inputRate, int outputRate, int channels, BiquadKernels::Isa maximumIsa);
+
+    // Both rates must be among the ones above. A converter built for an
+    // unsupported pair passes blocks through unchanged.
+    static bool isSupported(int inputRate, int outputRate);
+
+    int inputRate() const;
+    int outputRate() const;
+    int channelCount() const;
+    // False when the rates are equal (or unsupported).
+    bool isActive() const;
+    BiquadKernels::Isa isa() const;
+
+    // Converts frameCount interleaved frames in samples and writes the
+    // frames that are ready back into samples, returning their number. The
+    // buffer must hold maximumOutputFrames(frameCount) frames. Allocates
+    // only when a block is longer than any before it.
+    int process(float *samples, int frameCount);
+
+    // Ends the stream: writes up to maximumFrames of the output still held
+    // back into samples and returns their number. Call it until it returns
+    // 0; the stream then totals ceil(inputFrames * L / M) frames. Call
+    // reset() before converting another stream.
+    int flush(float *samples, int maximumFrames);
+
+    // Most frames process(frameCount) can return.
+    int maximumOutputFrames(int frameCount) const;
+
+    void reset();
+
+private:
+    struct FilterBank;
+
+    static std::shared_ptr<const FilterBank> filterBank(int interpolation, int decimation);
+
+    typedef float (*DotFunction)(const float *coefficients, const float *samples, int count);
+
+    int m_inputRate;
+    int m_outputRate;
+    int m_channelCount;
+    int m_interpolation;
+    int m_decimation;
+    std::shared_ptr<const FilterBank> m_bank;
+    int m_taps;
+    BiquadKernels::Isa m_isa;
+    DotFunction m_dot;
+
+    // Input history, one row of m_historyFrames per channel. Frames before
+    // m_base are no longer needed and are dropped after every call.
+    std::vector<float> m_history;
+    int m_historyFrames;
+    int m_bufferedFrames;
+    int m_base;
+    // Filter phase of the next output.
+    int m_phase;
+
+    std::int64_t m_inputFrames;
+    std::int64_t m_outputFrames;
+    // Set by the first flush(), once the trailing silence is in the history.
+    bool m_isFlushing;
+
+    void append(const float *samples, int frameCount);
+    int produce(float *samples, std::int64_t limit);
+};
+
+#endif // RESAMPLER_H
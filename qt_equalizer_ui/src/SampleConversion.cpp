@@ -0,0 +1,209 @@
+#include "SampleConversion.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EQUALIZER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const float Int16Scale = 32768.0f;
+    const float Int24Scale = 8388608.0f;
+    const float Int32Scale = 2147483648.0f;
+    // Largest float below 2^31; 1.0f would wrap to INT32_MIN.
+    const float Int32Maximum = 2147483520.0f;
+
+    std::int32_t roundClamp(float value, float minimum, float maximum)
+    {
+        if (value >= maximum) {
+            return static_cast<std::int32_t>(maximum);
+        }
+        if (value > minimum) {
+            return static_cast<std::int32_t>(std::lrint(value));
+        }
+        // Below the range, or NaN.
+        return static_cast<std::int32_t>(minimum);
+    }
+
+    void int16ToFloat(const std::int16_t *in, float *out, size_t count)
+    {
+        size_t i = 0;
+#ifdef EQUALIZER_SSE2
+        const __m128 scale = _mm_set1_ps(1.0f / Int16Scale);
+        for (; i + 8 <= count; i += 8) {
+            const __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+            // Sign extend by unpacking into the high halves and shifting down.
+            const __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+            const __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+            _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+            _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+        }
+#endif
+        for (; i < count; ++i) {
+            out[i] = in[i] * (1.0f / Int16Scale);
+        }
+    }
+
+    void floatToInt16(const float *in, std::int16_t *out, size_t count)
+    {
+        size_t i = 0;
+#ifdef EQUALIZER_SSE2
+        const __m128 scale = _mm_set1_ps(Int16Scale);
+        const __m128 minimum = _mm_set1_ps(-Int16Scale);
+        const __m128 maximum = _mm_set1_ps(32767.0f);
+        for (; i + 8 <= count; i += 8) {
+            // cvtps rounds to nearest, but turns +inf and anything at or
+            // above 2^31 into INT32_MIN, so clamp first (NaN goes to the
+            // minimum, as in roundClamp).
+            __m128 lowValue = _mm_mul_ps(_mm_loadu_ps(in + i), scale);
+            __m128 highValue = _mm_mul_ps(_mm_loadu_ps(in + i + 4), scale);
+            lowValue = _mm_min_ps(_mm_max_ps(lowValue, minimum), maximum);
+            highValue = _mm_min_ps(_mm_max_ps(highValue, minimum), maximum);
+            const __m128i low = _mm_cvtps_epi32(lowValue);
+            const __m128i high = _mm_cvtps_epi32(highValue);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_packs_epi32(low, high));
+        }
+#endif
+        for (; i < count; ++i) {
+            out[i] = static_cast<std::int16_t>(roundClamp(in[i] * Int16Scale, -32768.0f, 32767.0f));
+        }
+    }
+
+    void int32ToFloat(const std::int32_t *in, float *out, size_t count)
+    {
+        size_t i = 0;
+#ifdef EQUALIZER_SSE2
+        const __m128 scale = _mm_set1_ps(1.0f / Int32Scale);
+        for (; i + 4 <= count; i += 4) {
+            const __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+            _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(samples), scale));
+        }
+#endif
+        for (; i < count; ++i) {
+            out[i] = static_cast<float>(in[i]) * (1.0f / Int32Scale);
+        }
+    }
+
+    void floatToInt32(const float *in, std::int32_t *out, size_t count)
+    {
+        size_t i = 0;
+#ifdef EQUALIZER_SSE2
+        const __m128 scale = _mm_set1_ps(Int32Scale);
+        const __m128 minimum = _mm_set1_ps(-Int32Scale);
+        const __m128 maximum = _mm_set1_ps(Int32Maximum);
+        for (; i + 4 <= count; i += 4) {
+            __m128 value = _mm_mul_ps(_mm_loadu_ps(in + i), scale);
+            value = _mm_min_ps(_mm_max_ps(value, minimum), maximum);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_cvtps_epi32(value));
+        }
+#endif
+        for (; i < count; ++i) {
+            out[i] = roundClamp(in[i] * Int32Scale, -Int32Scale, Int32Maximum);
+        }
+    }
+
+    void float64ToFloat(const double *in, float *out, size_t count)
+    {
+        size_t i = 0;
+#ifdef EQUALIZER_SSE2
+        for (; i + 4 <= count; i += 4) {
+            const __m128 low = _mm_cvtpd_ps(_mm_loadu_pd(in + i));
+            const __m128 high = _mm_cvtpd_ps(_mm_loadu_pd(in + i + 2));
+            _mm_storeu_ps(out + i, _mm_movelh_ps(low, high));
+        }
+#endif
+        for (; i < count; ++i) {
+            out[i] = static_cast<float>(in[i]);
+        }
+    }
+
+    void floatToFloat64(const float *in, double *out, size_t count)
+    {
+        size_t i = 0;
+#ifdef EQUALIZER_SSE2
+        for (; i + 4 <= count; i += 4) {
+            const __m128 samples = _mm_loadu_ps(in + i);
+            _mm_storeu_pd(out + i, _mm_cvtps_pd(samples));
+            _mm_storeu_pd(out + i + 2, _mm_cvtps_pd(_mm_movehl_ps(samples, samples)));
+        }
+#endif
+        for (; i < count; ++i) {
+            out[i] = in[i];
+        }
+    }
+}
+
+void SampleConversion::toFloat(SampleFormat format, const void *source, float *target, size_t sampleCount)
+{
+    const unsigned char *in = static_cast<const unsigned char *>(source);
+
+    switch (format) {
+    case SampleUInt8:
+        for (size_t i = 0; i < sampleCount; ++i) {
+            target[i] = (static_cast<int>(in[i]) - 128) * (1.0f / 128.0f);
+        }
+        break;
+    case SampleInt16:
+        int16ToFloat(static_cast<const std::int16_t *>(source), target, sampleCount);
+        break;
+    case SampleInt24:
+        for (size_t i = 0; i < sampleCount; ++i, in += 3) {
+            // Assemble in the top 24 bits so the arithmetic shift sign extends.
+            const std::int32_t value = static_cast<std::int32_t>((static_cast<std::uint32_t>(in[0]) << 8)
+                                                                 | (static_cast<std::uint32_t>(in[1]) << 16)
+                                                                 | (static_cast<std::uint32_t>(in[2]) << 24)) >> 8;
+            target[i] = value * (1.0f / Int24Scale);
+        }
+        break;
+    case SampleInt32:
+        int32ToFloat(static_cast<const std::int32_t *>(source), target, sampleCount);
+        break;
+    case SampleFloat32:
+        if (static_cast<const void *>(target) != source) {
+            std::memmove(target, source, sampleCount * sizeof(float));
+        }
+        break;
+    case SampleFloat64:
+        float64ToFloat(static_cast<const double *>(source), target, sampleCount);
+        break;
+    }
+}
+
+void SampleConversion::fromFloat(SampleFormat format, const float *source, void *target, size_t sampleCount)
+{
+    unsigned char *out = static_cast<unsigned char *>(target);
+
+    switch (format) {
+    case SampleUInt8:
+        for (size_t i = 0; i < sampleCount; ++i) {
+            out[i] = static_cast<unsigned char>(roundClamp(source[i] * 128.0f, -128.0f, 127.0f) + 128);
+        }
+        break;
+    case SampleInt16:
+        floatToInt16(source, static_cast<std::int16_t *>(target), sampleCount);
+        break;
+    case SampleInt24:
+        for (size_t i = 0; i < sampleCount; ++i, out += 3) {
+            const std::int32_t value = roundClamp(source[i] * Int24Scale, -Int24Scale, Int24Scale - 1.0f);
+            out[0] = static_cast<unsigned char>(value);
+            out[1] = static_cast<unsigned char>(value >> 8);
+            out[2] = static_cast<unsigned char>(value >> 16);
+        }
+        break;
+    case SampleInt32:
+        floatToInt32(source, static_cast<std::int32_t *>(target), sampleCount);
+        break;
+    case SampleFloat32:
+        if (target != static_cast<const void *>(source)) {
+            std::memmove(target, source, sampleCount * sizeof(float));
+        }
+        break;
+    case SampleFloat64:
+        floatToFloat64(source, static_cast<double *>(target), sampleCount);
+        break;
+    }
+}
@@ -0,0 +1,18 @@
+#ifndef SAMPLECONVERSION_H
+#define SAMPLECONVERSION_H
+
+#include "WavFormat.h"
+
+#include <cstddef>
+
+// Conversion between the little-endian WAV sample formats and normalised
+// float (full scale is [-1, 1)). Integer output is rounded to nearest and
+// saturated. The int16, int32 and float64 paths are SSE2 vectorised; these
+// loops are memory bound, so wider ISAs would not buy anything here.
+namespace SampleConversion
+{
+    void toFloat(SampleFormat format, const void *source, float *target, size_t sampleCount);
+    void fromFloat(SampleFormat format, const float *source, void *target, size_t sampleCount);
+}
+
+#endif // SAMPLECONVERSION_H
@@ -0,0 +1,115 @@
+#ifndef SAMPLERING_H
+#define SAMPLERING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Wait-free single producer / single consumer ring of float samples, for
+// handing audio from the audio thread to an analysis thread. write() never
+// blocks or allocates: when the reader falls behind, the samples that do not
+// fit are dropped and counted, and the audio thread carries on.
+class SampleRing
+{
+public:
+    // capacity is rounded up to a power of two.
+    explicit SampleRing(int capacity)
+        : m_buffer(roundUpToPowerOfTwo(capacity))
+        , m_mask(m_buffer.size() - 1)
+        , m_writeIndex(0)
+        , m_readIndex(0)
+        , m_droppedCount(0)
+    {
+    }
+
+    SampleRing(const SampleRing &) = delete;
+    SampleRing &operator=(const SampleRing &) = delete;
+
+    int capacity() const
+    {
+        return static_cast<int>(m_buffer.size());
+    }
+
+    // Producer side. Returns the number of samples stored.
+    int write(const float *samples, int count)
+    {
+        const std::uint64_t writeIndex = m_writeIndex.load(std::memory_order_relaxed);
+        const std::uint64_t readIndex = m_readIndex.load(std::memory_order_acquire);
+        const int space = capacity() - static_cast<int>(writeIndex - readIndex);
+        const int stored = std::max(0, std::min(count, space));
+
+        copyIn(writeIndex, samples, stored);
+        m_writeIndex.store(writeIndex + static_cast<std::uint64_t>(stored), std::memory_order_release);
+
+        if (stored < count) {
+            m_droppedCount.store(m_droppedCount.load(std::memory_order_relaxed) + (count - stored),
+                                 std::memory_order_relaxed);
+        }
+        return stored;
+    }
+
+    // Consumer side. Returns the number of samples copied out.
+    int read(float *samples, int maximumCount)
+    {
+        const std::uint64_t readIndex = m_readIndex.load(std::memory_order_relaxed);
+        const std::uint64_t writeIndex = m_writeIndex.load(std::memory_order_acquire);
+        const int count = std::max(0, std::min(maximumCount, static_cast<int>(writeIndex - readIndex)));
+
+        copyOut(readIndex, samples, count);
+        m_readIndex.store(readIndex + static_cast<std::uint64_t>(count), std::memory_order_release);
+        return count;
+    }
+
+    int available() const
+    {
+        return static_cast<int>(m_writeIndex.load(std::memory_order_acquire) - m_readIndex.load(std::memory_order_relaxed));
+    }
+
+    std::int64_t droppedCount() const
+    {
+        return m_droppedCount.load(std::memory_order_relaxed);
+    }
+
+private:
+    static const int CacheLineSize = 64;
+
+    std::vector<float> m_buffer;
+    size_t m_mask;
+
+    // Each index is written by one side only. The padding keeps them on
+    // separate cache lines.
+    std::atomic<std::uint64_t> m_writeIndex;
+    char m_writePadding[CacheLineSize];
+    std::atomic<std::uint64_t> m_readIndex;
+    char m_readPadding[CacheLineSize];
+    std::atomic<std::int64_t> m_droppedCount;
+
+    static size_t roundUpToPowerOfTwo(int value)
+    {
+        size_t size = 1;
+        while (size < static_cast<size_t>(std::max(1, value))) {
+            size *= 2;
+        }
+        return size;
+    }
+
+    void copyIn(std::uint64_t index, const float *samples, int count)
+    {
+        const size_t start = static_cast<size_t>(index) & m_mask;
+        const size_t first = std::min(static_cast<size_t>(count), m_buffer.size() - start);
+        std::copy(samples, samples + first, m_buffer.begin() + static_cast<std::ptrdiff_t>(start));
+        std::copy(samples + first, samples + count, m_buffer.begin());
+    }
+
+    void copyOut(std::uint64_t index, float *samples, int count) const
+    {
+        const size_t start = static_cast<size_t>(index) & m_mask;
+        const size_t first = std::min(static_cast<size_t>(count), m_buffer.size() - start);
+        std::copy(m_buffer.begin() + static_cast<std::ptrdiff_t>(start),
+                  m_buffer.begin() + static_cast<std::ptrdiff_t>(start + first), samples);
+        std::copy(m_buffer.begin(), m_buffer.begin() + static_cast<std::ptrdiff_t>(count - first), samples + first);
+    }
+};
+
+#endif // SAMPLERING_H
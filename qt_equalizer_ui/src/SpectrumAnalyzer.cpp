@@ -0,0 +1,214 @@
+#include "SpectrumAnalyzer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr double Pi = 3.14159265358979323846;
+    constexpr int MinimumFftSize = 64;
+
+    int roundUpToPowerOfTwo(int value)
+    {
+        int size = MinimumFftSize;
+        while (size < value) {
+            size *= 2;
+        }
+        return size;
+    }
+}
+
+constexpr float SpectrumAnalyzer::FloorDb;
+constexpr float SpectrumAnalyzer::DecayDbPerSecond;
+
+SpectrumAnalyzer::SpectrumAnalyzer(double sampleRate, int fftSize, int pointCount,
+                                   double minimumFrequency, double maximumFrequency)
+    : m_sampleRate(sampleRate > 0.0 ? sampleRate : 48000.0)
+    , m_fftSize(roundUpToPowerOfTwo(fftSize))
+    , m_history(static_cast<size_t>(m_fftSize), 0.0f)
+    , m_historyPosition(0)
+    , m_window(static_cast<size_t>(m_fftSize))
+    , m_buffer(static_cast<size_t>(m_fftSize / 2))
+    , m_twiddles(static_cast<size_t>(m_fftSize / 4))
+    , m_realTwiddles(static_cast<size_t>(m_fftSize / 2 + 1))
+    , m_bitReversed(static_cast<size_t>(m_fftSize / 2))
+    , m_power(static_cast<size_t>(m_fftSize / 2 + 1))
+    , m_frequencies(static_cast<size_t>(std::max(2, pointCount)))
+    , m_firstBin(m_frequencies.size())
+    , m_lastBin(m_frequencies.size())
+    , m_levels(m_frequencies.size(), FloorDb)
+    , m_powerScale(1.0f)
+{
+    const int size = m_fftSize;
+    const int half = size / 2;
+
+    double windowSum = 0.0;
+    for (int i = 0; i < size; ++i) {
+        const double value = 0.5 - 0.5 * std::cos(2.0 * Pi * i / size);
+        m_window[static_cast<size_t>(i)] = static_cast<float>(value);
+        windowSum += value;
+    }
+    // A sine of amplitude A peaks at A * windowSum / 2 in its bin.
+    m_powerScale = static_cast<float>(4.0 / (windowSum * windowSum));
+
+    for (int k = 0; k < half / 2; ++k) {
+        m_twiddles[static_cast<size_t>(k)] = std::polar(1.0f, static_cast<float>(-2.0 * Pi * k / half));
+    }
+    for (int k = 0; k <= half; ++k) {
+        m_realTwiddles[static_cast<size_t>(k)] = std::polar(1.0f, static_cast<float>(-2.0 * Pi * k / size));
+    }
+
+    int bits = 0;
+    while ((1 << bits) < half) {
+        ++bits;
+    }
+    for (int i = 0; i < half; ++i) {
+        int reversed = 0;
+        for (int bit = 0; bit < bits; ++bit) {
+            reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+        }
+        m_bitReversed[static_cast<size_t>(i)] = reversed;
+    }
+
+    // Each point takes the loudest bin between the geometric midpoints to
+    // its neighbours, or the nearest bin where the points are closer
+    // together than the bins.
+    const int points = static_cast<int>(m_frequencies.size());
+    const double low = std::max(1.0, minimumFrequency);
+    const double high = std::max(low * 2.0, maximumFrequency);
+    const double step = std::pow(high / low, 1.0 / (points - 1));
+    const double binsPerHz = size / m_sampleRate;
+    for (int i = 0; i < points; ++i) {
+        const double frequency = low * std::pow(step, i);
+        m_frequencies[static_cast<size_t>(i)] = frequency;
+
+        int first = static_cast<int>(std::ceil(frequency / std::sqrt(step) * binsPerHz));
+        int last = static_cast<int>(std::floor(frequency * std::sqrt(step) * binsPerHz));
+        if (first > last) {
+            first = last = static_cast<int>(std::lround(frequency * binsPerHz));
+        }
+        // Above Nyquist the range is left empty and the point stays at the floor.
+        m_firstBin[static_cast<size_t>(i)] = std::max(1, first);
+        m_lastBin[static_cast<size_t>(i)] = std::min(half, last);
+    }
+}
+
+double SpectrumAnalyzer::sampleRate() const
+{
+    return m_sampleRate;
+}
+
+int SpectrumAnalyzer::fftSize() const
+{
+    return m_fftSize;
+}
+
+int SpectrumAnalyzer::pointCount() const
+{
+    return static_cast<int>(m_levels.size());
+}
+
+double SpectrumAnalyzer::pointFrequency(int point) const
+{
+    if (point < 0 || point >= pointCount()) {
+        return 0.0;
+    }
+    return m_frequencies[static_cast<size_t>(point)];
+}
+
+void SpectrumAnalyzer::push(const float *samples, int count)
+{
+    if (!samples || count <= 0) {
+        return;
+    }
+
+    // Only the newest m_fftSize samples matter.
+    if (count > m_fftSize) {
+        samples += count - m_fftSize;
+        count = m_fftSize;
+    }
+
+    const int first = std::min(count, m_fftSize - m_historyPosition);
+    std::copy(samples, samples + first, m_history.begin() + m_historyPosition);
+    std::copy(samples + first, samples + count, m_history.begin());
+    m_historyPosition = (m_historyPosition + count) & (m_fftSize - 1);
+}
+
+void SpectrumAnalyzer::analyze(double elapsedSeconds)
+{
+    transform();
+
+    const float decay = static_cast<float>(DecayDbPerSecond * std::max(0.0, elapsedSeconds));
+    const int points = pointCount();
+    for (int i = 0; i < points; ++i) {
+        float power = 0.0f;
+        for (int bin = m_firstBin[static_cast<size_t>(i)]; bin <= m_lastBin[static_cast<size_t>(i)]; ++bin) {
+            power = std::max(power, m_power[static_cast<size_t>(bin)]);
+        }
+
+        const float level = power > 0.0f ? 10.0f * std::log10(power * m_powerScale) : FloorDb;
+        float &current = m_levels[static_cast<size_t>(i)];
+        current = std::max(FloorDb, std::max(level, current - decay));
+    }
+}
+
+const std::vector<float> &SpectrumAnalyzer::levels() const
+{
+    return m_levels;
+}
+
+bool SpectrumAnalyzer::isAtFloor() const
+{
+    for (float level : m_levels) {
+        if (level > FloorDb) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SpectrumAnalyzer::reset()
+{
+    std::fill(m_history.begin(), m_history.end(), 0.0f);
+    std::fill(m_levels.begin(), m_levels.end(), FloorDb);
+    m_historyPosition = 0;
+}
+
+void SpectrumAnalyzer::transform()
+{
+    const int size = m_fftSize;
+    const int half = size / 2;
+
+    // Pack the windowed samples, oldest first, as half-size complex input
+    // (even samples real, odd imaginary) in bit-reversed order.
+    for (int i = 0; i < half; ++i) {
+        const int even = (m_historyPosition + 2 * i) & (size - 1);
+        const int odd = (even + 1) & (size - 1);
+        m_buffer[static_cast<size_t>(m_bitReversed[static_cast<size_t>(i)])] =
+                Complex(m_history[static_cast<size_t>(even)] * m_window[static_cast<size_t>(2 * i)],
+                        m_history[static_cast<size_t>(odd)] * m_window[static_cast<size_t>(2 * i + 1)]);
+    }
+
+    Complex *data = m_buffer.data();
+    for (int length = 2; length <= half; length *= 2) {
+        const int stride = half / length;
+        for (int start = 0; start < half; start += length) {
+            for (int k = 0; k < length / 2; ++k) {
+                const Complex odd = data[start + k + length / 2] * m_twiddles[static_cast<size_t>(k * stride)];
+                const Complex even = data[start + k];
+                data[start + k] = even + odd;
+                data[start + k + length / 2] = even - odd;
+            }
+        }
+    }
+
+    // Split the half-size transform into the spectrum of the real input.
+    const Complex minusHalfI(0.0f, -0.5f);
+    for (int k = 0; k <= half; ++k) {
+        const Complex z = data[k & (half - 1)];
+        const Complex mirrored = std::conj(data[(half - k) & (half - 1)]);
+        const Complex even = 0.5f * (z + mirrored);
+        const Complex odd = minusHalfI * (z - mirrored);
+        m_power[static_cast<size_t>(k)] = std::norm(even + m_realTwiddles[static_cast<size_t>(k)] * odd);
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef SPECTRUMANALYZER_H
+#define SPECTRUMANALYZER_H
+
+#include <complex>
+#include <vector>
+
+// Magnitude spectrum of the most recent fftSize mono samples, reduced to
+// pointCount levels at log-spaced frequencies for drawing. Uses a Hann
+// window and a real FFT computed as a half-size complex one. Levels are in
+// dBFS (a full-scale sine reads 0 dB), clamped to FloorDb, and fall back at
+// most DecayDbPerSecond so the display does not flicker.
+//
+// All storage is allocated in the constructor; push() and analyze() do not
+// allocate. Not thread-safe: one thread owns an analyzer.
+class SpectrumAnalyzer
+{
+public:
+    static constexpr float FloorDb = -96.0f;
+    static constexpr float DecayDbPerSecond = 40.0f;
+
+    // fftSize is rounded up to a power of two, at least 64.
+    SpectrumAnalyzer(double sampleRate, int fftSize, int pointCount, double minimumFrequency, double maximumFrequency);
+
+    double sampleRate() const;
+    int fftSize() const;
+    int pointCount() const;
+    double pointFrequency(int point) const;
+
+    // Appends to the analysis window, keeping the newest fftSize samples.
+    void push(const float *samples, int count);
+
+    // Transforms the current window and updates levels(). elapsedSeconds is
+    // the time since the previous call and sets how far levels may decay.
+    void analyze(double elapsedSeconds);
+
+    const std::vector<float> &levels() const;
+    // True once every level has decayed to the floor.
+    bool isAtFloor() const;
+    void reset();
+
+private:
+    typedef std::complex<float> Complex;
+
+    double m_sampleRate;
+    int m_fftSize;
+
+    // Circular history of the newest m_fftSize samples.
+    std::vector<float> m_history;
+    int m_historyPosition;
+
+    std::vector<float> m_window;
+    std::vector<Complex> m_buffer;
+    std::vector<Complex> m_twiddles;
+    std::vector<Complex> m_realTwiddles;
+    std::vector<int> m_bitReversed;
+    std::vector<float> m_power;
+
+    // Point i covers the FFT bins m_firstBin[i] .. m_lastBin[i].
+    std::vector<double> m_frequencies;
+    std::vector<int> m_firstBin;
+    std::vector<int> m_lastBin;
+    std::vector<float> m_levels;
+    float m_powerScale;
+
+    void transform();
+};
+
+#endif // SPECTRUMANALYZER_H
@@ -0,0 +1,80 @@
+#include "SpectrumWorker.h"
+
+#include "EqualizerEngine.h"
+#include "SampleRing.h"
+
+#include <QTimer>
+
+#include <algorithm>
+
+namespace
+{
+    // About 60 frames per second.
+    constexpr int FrameInterval = 16;
+
+    // 4096 points resolve about 12 Hz at 48 kHz, enough to separate the
+    // lowest bands.
+    constexpr int FftSize = 4096;
+}
+
+SpectrumWorker::SpectrumWorker(SampleRing *ring, double sampleRate, int pointCount, QObject *parent)
+    : QObject(parent)
+    , m_ring(ring)
+    , m_analyzer(sampleRate, FftSize, pointCount,
+                 EqualizerEngine::bandFrequency(0), EqualizerEngine::bandFrequency(EqualizerEngine::BandCount - 1))
+    , m_readBuffer(ring ? ring->capacity() : 0)
+    , m_timer(nullptr)
+    , m_isIdle(true)
+{
+}
+
+void SpectrumWorker::start()
+{
+    if (!m_timer) {
+        // Created here so the timer belongs to the worker's thread.
+        m_timer = new QTimer(this);
+        m_timer->setTimerType(Qt::PreciseTimer);
+        m_timer->setInterval(FrameInterval);
+        connect(m_timer, &QTimer::timeout, this, &SpectrumWorker::analyze);
+    }
+
+    m_clock.start();
+    m_timer->start();
+}
+
+void SpectrumWorker::stop()
+{
+    if (m_timer) {
+        m_timer->stop();
+    }
+}
+
+void SpectrumWorker::analyze()
+{
+    if (!m_ring) {
+        return;
+    }
+
+    const double elapsed = m_clock.restart() / 1000.0;
+    const int received = m_ring->read(m_readBuffer.data(), m_readBuffer.size());
+    if (received == 0 && m_isIdle) {
+        return;
+    }
+
+    int count = received;
+    if (received == 0) {
+        // Nothing arrived, so playback has stopped: let the window run out
+        // as if silence had been played.
+        count = qMin(m_readBuffer.size(), qRound(elapsed * m_analyzer.sampleRate()));
+        std::fill(m_readBuffer.begin(), m_readBuffer.begin() + count, 0.0f);
+    }
+
+    m_analyzer.push(m_readBuffer.constData(), count);
+    m_analyzer.analyze(elapsed);
+    m_isIdle = received == 0 && m_analyzer.isAtFloor();
+
+    const std::vector<float> &levels = m_analyzer.levels();
+    QVector<float> levelsDb(static_cast<int>(levels.size()));
+    std::copy(levels.begin(), levels.end(), levelsDb.begin());
+    emit spectrumChanged(levelsDb);
+}
@@ -0,0 +1,48 @@
+#ifndef SPECTRUMWORKER_H
+#define SPECTRUMWORKER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QVector>
+
+#include "SpectrumAnalyzer.h"
+
+class QTimer;
+class SampleRing;
+
+// Drains a SampleRing fed by EqualizerEngine::setAnalysisRing() and turns it
+// into spectrum levels at display rate. Meant to live on its own QThread so
+// neither the audio thread nor the GUI thread pays for the FFT; results
+// reach the GUI through a queued connection. Nothing is emitted while the
+// input stays silent and the display has decayed, so an idle analyser
+// causes no repaints.
+class SpectrumWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    // The levels cover log-spaced frequencies from the lowest to the
+    // highest band centre.
+    SpectrumWorker(SampleRing *ring, double sampleRate, int pointCount, QObject *parent = nullptr);
+
+public slots:
+    // Call through a queued connection once the worker is on its thread.
+    void start();
+    void stop();
+
+signals:
+    void spectrumChanged(const QVector<float> &levelsDb);
+
+private slots:
+    void analyze();
+
+private:
+    SampleRing *m_ring;
+    SpectrumAnalyzer m_analyzer;
+    QVector<float> m_readBuffer;
+    QTimer *m_timer;
+    QElapsedTimer m_clock;
+    bool m_isIdle;
+};
+
+#endif // SPECTRUMWORKER_H
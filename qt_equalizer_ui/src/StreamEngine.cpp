@@ -0,0 +1,661 @@
+#include "StreamEngine.h"
+#include "BiquadCoefficientTable.h"
+#include "BiquadFilter.h"
+#include "DenormalGuard.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Coefficient and state floats per lane and section.
+    constexpr int CoefficientCount = 5;
+    constexpr int StateCount = 2;
+    constexpr int MaximumLanes = 16;
+    constexpr double HalfPi = 1.57079632679489661923;
+
+    std::int64_t nanosecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Drops the consumed head of a FIFO once it is at least half the buffer,
+    // so the copy is amortised over the reads that produced it.
+    void compact(std::vector<float> *fifo, size_t *head)
+    {
+        if (*head > 0 && *head * 2 >= fifo->size()) {
+            fifo->erase(fifo->begin(), fifo->begin() + static_cast<std::ptrdiff_t>(*head));
+            *head = 0;
+        }
+    }
+}
+
+StreamStatistics::StreamStatistics()
+    : framesWritten(0)
+    , framesProcessed(0)
+    , framesRead(0)
+    , blocks(0)
+    , bypassedBlocks(0)
+    , bypassedFrames(0)
+    , silentBlocks(0)
+    , processingNs(0)
+{
+}
+
+StreamEngineStatistics::StreamEngineStatistics()
+    : streams(0)
+    , groups(0)
+    , framesProcessed(0)
+    , blocks(0)
+    , groupRuns(0)
+    , silentBlocks(0)
+    , busyNs(0)
+    , elapsedNs(0)
+    , steals(0)
+    , audioSeconds(0.0)
+{
+}
+
+double StreamEngineStatistics::realTimeFactor() const
+{
+    return busyNs > 0 ? audioSeconds * 1e9 / busyNs : 0.0;
+}
+
+StreamEngine::Stream::Stream()
+    : isUsed(false)
+    , generation(0)
+    , group(nullptr)
+    , firstLane(0)
+    , channels(0)
+    , sampleRate(0.0)
+    , tableIndex(-1)
+    , gainsChanged(false)
+    , resetPending(false)
+    , isBypassed(false)
+    , fadePending(false)
+    , bypassMode(EqualizerEngine::FreezeAndReset)
+    , isInFlight(false)
+    , inputHead(0)
+    , outputHead(0)
+{
+    std::fill(gains, gains + BandCount, 0);
+}
+
+StreamEngine::StreamEngine(int maximumStreams, int blockFrames, int threadCount)
+    : StreamEngine(maximumStreams, blockFrames, threadCount, BiquadKernels::hostIsa())
+{
+}
+
+StreamEngine::StreamEngine(int maximumStreams, int blockFrames, int threadCount, BiquadKernels::Isa maximumIsa)
+    : m_maximumStreams(std::max(1, maximumStreams))
+    , m_blockFrames(std::max(1, blockFrames))
+    , m_kernel(BiquadKernels::select(MaximumLanes, maximumIsa))
+    , m_cascade(BiquadKernels::unrolled(m_kernel, BandCount))
+    , m_streams(new Stream[static_cast<size_t>(m_maximumStreams)])
+    , m_startTime(std::chrono::steady_clock::now())
+    , m_framesProcessed(0)
+    , m_blocks(0)
+    , m_groupRuns(0)
+    , m_silentBlocks(0)
+    , m_busyNs(0)
+    , m_audioNs(0)
+    , m_fadeCurve(static_cast<size_t>(m_blockFrames))
+    , m_pool(threadCount)
+{
+    // Sampled at frame centres, so curve[i]^2 + curve[n - 1 - i]^2 == 1.
+    for (int i = 0; i < m_blockFrames; ++i) {
+        m_fadeCurve[static_cast<size_t>(i)] = static_cast<float>(std::sin(HalfPi * (i + 0.5) / m_blockFrames));
+    }
+
+    m_freeStreams.reserve(static_cast<size_t>(m_maximumStreams));
+    for (int i = m_maximumStreams - 1; i >= 0; --i) {
+        m_freeStreams.push_back(i);
+    }
+    m_groups.reserve(static_cast<size_t>(m_maximumStreams));
+
+    const size_t lanes = static_cast<size_t>(m_kernel.laneCount);
+    m_laneBuffers.resize(static_cast<size_t>(m_pool.threadCount()), std::vector<float>(m_blockFrames * lanes));
+    m_dryBuffers.resize(static_cast<size_t>(m_pool.threadCount()), std::vector<float>(m_blockFrames * lanes));
+    m_savedStates.resize(static_cast<size_t>(m_pool.threadCount()), std::vector<float>(BandCount * StateCount * lanes));
+}
+
+StreamEngine::~StreamEngine()
+{
+    m_pool.wait();
+}
+
+int StreamEngine::maximumStreams() const
+{
+    return m_maximumStreams;
+}
+
+int StreamEngine::blockFrames() const
+{
+    return m_blockFrames;
+}
+
+int StreamEngine::laneCount() const
+{
+    return m_kernel.laneCount;
+}
+
+int StreamEngine::threadCount() const
+{
+    return m_pool.threadCount();
+}
+
+BiquadKernels::Isa StreamEngine::isa() const
+{
+    return m_kernel.isa;
+}
+
+int StreamEngine::addStream(double sampleRate, int channels)
+{
+    const int lanes = m_kernel.laneCount;
+    if (channels < 1 || channels > lanes || sampleRate <= 0.0) {
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_freeStreams.empty()) {
+        return -1;
+    }
+
+    // First fit into an existing group, else a new one.
+    Group *group = nullptr;
+    int firstLane = 0;
+    for (const std::unique_ptr<Group> &candidate : m_groups) {
+        std::lock_guard<std::mutex> groupLock(candidate->mutex);
+        int run = 0;
+        for (int lane = 0; lane < lanes; ++lane) {
+            run = candidate->laneOwners[static_cast<size_t>(lane)] ? 0 : run + 1;
+            if (run == channels) {
+                group = candidate.get();
+                firstLane = lane - channels + 1;
+                break;
+            }
+        }
+        if (group) {
+            break;
+        }
+    }
+    if (!group) {
+        std::unique_ptr<Group> created(new Group);
+        created->isScheduled = false;
+        created->laneOwners.assign(static_cast<size_t>(lanes), nullptr);
+        created->storage.assign(static_cast<size_t>(BandCount) * (CoefficientCount + StateCount) * lanes, 0.0f);
+        group = created.get();
+        m_groups.push_back(std::move(created));
+    }
+
+    const int id = m_freeStreams.back();
+    m_freeStreams.pop_back();
+    Stream &stream = m_streams[static_cast<size_t>(id)];
+
+    std::lock_guard<std::mutex> groupLock(group->mutex);
+    stream.isUsed = true;
+    stream.group = group;
+    stream.firstLane = firstLane;
+    stream.channels = channels;
+    stream.sampleRate = sampleRate;
+    stream.tableIndex = BiquadCoefficientTable::sampleRateIndex(sampleRate);
+    std::fill(stream.gains, stream.gains + BandCount, 0);
+    stream.gainsChanged = true;
+    stream.resetPending = true;
+    stream.isBypassed = false;
+    stream.fadePending = false;
+    stream.bypassMode = EqualizerEngine::FreezeAndReset;
+    stream.isInFlight = false;
+    stream.input.clear();
+    stream.inputHead = 0;
+    stream.output.clear();
+    stream.outputHead = 0;
+    stream.statistics = StreamStatistics();
+
+    group->streams.push_back(&stream);
+    std::fill(group->laneOwners.begin() + firstLane, group->laneOwners.begin() + firstLane + channels, &stream);
+    return id;
+}
+
+void StreamEngine::removeStream(int id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stream *stream = streamAt(id);
+    if (!stream) {
+        return;
+    }
+
+    Group *group = stream->group;
+    {
+        std::lock_guard<std::mutex> groupLock(group->mutex);
+        group->streams.erase(std::find(group->streams.begin(), group->streams.end(), stream));
+        std::fill(group->laneOwners.begin() + stream->firstLane,
+                  group->laneOwners.begin() + stream->firstLane + stream->channels, nullptr);
+
+        // A group task still holding this stream sees the new generation and
+        // drops its output.
+        stream->isUsed = false;
+        ++stream->generation;
+        stream->group = nullptr;
+        std::vector<float>().swap(stream->input);
+        std::vector<float>().swap(stream->output);
+    }
+
+    m_freeStreams.push_back(id);
+}
+
+bool StreamEngine::setBandGains(int id, const int *gains, int count)
+{
+    Stream *stream = streamAt(id);
+    if (!stream) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(stream->group->mutex);
+    for (int i = 0; i < BandCount; ++i) {
+        const int gain = gains && i < count ? gains[i] : 0;
+        stream->gains[i] = std::max(EqualizerBands::MinimumGain, std::min(gain, EqualizerBands::MaximumGain));
+    }
+    stream->gainsChanged = true;
+    return true;
+}
+
+bool StreamEngine::setBypassed(int id, bool bypassed)
+{
+    Stream *stream = streamAt(id);
+    if (!stream) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(stream->group->mutex);
+    if (stream->isBypassed == bypassed) {
+        return true;
+    }
+
+    // Toggling back before the fade block ran cancels the fade.
+    if (!bypassed && !stream->fadePending && stream->bypassMode == EqualizerEngine::FreezeAndReset) {
+        // Resume from rest rather than from the state the bypass froze.
+        stream->resetPending = true;
+    }
+    stream->isBypassed = bypassed;
+    stream->fadePending = !stream->fadePending;
+    return true;
+}
+
+bool StreamEngine::setBypassMode(int id, EqualizerEngine::BypassMode mode)
+{
+    Stream *stream = streamAt(id);
+    if (!stream) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(stream->group->mutex);
+    stream->bypassMode = mode;
+    return true;
+}
+
+bool StreamEngine::write(int id, const float *samples, int frameCount)
+{
+    Stream *stream = streamAt(id);
+    if (!stream || frameCount < 0 || (!samples && frameCount > 0)) {
+        return false;
+    }
+
+    Group *group = stream->group;
+    bool needsScheduling = false;
+    {
+        std::lock_guard<std::mutex> lock(group->mutex);
+        if (stream->isBypassed && !stream->fadePending && stream->bypassMode == EqualizerEngine::FreezeAndReset
+                && !stream->isInFlight && stream->inputHead == stream->input.size()) {
+            compact(&stream->output, &stream->outputHead);
+            stream->output.insert(stream->output.end(), samples, samples + static_cast<size_t>(frameCount) * stream->channels);
+            stream->statistics.framesWritten += frameCount;
+            stream->statistics.framesProcessed += frameCount;
+            stream->statistics.bypassedFrames += frameCount;
+            return true;
+        }
+
+        compact(&stream->input, &stream->inputHead);
+        stream->input.insert(stream->input.end(), samples, samples + static_cast<size_t>(frameCount) * stream->channels);
+        stream->statistics.framesWritten += frameCount;
+
+        const size_t queued = (stream->input.size() - stream->inputHead) / stream->channels;
+        if (!group->isScheduled && queued >= static_cast<size_t>(m_blockFrames)) {
+            group->isScheduled = true;
+            needsScheduling = true;
+        }
+    }
+
+    if (needsScheduling) {
+        schedule(group);
+    }
+    return true;
+}
+
+int StreamEngine::read(int id, float *samples, int maximumFrames)
+{
+    Stream *stream = streamAt(id);
+    if (!stream || !samples || maximumFrames <= 0) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(stream->group->mutex);
+    const int channels = stream->channels;
+    const size_t available = (stream->output.size() - stream->outputHead) / channels;
+    const int frames = static_cast<int>(std::min(available, static_cast<size_t>(maximumFrames)));
+
+    const float *begin = stream->output.data() + stream->outputHead;
+    std::copy(begin, begin + static_cast<size_t>(frames) * channels, samples);
+    stream->outputHead += static_cast<size_t>(frames) * channels;
+    stream->statistics.framesRead += frames;
+    compact(&stream->output, &stream->outputHead);
+    return frames;
+}
+
+int StreamEngine::availableFrames(int id) const
+{
+    Stream *stream = streamAt(id);
+    if (!stream) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(stream->group->mutex);
+    return static_cast<int>((stream->output.size() - stream->outputHead) / stream->channels);
+}
+
+void StreamEngine::waitForIdle()
+{
+    m_pool.wait();
+}
+
+StreamStatistics StreamEngine::streamStatistics(int id) const
+{
+    Stream *stream = streamAt(id);
+    if (!stream) {
+        return StreamStatistics();
+    }
+
+    std::lock_guard<std::mutex> lock(stream->group->mutex);
+    return stream->statistics;
+}
+
+StreamEngineStatistics StreamEngine::statistics() const
+{
+    StreamEngineStatistics statistics;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        statistics.streams = m_maximumStreams - static_cast<int>(m_freeStreams.size());
+        statistics.groups = static_cast<int>(m_groups.size());
+    }
+    statistics.framesProcessed = m_framesProcessed.load(std::memory_order_relaxed);
+    statistics.blocks = m_blocks.load(std::memory_order_relaxed);
+    statistics.groupRuns = m_groupRuns.load(std::memory_order_relaxed);
+    statistics.silentBlocks = m_silentBlocks.load(std::memory_order_relaxed);
+    statistics.busyNs = m_busyNs.load(std::memory_order_relaxed);
+    statistics.elapsedNs = nanosecondsSince(m_startTime);
+    statistics.steals = m_pool.stealCount();
+    statistics.audioSeconds = m_audioNs.load(std::memory_order_relaxed) / 1e9;
+    return statistics;
+}
+
+StreamEngine::Stream *StreamEngine::streamAt(int id) const
+{
+    if (id < 0 || id >= m_maximumStreams || !m_streams[static_cast<size_t>(id)].isUsed) {
+        return nullptr;
+    }
+
+    return &m_streams[static_cast<size_t>(id)];
+}
+
+float *StreamEngine::coefficientsOf(Group *group) const
+{
+    return group->storage.data();
+}
+
+float *StreamEngine::statesOf(Group *group) const
+{
+    return group->storage.data() + static_cast<size_t>(BandCount) * CoefficientCount * m_kernel.laneCount;
+}
+
+void StreamEngine::updateCoefficients(Stream *stream)
+{
+    const int lanes = m_kernel.laneCount;
+    float *c = coefficientsOf(stream->group);
+
+    for (int band = 0; band < BandCount; ++band, c += CoefficientCount * lanes) {
+        BiquadCoefficients coefficients;
+        if (!BiquadCoefficientTable::lookup(stream->tableIndex, band, stream->gains[band], &coefficients)) {
+            coefficients = Biquad::peaking(EqualizerBands::Frequencies[band], stream->gains[band],
+                                           EqualizerBands::Q, stream->sampleRate);
+        }
+
+        // Flat bands keep an identity section; it passes samples through
+        // exactly, so every lane can run the full cascade.
+        for (int lane = stream->firstLane; lane < stream->firstLane + stream->channels; ++lane) {
+            c[lane] = coefficients.b0;
+            c[lanes + lane] = coefficients.b1;
+            c[2 * lanes + lane] = coefficients.b2;
+            c[3 * lanes + lane] = coefficients.a1;
+            c[4 * lanes + lane] = coefficients.a2;
+        }
+    }
+}
+
+void StreamEngine::resetState(Stream *stream)
+{
+    const int lanes = m_kernel.laneCount;
+    float *s = statesOf(stream->group);
+
+    for (int row = 0; row < BandCount * StateCount; ++row, s += lanes) {
+        std::fill(s + stream->firstLane, s + stream->firstLane + stream->channels, 0.0f);
+    }
+}
+
+bool StreamEngine::isStateSilent(const Stream *stream) const
+{
+    const int lanes = m_kernel.laneCount;
+    const float *s = statesOf(stream->group);
+
+    for (int row = 0; row < BandCount * StateCount; ++row, s += lanes) {
+        if (!EqualizerEngine::isSilent(s + stream->firstLane, static_cast<size_t>(stream->channels))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void StreamEngine::schedule(Group *group)
+{
+    m_pool.submit([this, group] { processGroup(group); });
+}
+
+void StreamEngine::processGroup(Group *group)
+{
+    const DenormalGuard denormalGuard;
+    const int lanes = m_kernel.laneCount;
+    const int frames = m_blockFrames;
+    const size_t worker = static_cast<size_t>(m_pool.currentWorker());
+    float *buffer = m_laneBuffers[worker].data();
+    float *dry = m_dryBuffers[worker].data();
+    float *saved = m_savedStates[worker].data();
+    float *states = statesOf(group);
+    const size_t stateSize = static_cast<size_t>(BandCount) * StateCount * lanes;
+
+    std::vector<ReadyStream> ready;
+    ready.reserve(static_cast<size_t>(lanes));
+    bool laneIsReady[MaximumLanes];
+
+    for (;;) {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        ready.clear();
+        std::fill(laneIsReady, laneIsReady + lanes, false);
+        std::fill(buffer, buffer + static_cast<size_t>(frames) * lanes, 0.0f);
+
+        {
+            std::lock_guard<std::mutex> lock(group->mutex);
+            for (Stream *stream : group->streams) {
+                const int channels = stream->channels;
+                if (stream->gainsChanged) {
+                    updateCoefficients(stream);
+                    stream->gainsChanged = false;
+                }
+                if (stream->resetPending) {
+                    resetState(stream);
+                    stream->resetPending = false;
+                }
+
+                const size_t queued = (stream->input.size() - stream->inputHead) / channels;
+                if (queued < static_cast<size_t>(frames)) {
+                    continue;
+                }
+
+                const float *in = stream->input.data() + stream->inputHead;
+                stream->inputHead += static_cast<size_t>(frames) * channels;
+
+                const bool isFading = stream->fadePending;
+                stream->fadePending = false;
+                if (stream->isBypassed && !isFading && stream->bypassMode == EqualizerEngine::FreezeAndReset) {
+                    stream->output.insert(stream->output.end(), in, in + static_cast<size_t>(frames) * channels);
+                    ++stream->statistics.bypassedBlocks;
+                    stream->statistics.framesProcessed += frames;
+                    stream->statistics.bypassedFrames += frames;
+                    continue;
+                }
+
+                // Silence into rung out filters comes out as the same
+                // silence; clear the state so it restarts exactly at rest.
+                if (!isFading && EqualizerEngine::isSilent(in, static_cast<size_t>(frames) * channels)
+                        && isStateSilent(stream)) {
+                    resetState(stream);
+                    stream->output.insert(stream->output.end(), in, in + static_cast<size_t>(frames) * channels);
+                    ++stream->statistics.silentBlocks;
+                    stream->statistics.framesProcessed += frames;
+                    m_silentBlocks.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+
+                for (int frame = 0; frame < frames; ++frame) {
+                    std::copy(in + frame * channels, in + (frame + 1) * channels,
+                              buffer + frame * lanes + stream->firstLane);
+                }
+                std::fill(laneIsReady + stream->firstLane, laneIsReady + stream->firstLane + channels, true);
+
+                Mix mix = Wet;
+                if (stream->isBypassed) {
+                    mix = isFading ? FadeToDry : Dry;
+                } else if (isFading) {
+                    mix = FadeToWet;
+                }
+                stream->isInFlight = true;
+                ready.push_back({stream, stream->generation, mix});
+            }
+
+            if (ready.empty()) {
+                // Bypassed blocks may have been moved above; nothing else to
+                // run until the next write() reschedules the group.
+                bool hasMore = false;
+                for (Stream *stream : group->streams) {
+                    if ((stream->input.size() - stream->inputHead) / stream->channels >= static_cast<size_t>(frames)) {
+                        hasMore = true;
+                        break;
+                    }
+                }
+                if (!hasMore) {
+                    group->isScheduled = false;
+                    return;
+                }
+                continue;
+            }
+        }
+
+        for (const ReadyStream &entry : ready) {
+            if (entry.mix != Wet) {
+                std::copy(buffer, buffer + static_cast<size_t>(frames) * lanes, dry);
+                break;
+            }
+        }
+
+        // The kernel advances every lane; put back the state of lanes that
+        // had no block so they continue where they were.
+        std::copy(states, states + stateSize, saved);
+        m_cascade(coefficientsOf(group), states, BandCount, buffer, frames);
+        for (size_t row = 0; row < stateSize; row += static_cast<size_t>(lanes)) {
+            for (int lane = 0; lane < lanes; ++lane) {
+                if (!laneIsReady[lane]) {
+                    states[row + static_cast<size_t>(lane)] = saved[row + static_cast<size_t>(lane)];
+                }
+            }
+        }
+
+        int readyLanes = 0;
+        for (const ReadyStream &entry : ready) {
+            readyLanes += entry.stream->channels;
+        }
+
+        std::int64_t audioNs = 0;
+        {
+            std::lock_guard<std::mutex> lock(group->mutex);
+            const std::int64_t elapsed = nanosecondsSince(start);
+            for (const ReadyStream &entry : ready) {
+                Stream *stream = entry.stream;
+                if (stream->generation != entry.generation) {
+                    continue;
+                }
+
+                const int channels = stream->channels;
+                appendOutput(entry, buffer, dry);
+                stream->isInFlight = false;
+                if (entry.mix == Dry) {
+                    ++stream->statistics.bypassedBlocks;
+                    stream->statistics.bypassedFrames += frames;
+                } else {
+                    ++stream->statistics.blocks;
+                }
+                stream->statistics.framesProcessed += frames;
+                stream->statistics.processingNs += elapsed * channels / readyLanes;
+                audioNs += static_cast<std::int64_t>(frames * 1e9 / stream->sampleRate) * channels;
+            }
+            m_busyNs.fetch_add(elapsed, std::memory_order_relaxed);
+        }
+
+        m_framesProcessed.fetch_add(static_cast<std::int64_t>(frames) * readyLanes, std::memory_order_relaxed);
+        m_blocks.fetch_add(static_cast<std::int64_t>(ready.size()), std::memory_order_relaxed);
+        m_groupRuns.fetch_add(1, std::memory_order_relaxed);
+        m_audioNs.fetch_add(audioNs, std::memory_order_relaxed);
+    }
+}
+
+void StreamEngine::appendOutput(const ReadyStream &entry, const float *buffer, const float *dry)
+{
+    Stream *stream = entry.stream;
+    const int lanes = m_kernel.laneCount;
+    const int frames = m_blockFrames;
+    const int channels = stream->channels;
+
+    if (entry.mix == Wet || entry.mix == Dry) {
+        const float *source = entry.mix == Wet ? buffer : dry;
+        for (int frame = 0; frame < frames; ++frame) {
+            const float *out = source + frame * lanes + stream->firstLane;
+            stream->output.insert(stream->output.end(), out, out + channels);
+        }
+        return;
+    }
+
+    const float *curve = m_fadeCurve.data();
+    const size_t begin = stream->output.size();
+    stream->output.resize(begin + static_cast<size_t>(frames) * channels);
+    float *out = stream->output.data() + begin;
+
+    for (int frame = 0; frame < frames; ++frame, out += channels) {
+        const float rising = curve[frame];
+        const float falling = curve[frames - 1 - frame];
+        const float wetGain = entry.mix == FadeToWet ? rising : falling;
+        const float dryGain = entry.mix == FadeToWet ? falling : rising;
+
+        const float *wet = buffer + frame * lanes + stream->firstLane;
+        const float *in = dry + frame * lanes + stream->firstLane;
+        for (int channel = 0; channel < channels; ++channel) {
+            out[channel] = wet[channel] * wetGain + in[channel] * dryGain;
+        }
+    }
+}
@@ -0,0 +1,226 @@
+#ifndef STREAMENGINE_H
+#define STREAMENGINE_H
+
+#include "BiquadKernels.h"
+#include "EqualizerBands.h"
+#include "EqualizerEngine.h"
+#include "WorkStealingPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct StreamStatistics
+{
+    std::int64_t framesWritten;
+    std::int64_t framesProcessed;
+    std::int64_t framesRead;
+    std::int64_t blocks;
+    std::int64_t bypassedBlocks;
+    // Frames passed on dry while bypassed, including those that never
+    // went through a worker.
+    std::int64_t bypassedFrames;
+    // Silent blocks passed on without filtering because the stream's
+    // filters had rung out.
+    std::int64_t silentBlocks;
+    // This stream's share of the kernel time of the groups it ran in.
+    std::int64_t processingNs;
+
+    StreamStatistics();
+};
+
+struct StreamEngineStatistics
+{
+    int streams;
+    int groups;
+    std::int64_t framesProcessed;
+    std::int64_t blocks;
+    std::int64_t groupRuns;
+    std::int64_t silentBlocks;
+    std::int64_t busyNs;
+    std::int64_t elapsedNs;
+    std::uint64_t steals;
+    // Audio processed, summed over all streams.
+    double audioSeconds;
+
+    StreamEngineStatistics();
+
+    // Seconds of audio per second of worker time: how many real-time mono
+    // streams one fully loaded core sustains.
+    double realTimeFactor() const;
+};
+
+// Equaliser for many independent PCM streams at once, for running as a
+// shared service. Each stream has its own gains, bypass flag, sample rate and
+// filter state, like one EqualizerWidget/EqualizerEngine pair.
+//
+// Channels of all streams are packed into the lanes of the widest cascade
+// kernel (see BiquadKernels.h): a lane group holds up to laneCount()
+// channels of different streams, with coefficients and filter state stored
+// contiguously per group, so one kernel call advances a whole group. Streams
+// never straddle groups, so a stream can have at most laneCount() channels.
+//
+// Input is cut into blocks of blockFrames(). When a write() completes a
+// block, the stream's group is queued on a WorkStealingPool; the group task
+// runs every stream of the group that has a block ready, keeping the state of
+// the others untouched, until none is left. Output therefore lags input by
+// up to one block, and a trailing partial block waits for more input.
+//
+// Bypass and un-bypass crossfade with equal power over the next block. A
+// stream in a settled FreezeAndReset bypass with nothing queued skips the
+// workers altogether: write() appends straight to its output, so idle
+// bypassed streams cost a copy.
+//
+// Workers run with denormals flushed to zero. A block of digital silence for
+// a stream whose filter state has decayed is passed on untouched and does
+// not take part in the kernel run; a group of silent streams costs no kernel
+// run at all.
+//
+// All public functions are thread safe, but a stream id must not be used
+// while or after it is removed.
+class StreamEngine
+{
+public:
+    static const int BandCount = EqualizerBands::Count;
+
+    StreamEngine(int maximumStreams, int blockFrames = 480, int threadCount = 0);
+    StreamEngine(int maximumStreams, int blockFrames, int threadCount, BiquadKernels::Isa maximumIsa);
+    ~StreamEngine();
+
+    StreamEngine(const StreamEngine &) = delete;
+    StreamEngine &operator=(const StreamEngine &) = delete;
+
+    int maximumStreams() const;
+    int blockFrames() const;
+    int laneCount() const;
+    int threadCount() const;
+    BiquadKernels::Isa isa() const;
+
+    // Returns the new stream id, or -1 if the pool is full or channels is
+    // outside 1..laneCount().
+    int addStream(double sampleRate, int channels);
+    void removeStream(int stream);
+
+    // Takes effect at the next block boundary, without smoothing.
+    bool setBandGains(int stream, const int *gains, int count);
+    bool setBypassed(int stream, bool bypassed);
+    // FreezeAndReset by default.
+    bool setBypassMode(int stream, EqualizerEngine::BypassMode mode);
+
+    // Interleaved float samples. read() returns the number of frames copied.
+    bool write(int stream, const float *samples, int frameCount);
+    int read(int stream, float *samples, int maximumFrames);
+    int availableFrames(int stream) const;
+
+    // Blocks until no group task is queued or running.
+    void waitForIdle();
+
+    StreamStatistics streamStatistics(int stream) const;
+    StreamEngineStatistics statistics() const;
+
+private:
+    struct Group;
+
+    struct Stream
+    {
+        bool isUsed;
+        unsigned generation;
+        Group *group;
+        int firstLane;
+        int channels;
+        double sampleRate;
+        int tableIndex;
+
+        int gains[BandCount];
+        bool gainsChanged;
+        bool resetPending;
+        bool isBypassed;
+        // The next block crossfades into the state isBypassed names.
+        bool fadePending;
+        EqualizerEngine::BypassMode bypassMode;
+        // A worker holds a block whose output is not appended yet.
+        bool isInFlight;
+
+        // Interleaved FIFOs; the head index is compacted away lazily.
+        std::vector<float> input;
+        size_t inputHead;
+        std::vector<float> output;
+        size_t outputHead;
+
+        StreamStatistics statistics;
+
+        Stream();
+    };
+
+    struct Group
+    {
+        std::mutex mutex;
+        bool isScheduled;
+        std::vector<Stream *> streams;
+        std::vector<Stream *> laneOwners;
+        // [section][b0 b1 b2 a1 a2][lane] followed by [section][s1 s2][lane].
+        std::vector<float> storage;
+    };
+
+    // How a block's output is made from the filtered and the dry signal.
+    enum Mix
+    {
+        Wet,
+        Dry,
+        FadeToDry,
+        FadeToWet
+    };
+
+    struct ReadyStream
+    {
+        Stream *stream;
+        unsigned generation;
+        Mix mix;
+    };
+
+    int m_maximumStreams;
+    int m_blockFrames;
+    BiquadKernels::Kernel m_kernel;
+    // Every group runs all BandCount sections.
+    BiquadKernels::CascadeFunction m_cascade;
+
+    mutable std::mutex m_mutex;
+    std::unique_ptr<Stream[]> m_streams;
+    std::vector<int> m_freeStreams;
+    std::vector<std::unique_ptr<Group>> m_groups;
+
+    std::chrono::steady_clock::time_point m_startTime;
+    std::atomic<std::int64_t> m_framesProcessed;
+    std::atomic<std::int64_t> m_blocks;
+    std::atomic<std::int64_t> m_groupRuns;
+    std::atomic<std::int64_t> m_silentBlocks;
+    std::atomic<std::int64_t> m_busyNs;
+    std::atomic<std::int64_t> m_audioNs;
+
+    // Equal-power fade over one block, rising from 0 to 1.
+    std::vector<float> m_fadeCurve;
+
+    // Per worker scratch: [frame][lane] samples, their dry copy and one
+    // group's saved state.
+    std::vector<std::vector<float>> m_laneBuffers;
+    std::vector<std::vector<float>> m_dryBuffers;
+    std::vector<std::vector<float>> m_savedStates;
+
+    // Declared last so its workers are joined before anything they use goes.
+    WorkStealingPool m_pool;
+
+    Stream *streamAt(int stream) const;
+    float *coefficientsOf(Group *group) const;
+    float *statesOf(Group *group) const;
+    void updateCoefficients(Stream *stream);
+    void resetState(Stream *stream);
+    bool isStateSilent(const Stream *stream) const;
+    void schedule(Group *group);
+    void processGroup(Group *group);
+    void appendOutput(const ReadyStream &entry, const float *buffer, const float *dry);
+};
+
+#endif // STREAMENGINE_H
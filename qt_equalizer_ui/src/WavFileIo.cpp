@@ -0,0 +1,127 @@
+#include "WavFileIo.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+const unsigned char WavFileIo::SubFormatGuidTail[14] = {
+    0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71
+};
+
+std::FILE *WavFileIo::open(const std::string &path, const char *mode)
+{
+    if (path != "-") {
+        return std::fopen(path.c_str(), mode);
+    }
+
+    std::FILE *file = std::strchr(mode, 'r') ? stdin : stdout;
+#ifdef _WIN32
+    _setmode(_fileno(file), _O_BINARY);
+#endif
+    return file;
+}
+
+void WavFileIo::close(std::FILE *file)
+{
+    if (file && file != stdin && file != stdout) {
+        std::fclose(file);
+    } else if (file == stdout) {
+        std::fflush(file);
+    }
+}
+
+void WavFileIo::prefetch(const std::string &path)
+{
+#if defined(__linux__)
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    ::close(fd);
+#else
+    (void)path;
+#endif
+}
+
+bool WavFileIo::isSameFile(const std::string &first, const std::string &second)
+{
+    if (first == "-" || second == "-") {
+        return false;
+    }
+
+#ifdef _WIN32
+    // No inode numbers; compare the absolute paths, which NTFS matches
+    // without regard to case.
+    char firstPath[_MAX_PATH];
+    char secondPath[_MAX_PATH];
+    return _fullpath(firstPath, first.c_str(), _MAX_PATH) && _fullpath(secondPath, second.c_str(), _MAX_PATH)
+            && _stricmp(firstPath, secondPath) == 0;
+#else
+    struct stat firstStatus;
+    struct stat secondStatus;
+    return ::stat(first.c_str(), &firstStatus) == 0 && ::stat(second.c_str(), &secondStatus) == 0
+            && firstStatus.st_dev == secondStatus.st_dev && firstStatus.st_ino == secondStatus.st_ino;
+#endif
+}
+
+bool WavFileIo::seek(std::FILE *file, std::int64_t offset, int whence)
+{
+#ifdef _WIN32
+    return _fseeki64(file, offset, whence) == 0;
+#else
+    return fseeko(file, static_cast<off_t>(offset), whence) == 0;
+#endif
+}
+
+std::int64_t WavFileIo::tell(std::FILE *file)
+{
+#ifdef _WIN32
+    return _ftelli64(file);
+#else
+    return static_cast<std::int64_t>(ftello(file));
+#endif
+}
+
+std::uint16_t WavFileIo::readUInt16(const unsigned char *in)
+{
+    return static_cast<std::uint16_t>(in[0] | (in[1] << 8));
+}
+
+std::uint32_t WavFileIo::readUInt32(const unsigned char *in)
+{
+    return static_cast<std::uint32_t>(in[0]) | (static_cast<std::uint32_t>(in[1]) << 8)
+            | (static_cast<std::uint32_t>(in[2]) << 16) | (static_cast<std::uint32_t>(in[3]) << 24);
+}
+
+std::uint64_t WavFileIo::readUInt64(const unsigned char *in)
+{
+    return static_cast<std::uint64_t>(readUInt32(in)) | (static_cast<std::uint64_t>(readUInt32(in + 4)) << 32);
+}
+
+void WavFileIo::writeUInt16(unsigned char *out, std::uint16_t value)
+{
+    out[0] = static_cast<unsigned char>(value);
+    out[1] = static_cast<unsigned char>(value >> 8);
+}
+
+void WavFileIo::writeUInt32(unsigned char *out, std::uint32_t value)
+{
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+void WavFileIo::writeUInt64(unsigned char *out, std::uint64_t value)
+{
+    writeUInt32(out, static_cast<std::uint32_t>(value));
+    writeUInt32(out + 4, static_cast<std::uint32_t>(value >> 32));
+}
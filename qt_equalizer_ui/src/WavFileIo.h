@@ -0,0 +1,43 @@
+#ifndef WAVFILEIO_H
+#define WAVFILEIO_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Helpers shared by WavReader and WavWriter: 64-bit stdio seeking and the
+// little-endian fields of the RIFF/RF64 chunk headers.
+namespace WavFileIo
+{
+    const std::uint16_t FormatPcm = 0x0001;
+    const std::uint16_t FormatIeeeFloat = 0x0003;
+    const std::uint16_t FormatExtensible = 0xFFFE;
+
+    // KSDATAFORMAT_SUBTYPE_PCM / _IEEE_FLOAT minus the leading format tag,
+    // which is stored separately.
+    extern const unsigned char SubFormatGuidTail[14];
+
+    // "-" opens stdin or stdout, depending on mode.
+    std::FILE *open(const std::string &path, const char *mode);
+    void close(std::FILE *file);
+
+    // Starts asynchronous kernel readahead of a whole file so it is cached
+    // by the time it is opened. A no-op where the platform has no fadvise.
+    void prefetch(const std::string &path);
+
+    // True when both paths name the same existing file, through links or
+    // differently spelled paths. "-" is never the same file as anything.
+    bool isSameFile(const std::string &first, const std::string &second);
+
+    bool seek(std::FILE *file, std::int64_t offset, int whence);
+    std::int64_t tell(std::FILE *file);
+
+    std::uint16_t readUInt16(const unsigned char *in);
+    std::uint32_t readUInt32(const unsigned char *in);
+    std::uint64_t readUInt64(const unsigned char *in);
+    void writeUInt16(unsigned char *out, std::uint16_t value);
+    void writeUInt32(unsigned char *out, std::uint32_t value);
+    void writeUInt64(unsigned char *out, std::uint64_t value);
+}
+
+#endif // WAVFILEIO_H
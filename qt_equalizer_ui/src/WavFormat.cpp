@@ -0,0 +1,90 @@
+#include "WavFormat.h"
+
+#include <cstring>
+#include <initializer_list>
+
+int SampleFormats::bytesPerSample(SampleFormat format)
+{
+    switch (format) {
+    case SampleUInt8:
+        return 1;
+    case SampleInt16:
+        return 2;
+    case SampleInt24:
+        return 3;
+    case SampleInt32:
+    case SampleFloat32:
+        return 4;
+    case SampleFloat64:
+        return 8;
+    }
+
+    return 0;
+}
+
+bool SampleFormats::isFloat(SampleFormat format)
+{
+    return format == SampleFloat32 || format == SampleFloat64;
+}
+
+const char *SampleFormats::name(SampleFormat format)
+{
+    switch (format) {
+    case SampleUInt8:
+        return "u8";
+    case SampleInt16:
+        return "s16";
+    case SampleInt24:
+        return "s24";
+    case SampleInt32:
+        return "s32";
+    case SampleFloat32:
+        return "f32";
+    case SampleFloat64:
+        return "f64";
+    }
+
+    return "unknown";
+}
+
+bool SampleFormats::fromName(const char *name, SampleFormat *format)
+{
+    if (!name || !format) {
+        return false;
+    }
+
+    for (SampleFormat candidate : {SampleUInt8, SampleInt16, SampleInt24, SampleInt32, SampleFloat32, SampleFloat64}) {
+        if (std::strcmp(name, SampleFormats::name(candidate)) == 0) {
+            *format = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+WavFormat::WavFormat()
+    : sampleFormat(SampleInt16)
+    , sampleRate(8000)
+    , channels(2)
+    , channelMask(0)
+{
+}
+
+WavFormat::WavFormat(SampleFormat format, std::uint32_t rate, std::uint16_t channelCount)
+    : sampleFormat(format)
+    , sampleRate(rate)
+    , channels(channelCount)
+    , channelMask(0)
+{
+}
+
+int WavFormat::bytesPerSample() const
+{
+    return SampleFormats::bytesPerSample(sampleFormat);
+}
+
+int WavFormat::blockAlign() const
+{
+    return bytesPerSample() * channels;
+}
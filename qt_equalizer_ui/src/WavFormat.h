@@ -0,0 +1,42 @@
+#ifndef WAVFORMAT_H
+#define WAVFORMAT_H
+
+#include <cstdint>
+
+enum SampleFormat
+{
+    SampleUInt8,
+    SampleInt16,
+    SampleInt24,
+    SampleInt32,
+    SampleFloat32,
+    SampleFloat64
+};
+
+namespace SampleFormats
+{
+    int bytesPerSample(SampleFormat format);
+    bool isFloat(SampleFormat format);
+
+    // "u8", "s16", "s24", "s32", "f32", "f64".
+    const char *name(SampleFormat format);
+    bool fromName(const char *name, SampleFormat *format);
+}
+
+struct WavFormat
+{
+    SampleFormat sampleFormat;
+    std::uint32_t sampleRate;
+    std::uint16_t channels;
+    // WAVE_FORMAT_EXTENSIBLE speaker mask; 0 lets the writer pick the usual
+    // mask for the channel count.
+    std::uint32_t channelMask;
+
+    WavFormat();
+    WavFormat(SampleFormat format, std::uint32_t rate, std::uint16_t channelCount);
+
+    int bytesPerSample() const;
+    int blockAlign() const;
+};
+
+#endif // WAVFORMAT_H
@@ -0,0 +1,368 @@
+#include "WavReader.h"
+
+#include "SampleConversion.h"
+#include "WavFileIo.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace
+{
+    const std::uint32_t UnknownSize = 0xFFFFFFFF;
+    // Upper bound on a fmt chunk we are willing to buffer.
+    const std::uint32_t MaximumFormatSize = 4096;
+    const size_t ConversionBufferSize = 64 * 1024;
+
+    bool hasId(const unsigned char *chunk, const char *id)
+    {
+        return std::memcmp(chunk, id, 4) == 0;
+    }
+
+    bool sampleFormatFor(std::uint16_t formatTag, std::uint16_t bitsPerSample, SampleFormat *format)
+    {
+        if (formatTag == WavFileIo::FormatPcm) {
+            switch (bitsPerSample) {
+            case 8:
+                *format = SampleUInt8;
+                return true;
+            case 16:
+                *format = SampleInt16;
+                return true;
+            case 24:
+                *format = SampleInt24;
+                return true;
+            case 32:
+                *format = SampleInt32;
+                return true;
+            }
+        } else if (formatTag == WavFileIo::FormatIeeeFloat) {
+            switch (bitsPerSample) {
+            case 32:
+                *format = SampleFloat32;
+                return true;
+            case 64:
+                *format = SampleFloat64;
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
+
+WavReader::WavReader()
+    : m_file(nullptr)
+    , m_frameCount(0)
+    , m_position(0)
+    , m_dataOffset(0)
+    , m_isRf64(false)
+{
+}
+
+WavReader::~WavReader()
+{
+    close();
+}
+
+bool WavReader::open(const std::string &path)
+{
+    close();
+    m_errorString.clear();
+
+    m_file = WavFileIo::open(path, "rb");
+    if (!m_file) {
+        return fail("Cannot open " + path + ": " + std::strerror(errno));
+    }
+
+    if (!readChunks()) {
+        WavFileIo::close(m_file);
+        m_file = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+void WavReader::close()
+{
+    WavFileIo::close(m_file);
+    m_file = nullptr;
+    m_format = WavFormat();
+    m_frameCount = 0;
+    m_position = 0;
+    m_dataOffset = 0;
+    m_isRf64 = false;
+}
+
+bool WavReader::isOpen() const
+{
+    return m_file != nullptr;
+}
+
+const WavFormat &WavReader::format() const
+{
+    return m_format;
+}
+
+std::int64_t WavReader::frameCount() const
+{
+    return m_frameCount;
+}
+
+std::int64_t WavReader::position() const
+{
+    return m_position;
+}
+
+bool WavReader::isRf64() const
+{
+    return m_isRf64;
+}
+
+std::int64_t WavReader::dataOffset() const
+{
+    return m_dataOffset;
+}
+
+std::int64_t WavReader::readRaw(void *target, std::int64_t frames)
+{
+    if (!m_file) {
+        fail("No file open");
+        return -1;
+    }
+
+    if (m_frameCount >= 0) {
+        frames = std::min(frames, m_frameCount - m_position);
+    }
+    if (frames <= 0) {
+        return 0;
+    }
+
+    const size_t read = std::fread(target, m_format.blockAlign(), static_cast<size_t>(frames), m_file);
+    if (read < static_cast<size_t>(frames) && std::ferror(m_file)) {
+        fail(std::string("Read failed: ") + std::strerror(errno));
+        return -1;
+    }
+
+    m_position += static_cast<std::int64_t>(read);
+    return static_cast<std::int64_t>(read);
+}
+
+std::int64_t WavReader::readFrames(float *target, std::int64_t frames)
+{
+    const int channels = m_format.channels;
+
+    // Float files need no conversion; read straight into the caller's buffer.
+    if (m_format.sampleFormat == SampleFloat32) {
+        return readRaw(target, frames);
+    }
+
+    const std::int64_t blockFrames = std::max<std::int64_t>(1, ConversionBufferSize / m_format.blockAlign());
+    m_buffer.resize(static_cast<size_t>(blockFrames * m_format.blockAlign()));
+
+    std::int64_t total = 0;
+    while (total < frames) {
+        const std::int64_t read = readRaw(m_buffer.data(), std::min(blockFrames, frames - total));
+        if (read < 0) {
+            return -1;
+        }
+        if (read == 0) {
+            break;
+        }
+
+        SampleConversion::toFloat(m_format.sampleFormat, m_buffer.data(), target + total * channels,
+                                  static_cast<size_t>(read * channels));
+        total += read;
+    }
+
+    return total;
+}
+
+bool WavReader::seek(std::int64_t frame)
+{
+    if (!m_file) {
+        return fail("No file open");
+    }
+    if (frame < 0 || (m_frameCount >= 0 && frame > m_frameCount)) {
+        return fail("Seek past the end of the data");
+    }
+
+    const std::int64_t blockAlign = m_format.blockAlign();
+    if (WavFileIo::seek(m_file, m_dataOffset + frame * blockAlign, SEEK_SET)) {
+        m_position = frame;
+        return true;
+    }
+
+    // Pipes can only move forwards.
+    if (frame < m_position) {
+        return fail("Input cannot seek backwards");
+    }
+    if (!skip(static_cast<std::uint64_t>((frame - m_position) * blockAlign))) {
+        return false;
+    }
+    m_position = frame;
+    return true;
+}
+
+const std::string &WavReader::errorString() const
+{
+    return m_errorString;
+}
+
+bool WavReader::readChunks()
+{
+    unsigned char header[12];
+    if (std::fread(header, 1, sizeof(header), m_file) != sizeof(header)) {
+        return fail("File is too short for a RIFF header");
+    }
+
+    m_isRf64 = hasId(header, "RF64") || hasId(header, "BW64");
+    if ((!m_isRf64 && !hasId(header, "RIFF")) || !hasId(header + 8, "WAVE")) {
+        return fail("Not a RIFF/WAVE or RF64 file");
+    }
+
+    std::int64_t offset = sizeof(header);
+    std::uint64_t ds64DataSize = 0;
+    bool hasDs64 = false;
+    bool hasFormat = false;
+
+    for (;;) {
+        unsigned char chunk[8];
+        if (std::fread(chunk, 1, sizeof(chunk), m_file) != sizeof(chunk)) {
+            return fail("No data chunk found");
+        }
+        offset += sizeof(chunk);
+
+        const std::uint32_t size = WavFileIo::readUInt32(chunk + 4);
+
+        if (hasId(chunk, "data")) {
+            if (!hasFormat) {
+                return fail("Data chunk before fmt chunk");
+            }
+
+            m_dataOffset = offset;
+            if (m_isRf64 && hasDs64 && size == UnknownSize) {
+                m_frameCount = static_cast<std::int64_t>(ds64DataSize / m_format.blockAlign());
+            } else if (size == UnknownSize) {
+                m_frameCount = -1;
+            } else {
+                m_frameCount = size / m_format.blockAlign();
+            }
+            return true;
+        }
+
+        if (hasId(chunk, "fmt ")) {
+            if (size < 16 || size > MaximumFormatSize) {
+                return fail("Malformed fmt chunk");
+            }
+
+            std::vector<unsigned char> body(size);
+            if (std::fread(body.data(), 1, size, m_file) != size) {
+                return fail("Truncated fmt chunk");
+            }
+            if (!parseFormat(body.data(), size)) {
+                return false;
+            }
+
+            hasFormat = true;
+            offset += size;
+            if (size & 1) {
+                if (!skip(1)) {
+                    return false;
+                }
+                ++offset;
+            }
+            continue;
+        }
+
+        if (hasId(chunk, "ds64") && size >= 24) {
+            unsigned char body[24];
+            if (std::fread(body, 1, sizeof(body), m_file) != sizeof(body)) {
+                return fail("Truncated ds64 chunk");
+            }
+            // riffSize, dataSize, sampleCount; the table that may follow is
+            // only needed for oversized chunks other than data.
+            ds64DataSize = WavFileIo::readUInt64(body + 8);
+            hasDs64 = true;
+
+            const std::uint64_t rest = size - sizeof(body) + (size & 1);
+            if (!skip(rest)) {
+                return false;
+            }
+            offset += static_cast<std::int64_t>(size + (size & 1));
+            continue;
+        }
+
+        // LIST, fact, JUNK, bext, ...
+        if (!skip(static_cast<std::uint64_t>(size) + (size & 1))) {
+            return false;
+        }
+        offset += static_cast<std::int64_t>(size) + (size & 1);
+    }
+}
+
+bool WavReader::parseFormat(const unsigned char *chunk, std::uint32_t size)
+{
+    std::uint16_t formatTag = WavFileIo::readUInt16(chunk);
+    const std::uint16_t channels = WavFileIo::readUInt16(chunk + 2);
+    const std::uint32_t sampleRate = WavFileIo::readUInt32(chunk + 4);
+    const std::uint16_t blockAlign = WavFileIo::readUInt16(chunk + 12);
+    const std::uint16_t bitsPerSample = WavFileIo::readUInt16(chunk + 14);
+    std::uint32_t channelMask = 0;
+
+    if (formatTag == WavFileIo::FormatExtensible) {
+        if (size < 40) {
+            return fail("Truncated WAVE_FORMAT_EXTENSIBLE fmt chunk");
+        }
+        // Valid bits (chunk + 18) may be lower than the container size, e.g.
+        // 20-bit audio in 24-bit slots; the container is what we decode.
+        channelMask = WavFileIo::readUInt32(chunk + 20);
+        if (std::memcmp(chunk + 26, WavFileIo::SubFormatGuidTail, sizeof(WavFileIo::SubFormatGuidTail)) != 0) {
+            return fail("Unsupported WAVE_FORMAT_EXTENSIBLE subformat");
+        }
+        formatTag = WavFileIo::readUInt16(chunk + 24);
+    }
+
+    SampleFormat sampleFormat;
+    if (!sampleFormatFor(formatTag, bitsPerSample, &sampleFormat)) {
+        return fail("Unsupported format tag " + std::to_string(formatTag) + " with "
+                    + std::to_string(bitsPerSample) + " bits per sample");
+    }
+
+    WavFormat format(sampleFormat, sampleRate, channels);
+    format.channelMask = channelMask;
+    if (channels == 0 || sampleRate == 0 || blockAlign != format.blockAlign()) {
+        return fail("Inconsistent fmt chunk");
+    }
+
+    m_format = format;
+    return true;
+}
+
+bool WavReader::skip(std::uint64_t size)
+{
+    if (size == 0) {
+        return true;
+    }
+    if (WavFileIo::seek(m_file, static_cast<std::int64_t>(size), SEEK_CUR)) {
+        return true;
+    }
+
+    // Not seekable: read and drop.
+    unsigned char scratch[4096];
+    while (size > 0) {
+        const size_t chunk = static_cast<size_t>(std::min<std::uint64_t>(size, sizeof(scratch)));
+        if (std::fread(scratch, 1, chunk, m_file) != chunk) {
+            return fail("Unexpected end of file");
+        }
+        size -= chunk;
+    }
+    return true;
+}
+
+bool WavReader::fail(const std::string &message)
+{
+    m_errorString = message;
+    return false;
+}
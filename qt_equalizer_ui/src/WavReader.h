@@ -0,0 +1,61 @@
+#ifndef WAVREADER_H
+#define WAVREADER_H
+
+#include "WavFormat.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Reads RIFF/WAVE and RF64 (or BW64) files. open() walks the chunk list up
+// to the data chunk and leaves the payload on disk; frames are then read on
+// demand, either raw or converted to float. Understands WAVE_FORMAT_PCM,
+// WAVE_FORMAT_IEEE_FLOAT and WAVE_FORMAT_EXTENSIBLE with either subformat.
+//
+// A data chunk with the streaming size 0xFFFFFFFF (as written by
+// PcmToWavConverter to a pipe) is read until end of file.
+class WavReader
+{
+public:
+    WavReader();
+    ~WavReader();
+
+    // "-" reads stdin; seek() then only works forwards.
+    bool open(const std::string &path);
+    void close();
+    bool isOpen() const;
+
+    const WavFormat &format() const;
+    // -1 while the data size is unknown (streamed input).
+    std::int64_t frameCount() const;
+    std::int64_t position() const;
+    bool isRf64() const;
+    std::int64_t dataOffset() const;
+
+    // Both return the number of frames read: less than requested at the end
+    // of the data, -1 on error.
+    std::int64_t readRaw(void *target, std::int64_t frames);
+    std::int64_t readFrames(float *target, std::int64_t frames);
+
+    bool seek(std::int64_t frame);
+
+    const std::string &errorString() const;
+
+private:
+    std::FILE *m_file;
+    WavFormat m_format;
+    std::int64_t m_frameCount;
+    std::int64_t m_position;
+    std::int64_t m_dataOffset;
+    bool m_isRf64;
+    std::vector<unsigned char> m_buffer;
+    std::string m_errorString;
+
+    bool readChunks();
+    bool parseFormat(const unsigned char *chunk, std::uint32_t size);
+    bool skip(std::uint64_t size);
+    bool fail(const std::string &message);
+};
+
+#endif // WAVREADER_H
@@ -0,0 +1,280 @@
+#include "WavWriter.h"
+
+#include "SampleConversion.h"
+#include "WavFileIo.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace
+{
+    const std::uint32_t UnknownSize = 0xFFFFFFFF;
+    const std::uint32_t JunkSize = 28;
+    const std::uint32_t PlainFormatSize = 16;
+    const std::uint32_t FloatFormatSize = 18;
+    const std::uint32_t ExtensibleFormatSize = 40;
+    const size_t ConversionBufferSize = 64 * 1024;
+
+    std::uint32_t defaultChannelMask(int channels)
+    {
+        switch (channels) {
+        case 1:
+            return 0x4; // FC
+        case 2:
+            return 0x3; // FL FR
+        case 3:
+            return 0x7; // FL FR FC
+        case 4:
+            return 0x33; // FL FR BL BR
+        case 5:
+            return 0x37; // FL FR FC BL BR
+        case 6:
+            return 0x3F; // 5.1
+        case 7:
+            return 0x13F; // 6.1
+        case 8:
+            return 0x63F; // 7.1
+        }
+
+        return 0;
+    }
+}
+
+WavWriter::WavWriter()
+    : m_file(nullptr)
+    , m_headerOffset(0)
+    , m_dataOffset(0)
+    , m_framesWritten(0)
+    , m_isRf64(false)
+{
+}
+
+WavWriter::~WavWriter()
+{
+    close();
+}
+
+bool WavWriter::open(const std::string &path, const WavFormat &format)
+{
+    close();
+    m_errorString.clear();
+
+    if (format.channels == 0 || format.sampleRate == 0) {
+        return fail("Invalid format");
+    }
+
+    m_file = WavFileIo::open(path, "wb");
+    if (!m_file) {
+        return fail("Cannot open " + path + ": " + std::strerror(errno));
+    }
+
+    m_format = format;
+    m_framesWritten = 0;
+    m_isRf64 = false;
+    m_buffer.resize(ConversionBufferSize);
+    // Appending to stdout starts wherever it already is.
+    m_headerOffset = std::max<std::int64_t>(0, WavFileIo::tell(m_file));
+
+    if (!writeHeader()) {
+        WavFileIo::close(m_file);
+        m_file = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+bool WavWriter::close()
+{
+    if (!m_file) {
+        return true;
+    }
+
+    bool ok = true;
+    const std::uint64_t dataSize = static_cast<std::uint64_t>(m_framesWritten) * m_format.blockAlign();
+    if (dataSize & 1) {
+        ok = std::fputc(0, m_file) != EOF;
+    }
+    if (ok && std::fflush(m_file) != 0) {
+        ok = fail(std::string("Write failed: ") + std::strerror(errno));
+    }
+    if (ok) {
+        ok = patchHeader();
+    }
+
+    WavFileIo::close(m_file);
+    m_file = nullptr;
+    return ok;
+}
+
+bool WavWriter::isOpen() const
+{
+    return m_file != nullptr;
+}
+
+const WavFormat &WavWriter::format() const
+{
+    return m_format;
+}
+
+std::int64_t WavWriter::framesWritten() const
+{
+    return m_framesWritten;
+}
+
+bool WavWriter::isRf64() const
+{
+    return m_isRf64;
+}
+
+bool WavWriter::writeFrames(const float *source, std::int64_t frames)
+{
+    if (m_format.sampleFormat == SampleFloat32) {
+        return writeRaw(source, frames);
+    }
+
+    const int channels = m_format.channels;
+    const std::int64_t blockFrames = std::max<std::int64_t>(1, ConversionBufferSize / m_format.blockAlign());
+    if (m_buffer.size() < static_cast<size_t>(blockFrames * m_format.blockAlign())) {
+        m_buffer.resize(static_cast<size_t>(blockFrames * m_format.blockAlign()));
+    }
+
+    while (frames > 0) {
+        const std::int64_t count = std::min(blockFrames, frames);
+        SampleConversion::fromFloat(m_format.sampleFormat, source, m_buffer.data(),
+                                    static_cast<size_t>(count * channels));
+        if (!writeRaw(m_buffer.data(), count)) {
+            return false;
+        }
+        source += count * channels;
+        frames -= count;
+    }
+
+    return true;
+}
+
+bool WavWriter::writeRaw(const void *source, std::int64_t frames)
+{
+    if (!m_file) {
+        return fail("No file open");
+    }
+    if (frames <= 0) {
+        return true;
+    }
+
+    const size_t written = std::fwrite(source, m_format.blockAlign(), static_cast<size_t>(frames), m_file);
+    m_framesWritten += static_cast<std::int64_t>(written);
+    if (written != static_cast<size_t>(frames)) {
+        return fail(std::string("Write failed: ") + std::strerror(errno));
+    }
+
+    return true;
+}
+
+const std::string &WavWriter::errorString() const
+{
+    return m_errorString;
+}
+
+bool WavWriter::writeHeader()
+{
+    const SampleFormat sampleFormat = m_format.sampleFormat;
+    const int bitsPerSample = m_format.bytesPerSample() * 8;
+    const bool isFloat = SampleFormats::isFloat(sampleFormat);
+    const bool isExtensible = m_format.channels > 2 || (!isFloat && bitsPerSample > 16);
+    const std::uint16_t formatTag = isFloat ? WavFileIo::FormatIeeeFloat : WavFileIo::FormatPcm;
+    const std::uint32_t formatSize = isExtensible ? ExtensibleFormatSize : (isFloat ? FloatFormatSize : PlainFormatSize);
+
+    unsigned char header[12 + 8 + JunkSize + 8 + ExtensibleFormatSize + 8];
+    std::memset(header, 0, sizeof(header));
+    unsigned char *out = header;
+
+    std::memcpy(out, "RIFF", 4);
+    WavFileIo::writeUInt32(out + 4, UnknownSize);
+    std::memcpy(out + 8, "WAVE", 4);
+    out += 12;
+
+    // Placeholder for ds64 (riffSize, dataSize, sampleCount, tableLength).
+    std::memcpy(out, "JUNK", 4);
+    WavFileIo::writeUInt32(out + 4, JunkSize);
+    out += 8 + JunkSize;
+
+    std::memcpy(out, "fmt ", 4);
+    WavFileIo::writeUInt32(out + 4, formatSize);
+    WavFileIo::writeUInt16(out + 8, isExtensible ? WavFileIo::FormatExtensible : formatTag);
+    WavFileIo::writeUInt16(out + 10, m_format.channels);
+    WavFileIo::writeUInt32(out + 12, m_format.sampleRate);
+    WavFileIo::writeUInt32(out + 16, m_format.sampleRate * m_format.blockAlign());
+    WavFileIo::writeUInt16(out + 20, static_cast<std::uint16_t>(m_format.blockAlign()));
+    WavFileIo::writeUInt16(out + 22, static_cast<std::uint16_t>(bitsPerSample));
+    if (isExtensible) {
+        const std::uint32_t channelMask = m_format.channelMask ? m_format.channelMask
+                                                               : defaultChannelMask(m_format.channels);
+        WavFileIo::writeUInt16(out + 24, 22);
+        WavFileIo::writeUInt16(out + 26, static_cast<std::uint16_t>(bitsPerSample));
+        WavFileIo::writeUInt32(out + 28, channelMask);
+        WavFileIo::writeUInt16(out + 32, formatTag);
+        std::memcpy(out + 34, WavFileIo::SubFormatGuidTail, sizeof(WavFileIo::SubFormatGuidTail));
+    }
+    // cbSize of the plain float header is already zero.
+    out += 8 + formatSize;
+
+    std::memcpy(out, "data", 4);
+    WavFileIo::writeUInt32(out + 4, UnknownSize);
+    out += 8;
+
+    const size_t size = static_cast<size_t>(out - header);
+    if (std::fwrite(header, 1, size, m_file) != size) {
+        return fail(std::string("Cannot write the WAV header: ") + std::strerror(errno));
+    }
+
+    m_dataOffset = m_headerOffset + static_cast<std::int64_t>(size);
+    return true;
+}
+
+bool WavWriter::patchHeader()
+{
+    // A pipe keeps the streaming sizes; readers take those as "until EOF".
+    if (!WavFileIo::seek(m_file, m_headerOffset, SEEK_SET)) {
+        return true;
+    }
+
+    const std::uint64_t dataSize = static_cast<std::uint64_t>(m_framesWritten) * m_format.blockAlign();
+    const std::uint64_t riffSize = static_cast<std::uint64_t>(m_dataOffset - m_headerOffset) - 8
+            + dataSize + (dataSize & 1);
+    m_isRf64 = riffSize > 0xFFFFFFFFull;
+
+    unsigned char header[12 + 8 + JunkSize];
+    std::memcpy(header, m_isRf64 ? "RF64" : "RIFF", 4);
+    WavFileIo::writeUInt32(header + 4, m_isRf64 ? UnknownSize : static_cast<std::uint32_t>(riffSize));
+    std::memcpy(header + 8, "WAVE", 4);
+
+    unsigned char *chunk = header + 12;
+    std::memset(chunk + 8, 0, JunkSize);
+    std::memcpy(chunk, m_isRf64 ? "ds64" : "JUNK", 4);
+    WavFileIo::writeUInt32(chunk + 4, JunkSize);
+    if (m_isRf64) {
+        WavFileIo::writeUInt64(chunk + 8, riffSize);
+        WavFileIo::writeUInt64(chunk + 16, dataSize);
+        WavFileIo::writeUInt64(chunk + 24, static_cast<std::uint64_t>(m_framesWritten));
+    }
+
+    unsigned char dataSizeField[4];
+    WavFileIo::writeUInt32(dataSizeField, m_isRf64 ? UnknownSize : static_cast<std::uint32_t>(dataSize));
+
+    if (std::fwrite(header, 1, sizeof(header), m_file) != sizeof(header)
+            || !WavFileIo::seek(m_file, m_dataOffset - 4, SEEK_SET)
+            || std::fwrite(dataSizeField, 1, sizeof(dataSizeField), m_file) != sizeof(dataSizeField)
+            || std::fflush(m_file) != 0) {
+        return fail(std::string("Cannot patch the WAV header: ") + std::strerror(errno));
+    }
+
+    return true;
+}
+
+bool WavWriter::fail(const std::string &message)
+{
+    m_errorString = message;
+    return false;
+}
@@ -0,0 +1,58 @@
+#ifndef WAVWRITER_H
+#define WAVWRITER_H
+
+#include "WavFormat.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Writes WAV files in any of the SampleFormat encodings. Integer formats
+// above 16 bits and anything with more than two channels use
+// WAVE_FORMAT_EXTENSIBLE, as the format spec requires.
+//
+// A JUNK chunk is reserved behind the RIFF header; if the payload ends up
+// over 4 GB, close() turns the file into RF64 by rewriting that chunk as
+// ds64, so the length never has to be known up front. When the output
+// cannot seek (stdout to a pipe) the streaming sizes 0xFFFFFFFF are kept.
+class WavWriter
+{
+public:
+    WavWriter();
+    ~WavWriter();
+
+    // "-" writes stdout.
+    bool open(const std::string &path, const WavFormat &format);
+    // Pads the data chunk and patches the sizes. Called by the destructor.
+    bool close();
+    bool isOpen() const;
+
+    const WavFormat &format() const;
+    std::int64_t framesWritten() const;
+    // Whether close() had to switch to RF64.
+    bool isRf64() const;
+
+    // writeFrames() converts interleaved float to the file's sample format;
+    // writeRaw() expects data already in that format.
+    bool writeFrames(const float *source, std::int64_t frames);
+    bool writeRaw(const void *source, std::int64_t frames);
+
+    const std::string &errorString() const;
+
+private:
+    std::FILE *m_file;
+    WavFormat m_format;
+    std::int64_t m_headerOffset;
+    std::int64_t m_dataOffset;
+    std::int64_t m_framesWritten;
+    bool m_isRf64;
+    std::vector<unsigned char> m_buffer;
+    std::string m_errorString;
+
+    bool writeHeader();
+    bool patchHeader();
+    bool fail(const std::string &message);
+};
+
+#endif // WAVWRITER_H
@@ -0,0 +1,81 @@
+#include "WaveHeader.h"
+
+#include <cstring>
+
+namespace
+{
+    const std::uint16_t WaveFormatPcm = 0x0001;
+
+    unsigned char *writeTag(unsigned char *out, const char *tag)
+    {
+        std::memcpy(out, tag, 4);
+        return out + 4;
+    }
+
+    unsigned char *writeUInt16(unsigned char *out, std::uint16_t value)
+    {
+        out[0] = static_cast<unsigned char>(value);
+        out[1] = static_cast<unsigned char>(value >> 8);
+        return out + 2;
+    }
+
+    unsigned char *writeUInt32(unsigned char *out, std::uint32_t value)
+    {
+        out[0] = static_cast<unsigned char>(value);
+        out[1] = static_cast<unsigned char>(value >> 8);
+        out[2] = static_cast<unsigned char>(value >> 16);
+        out[3] = static_cast<unsigned char>(value >> 24);
+        return out + 4;
+    }
+}
+
+WaveHeader::WaveHeader()
+    : formatTag(WaveFormatPcm)
+    , channels(2)
+    , sampleRate(8000)
+    , bitsPerSample(16)
+    , dataLength(UnknownSize)
+{
+}
+
+std::uint16_t WaveHeader::blockAlign() const
+{
+    return static_cast<std::uint16_t>(channels * ((bitsPerSample + 7) / 8));
+}
+
+std::uint32_t WaveHeader::averageBytesPerSecond() const
+{
+    return blockAlign() * sampleRate;
+}
+
+std::uint32_t WaveHeader::riffLength() const
+{
+    if (dataLength == UnknownSize) {
+        return UnknownSize;
+    }
+
+    const std::uint64_t length = static_cast<std::uint64_t>(Size - 8) + dataLength + (dataLength & 1u);
+    return length >= UnknownSize ? UnknownSize : static_cast<std::uint32_t>(length);
+}
+
+void WaveHeader::setDataSize(std::uint64_t bytes)
+{
+    dataLength = bytes >= UnknownSize ? UnknownSize : static_cast<std::uint32_t>(bytes);
+}
+
+void WaveHeader::write(unsigned char *out) const
+{
+    out = writeTag(out, "RIFF");
+    out = writeUInt32(out, riffLength());
+    out = writeTag(out, "WAVE");
+    out = writeTag(out, "fmt ");
+    out = writeUInt32(out, 16);
+    out = writeUInt16(out, formatTag);
+    out = writeUInt16(out, channels);
+    out = writeUInt32(out, sampleRate);
+    out = writeUInt32(out, averageBytesPerSecond());
+    out = writeUInt16(out, blockAlign());
+    out = writeUInt16(out, bitsPerSample);
+    out = writeTag(out, "data");
+    writeUInt32(out, dataLength);
+}
@@ -0,0 +1,38 @@
+#ifndef WAVEHEADER_H
+#define WAVEHEADER_H
+
+#include <cstdint>
+
+// Canonical 44 byte RIFF/WAVE header for PCM data, the C++ counterpart of
+// com.example.pcmtowav.WaveHeader.
+struct WaveHeader
+{
+    static const int Size = 44;
+
+    // Size value used while the length is not known yet, and for streams
+    // whose length is never known (pipes). Readers treat it as "until EOF".
+    static const std::uint32_t UnknownSize = 0xFFFFFFFFu;
+
+    std::uint16_t formatTag;
+    std::uint16_t channels;
+    std::uint32_t sampleRate;
+    std::uint16_t bitsPerSample;
+    std::uint32_t dataLength;
+
+    WaveHeader();
+
+    std::uint16_t blockAlign() const;
+    std::uint32_t averageBytesPerSecond() const;
+
+    // RIFF chunk size for the current dataLength, including the pad byte an
+    // odd sized data chunk needs.
+    std::uint32_t riffLength() const;
+
+    // Sets dataLength for a payload of the given size, saturating at
+    // UnknownSize for payloads that do not fit in 32 bits.
+    void setDataSize(std::uint64_t bytes);
+
+    void write(unsigned char *out) const;
+};
+
+#endif // WAVEHEADER_H
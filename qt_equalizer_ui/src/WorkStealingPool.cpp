@@ -0,0 +1,142 @@
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+
+namespace
+{
+    thread_local const WorkStealingPool *t_pool = nullptr;
+    thread_local int t_workerIndex = -1;
+}
+
+WorkStealingPool::WorkStealingPool(int threadCount)
+    : m_isStopping(false)
+    , m_queuedCount(0)
+    , m_pendingCount(0)
+    , m_nextWorker(0)
+    , m_stealCount(0)
+{
+    if (threadCount <= 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    m_workers.reserve(static_cast<size_t>(threadCount));
+    for (int i = 0; i < threadCount; ++i) {
+        m_workers.emplace_back(new Worker);
+    }
+    for (int i = 0; i < threadCount; ++i) {
+        m_workers[static_cast<size_t>(i)]->thread = std::thread(&WorkStealingPool::run, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    wait();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isStopping = true;
+    }
+    m_workAvailable.notify_all();
+
+    for (const std::unique_ptr<Worker> &worker : m_workers) {
+        worker->thread.join();
+    }
+}
+
+int WorkStealingPool::threadCount() const
+{
+    return static_cast<int>(m_workers.size());
+}
+
+void WorkStealingPool::submit(Task task)
+{
+    int index = currentWorker();
+    if (index < 0) {
+        index = static_cast<int>(m_nextWorker.fetch_add(1, std::memory_order_relaxed) % m_workers.size());
+    }
+
+    m_pendingCount.fetch_add(1, std::memory_order_acq_rel);
+    Worker &worker = *m_workers[static_cast<size_t>(index)];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+
+    {
+        // Counted under m_mutex so a worker about to sleep cannot miss it.
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queuedCount.fetch_add(1, std::memory_order_acq_rel);
+    }
+    m_workAvailable.notify_one();
+}
+
+void WorkStealingPool::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_finished.wait(lock, [this] { return m_pendingCount.load(std::memory_order_acquire) == 0; });
+}
+
+std::uint64_t WorkStealingPool::stealCount() const
+{
+    return m_stealCount.load(std::memory_order_relaxed);
+}
+
+int WorkStealingPool::currentWorker() const
+{
+    return t_pool == this ? t_workerIndex : -1;
+}
+
+void WorkStealingPool::run(int index)
+{
+    t_pool = this;
+    t_workerIndex = index;
+
+    for (;;) {
+        Task task;
+        if (takeTask(index, &task)) {
+            m_queuedCount.fetch_sub(1, std::memory_order_acq_rel);
+            task();
+
+            if (m_pendingCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_finished.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_workAvailable.wait(lock, [this] {
+            return m_isStopping || m_queuedCount.load(std::memory_order_acquire) > 0;
+        });
+        if (m_isStopping) {
+            return;
+        }
+    }
+}
+
+bool WorkStealingPool::takeTask(int index, Task *task)
+{
+    {
+        Worker &own = *m_workers[static_cast<size_t>(index)];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            *task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    const int count = threadCount();
+    for (int offset = 1; offset < count; ++offset) {
+        Worker &victim = *m_workers[static_cast<size_t>((index + offset) % count)];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            *task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            m_stealCount.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,69 @@
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed size thread pool with one task deque per worker. A worker runs its
+// own tasks newest first (they are likely still in cache) and, when it runs
+// dry, steals the oldest task of another worker. Tasks submitted from outside
+// the pool are spread round robin; tasks submitted from a worker go to its
+// own deque. The deques are short-lived mutex protected queues: tasks here
+// are whole files or stream blocks, so queue traffic is not the bottleneck.
+class WorkStealingPool
+{
+public:
+    typedef std::function<void()> Task;
+
+    // 0 uses one thread per hardware thread.
+    explicit WorkStealingPool(int threadCount = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    int threadCount() const;
+
+    void submit(Task task);
+    // Blocks until every submitted task, including ones submitted by tasks,
+    // has finished.
+    void wait();
+
+    std::uint64_t stealCount() const;
+
+    // Index of the calling worker in this pool, or -1 on any other thread.
+    int currentWorker() const;
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_finished;
+    bool m_isStopping;
+
+    // Tasks waiting in a deque, and tasks not yet finished.
+    std::atomic<std::size_t> m_queuedCount;
+    std::atomic<std::size_t> m_pendingCount;
+    std::atomic<unsigned> m_nextWorker;
+    std::atomic<std::uint64_t> m_stealCount;
+
+    void run(int index);
+    bool takeTask(int index, Task *task);
+};
+
+#endif // WORKSTEALINGPOOL_H
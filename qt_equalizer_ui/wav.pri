@@ -0,0 +1,27 @@
+# Qt-free PCM/WAV file handling.
+
+INCLUDEPATH += $$PWD/src
+
+# 64-bit stdio offsets for RF64 files on 32-bit platforms.
+unix: DEFINES += _FILE_OFFSET_BITS=64
+
+SOURCES += \
+    $$PWD/src/WaveHeader.cpp \
+    $$PWD/src/PcmToWavConverter.cpp \
+    $$PWD/src/WavFormat.cpp \
+    $$PWD/src/SampleConversion.cpp \
+    $$PWD/src/WavFileIo.cpp \
+    $$PWD/src/WavReader.cpp \
+    $$PWD/src/WavWriter.cpp \
+    $$PWD/src/PipelineStages.cpp
+
+HEADERS += \
+    $$PWD/src/WaveHeader.h \
+    $$PWD/src/PcmToWavConverter.h \
+    $$PWD/src/WavFormat.h \
+    $$PWD/src/SampleConversion.h \
+    $$PWD/src/WavFileIo.h \
+    $$PWD/src/WavReader.h \
+    $$PWD/src/WavWriter.h \
+    $$PWD/src/BlockPipeline.h \
+    $$PWD/src/PipelineStages.h
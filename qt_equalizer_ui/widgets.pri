@@ -0,0 +1,20 @@
+# Equalizer widgets, without the application entry point. Needs engine.pri
+# and presets.pri.
+
+INCLUDEPATH += $$PWD/src
+
+SOURCES += \
+    $$PWD/src/MainWindow.cpp \
+    $$PWD/src/EqualizerWidget.cpp \
+    $$PWD/src/EqualizerCurveWidget.cpp \
+    $$PWD/src/SpectrumWorker.cpp
+
+HEADERS += \
+    $$PWD/src/MainWindow.h \
+    $$PWD/src/EqualizerWidget.h \
+    $$PWD/src/EqualizerCurveWidget.h \
+    $$PWD/src/SpectrumWorker.h
+
+FORMS += \
+    $$PWD/ui/MainWindow.ui \
+    $$PWD/ui/EqualizerWidget.ui